@@ -0,0 +1,163 @@
+/***************************************************************************
+    Offline Audio Rendering.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <cstring>
+
+#include "audiorender.hpp"
+#include "framepacer.hpp"
+#include "utils.hpp"
+#include "engine/audio/osoundint.hpp"
+
+static const int WAV_HEADER_SIZE = 44;
+
+static void write_le(uint8_t* dst, const uint32_t value, const int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        dst[i] = (value >> (i * 8)) & 0xFF;
+}
+
+AudioRender::AudioRender()
+{
+    samples = 0;
+}
+
+AudioRender::~AudioRender()
+{
+    close();
+}
+
+bool AudioRender::open(const char* filename)
+{
+    file.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cout << "Unable to create wav: " << filename << std::endl;
+        return false;
+    }
+
+    // Sizes are filled in by close()
+    const uint8_t header[WAV_HEADER_SIZE] = { 0 };
+    file.write((const char*) header, WAV_HEADER_SIZE);
+
+    samples        = 0;
+    second_samples = 0;
+    crc_total      = 0;
+    crc_second     = 0;
+    chip_time      = 0;
+    start_time     = FramePacer::now();
+    return true;
+}
+
+void AudioRender::close()
+{
+    if (!file.is_open())
+        return;
+
+    const int64_t total_time = FramePacer::now() - start_time;
+
+    // Final partial second
+    if (second_samples)
+        print_crc(crc_second, second_samples);
+
+    const uint32_t data_bytes = samples * 2;
+
+    uint8_t header[WAV_HEADER_SIZE];
+    memcpy(header, "RIFF", 4);
+    write_le(header + 4, 36 + data_bytes, 4);
+    memcpy(header + 8, "WAVEfmt ", 8);
+    write_le(header + 16, 16, 4);                           // fmt chunk size
+    write_le(header + 20, 1, 2);                            // PCM
+    write_le(header + 22, CHANNELS, 2);
+    write_le(header + 24, FREQ, 4);
+    write_le(header + 28, FREQ * CHANNELS * 2, 4);          // Bytes per second
+    write_le(header + 32, CHANNELS * 2, 2);                 // Block align
+    write_le(header + 34, 16, 2);                           // Bits per sample
+    memcpy(header + 36, "data", 4);
+    write_le(header + 40, data_bytes, 4);
+
+    file.seekp(0, std::ios::beg);
+    file.write((const char*) header, WAV_HEADER_SIZE);
+    file.close();
+
+    const double seconds = (double) samples / (FREQ * CHANNELS);
+    const double total_s = total_time / 1000000000.0;
+    const double chip_s  = chip_time / 1000000000.0;
+
+    std::cout << "Audio total: " << std::hex << std::setfill('0') << std::setw(8) << crc_total
+              << std::dec << std::setfill(' ') << std::endl;
+    std::cout << std::fixed << std::setprecision(2);
+    std::cout << "Rendered " << seconds << "s of audio in " << total_s << "s";
+    if (total_s > 0) std::cout << " (" << seconds / total_s << "x real time)";
+    std::cout << std::endl;
+    std::cout << "Sound chips: " << chip_s << "s";
+    if (chip_s > 0) std::cout << " (" << seconds / chip_s << "x real time)";
+    std::cout << std::endl;
+}
+
+void AudioRender::tick()
+{
+    const int64_t chip_start = FramePacer::now();
+    osoundint.pcm->stream_update();
+    osoundint.ym->stream_update();
+    chip_time += FramePacer::now() - chip_start;
+
+    const int16_t* pcm_buffer = osoundint.pcm->get_buffer();
+    const int16_t* ym_buffer  = osoundint.ym->get_buffer();
+    const uint32_t count      = osoundint.pcm->buffer_size;
+
+    // Mix, as the audio device would be fed before resampling
+    data.resize(count * 2);
+    for (uint32_t i = 0; i < count; i++)
+    {
+        int32_t mix_data = pcm_buffer[i] + ym_buffer[i];
+
+        if (mix_data > 0x7FFF)
+            mix_data = 0x7FFF;
+        else if (mix_data < -0x8000)
+            mix_data = -0x8000;
+
+        write_le(&data[i * 2], (uint32_t) mix_data, 2);
+    }
+
+    file.write((const char*) &data[0], count * 2);
+    crc_total = Utils::crc32(&data[0], count * 2, crc_total);
+
+    // CRC each second of output
+    const uint32_t second = FREQ * CHANNELS;
+    for (uint32_t pos = 0; pos < count;)
+    {
+        uint32_t n = second - second_samples;
+        if (n > count - pos)
+            n = count - pos;
+
+        crc_second = Utils::crc32(&data[pos * 2], n * 2, crc_second);
+        second_samples += n;
+        samples        += n;
+        pos            += n;
+
+        if (second_samples == second)
+        {
+            print_crc(crc_second, second_samples);
+            crc_second     = 0;
+            second_samples = 0;
+        }
+    }
+}
+
+void AudioRender::print_crc(const uint32_t crc, const uint32_t count)
+{
+    // Seconds so far, including this one
+    const uint32_t elapsed = (samples + (FREQ * CHANNELS) - 1) / (FREQ * CHANNELS);
+
+    std::cout << "Audio " << std::setw(5) << elapsed << "s: " << std::hex << std::setfill('0') << std::setw(8) << crc
+              << std::dec << std::setfill(' ');
+    if (count != FREQ * CHANNELS)
+        std::cout << " (" << count / CHANNELS << " samples)";
+    std::cout << std::endl;
+}
@@ -0,0 +1,60 @@
+/***************************************************************************
+    Offline Audio Rendering.
+
+    Writes the mixed output of the SegaPCM and YM2151 to a WAV file, rather
+    than an audio device. Used with an input replay to run the game as fast
+    as possible (see --audio-render).
+
+    A CRC of each second of output is printed, so that changes to the sound
+    code can be checked to be bit exact. The time spent in the sound chips
+    is also reported, to benchmark them on their own.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <fstream>
+#include <vector>
+#include "stdint.hpp"
+
+class AudioRender
+{
+public:
+    AudioRender();
+    ~AudioRender();
+
+    bool open(const char* filename);
+
+    // Finish the WAV file and print the totals
+    void close();
+
+    bool is_open() const { return file.is_open(); }
+
+    // Mix the sound chip output for this frame and write it to the file
+    void tick();
+
+private:
+    // Output format of the sound chips
+    static const uint32_t FREQ     = 44100;
+    static const uint32_t CHANNELS = 2;
+
+    std::ofstream file;
+
+    // Little endian copy of the current frame
+    std::vector<uint8_t> data;
+
+    // Samples written in total, and in the current second
+    uint32_t samples;
+    uint32_t second_samples;
+
+    uint32_t crc_total;
+    uint32_t crc_second;
+
+    // Times (ns)
+    int64_t start_time;
+    int64_t chip_time;
+
+    void print_crc(const uint32_t crc, const uint32_t count);
+};
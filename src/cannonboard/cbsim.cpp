@@ -0,0 +1,482 @@
+/***************************************************************************
+    CannonBoard Simulator.
+
+    Stands in for a CannonBoard on a Linux pseudo terminal, so the serial
+    interface can be tested without a cabinet.
+
+    - Input packets are sent at a fixed rate, with message counters and
+      checksums. The wheel and pedals move slowly back and forth.
+    - Output packets are read and checked. Corrupt and missed packets are
+      reported back in the status byte, as the real board does.
+    - The motor output drives a simple model of the moving cabinet, which
+      is returned as the motor position and limit switches.
+
+    Usage:
+      cbsim [--rate hz]
+        Set cannonboard.port in config.xml to the pseudo terminal printed.
+
+      cbsim --bench [--rate hz] [--fps fps] [--seconds n]
+        Latency benchmark. Runs Interface against the simulator, in a loop
+        that calls get_packet() and write() once a frame, like the game.
+        The wheel position is written back as the motor output, so the time
+        from each input packet to the output carrying it can be measured.
+
+    Build with: make cbsim
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <vector>
+#include <algorithm>
+#include <cmath>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <csignal>
+
+#include <fcntl.h>
+#include <poll.h>
+#include <termios.h>
+#include <unistd.h>
+
+#include <boost/thread.hpp>
+
+#include "stdint.hpp"
+#include "framepacer.hpp"
+#include "cannonboard/interface.hpp"
+
+// Output packet: CBALL, message type, count, digital out, motor control, checksum
+static const int OUT_LENGTH = 10;
+
+// Message types
+static const uint8_t MSG_RESET  = 0;
+static const uint8_t MSG_OUTRUN = 1;
+
+// Motor position range
+static const int MOTOR_MIN    = 0x20;
+static const int MOTOR_MAX    = 0xE0;
+static const int MOTOR_CENTRE = 0x80;
+
+static volatile sig_atomic_t quit;
+
+static void on_signal(int)
+{
+    quit = 1;
+}
+
+class Simulator
+{
+public:
+    // Bench mode: The wheel carries the message count, and is expected back as the motor output
+    bool bench;
+
+    // Time each message count was sent (ns). 0 once matched.
+    int64_t sent[256];
+
+    // Input to output latencies (ns)
+    std::vector<int64_t> latencies;
+
+    // Counters
+    uint32_t packets_in, packets_timed, packets_out, errors_out, missed_out, resets;
+
+    Simulator();
+    ~Simulator();
+
+    bool open();
+    const char* port() const { return slave_name; }
+
+    // Send input packets at rate_hz until quit is set, or for a number of seconds (0 = forever)
+    void run(const int rate_hz, const int seconds);
+
+private:
+    int master;
+    int slave;
+    char slave_name[128];
+
+    // Outgoing packet state
+    uint8_t msg_count;
+    uint8_t status;
+    bool past_fail;
+
+    // Incoming packet assembly
+    uint8_t frame[OUT_LENGTH];
+    int frame_pos;
+    int16_t last_count;
+    uint8_t last_received;
+
+    // Outputs
+    uint8_t dig_out;
+    uint8_t mc_out;
+    int motor_pos;
+
+    void send(const double t);
+    void receive(const int64_t t);
+    void packet_received(const int64_t t);
+    void print_status();
+};
+
+Simulator::Simulator()
+{
+    master = -1;
+    slave  = -1;
+    slave_name[0] = 0;
+
+    bench         = false;
+    msg_count     = 0;
+    status        = 0;
+    past_fail     = false;
+    frame_pos     = 0;
+    last_count    = -1;
+    last_received = 0;
+    dig_out       = 0;
+    mc_out        = 0;
+    motor_pos     = MOTOR_CENTRE;
+
+    packets_in = packets_timed = packets_out = errors_out = missed_out = resets = 0;
+    memset(sent, 0, sizeof(sent));
+}
+
+Simulator::~Simulator()
+{
+    if (slave >= 0)  close(slave);
+    if (master >= 0) close(master);
+}
+
+bool Simulator::open()
+{
+    master = posix_openpt(O_RDWR | O_NOCTTY);
+    if (master < 0 || grantpt(master) != 0 || unlockpt(master) != 0 || ptsname(master) == NULL)
+    {
+        std::cerr << "Unable to create pseudo terminal" << std::endl;
+        return false;
+    }
+
+    snprintf(slave_name, sizeof(slave_name), "%s", ptsname(master));
+
+    // Hold the slave open, so reads on the master don't fail before the game connects.
+    // Raw mode, so the packets pass through untouched.
+    slave = ::open(slave_name, O_RDWR | O_NOCTTY);
+    if (slave < 0)
+    {
+        std::cerr << "Unable to open " << slave_name << std::endl;
+        return false;
+    }
+
+    termios tio;
+    tcgetattr(slave, &tio);
+    cfmakeraw(&tio);
+    tcsetattr(slave, TCSANOW, &tio);
+
+    return true;
+}
+
+void Simulator::run(const int rate_hz, const int seconds)
+{
+    const int64_t period = 1000000000LL / rate_hz;
+    const int64_t start  = FramePacer::now();
+    const int64_t end    = seconds > 0 ? start + (int64_t) seconds * 1000000000LL : 0;
+
+    int64_t next_send   = start;
+    int64_t next_status = start + 1000000000LL;
+
+    while (!quit && (end == 0 || FramePacer::now() < end))
+    {
+        int64_t t = FramePacer::now();
+
+        if (t >= next_send)
+        {
+            send((t - start) / 1000000000.0);
+            next_send += period;
+
+            // Don't try to catch up after a stall
+            if (next_send < t)
+                next_send = t + period;
+        }
+
+        if (!bench && t >= next_status)
+        {
+            print_status();
+            next_status += 1000000000LL;
+        }
+
+        // Wait for output packets until the next send is due
+        pollfd pfd;
+        pfd.fd     = master;
+        pfd.events = POLLIN;
+        t = FramePacer::now();
+        const int timeout_ms = next_send > t ? (int) ((next_send - t + 999999) / 1000000) : 0;
+
+        if (poll(&pfd, 1, timeout_ms) > 0 && (pfd.revents & POLLIN))
+            receive(FramePacer::now());
+    }
+}
+
+void Simulator::send(const double t)
+{
+    // Simulated controls
+    const uint8_t wheel = (uint8_t) (MOTOR_CENTRE + 0x40 * sin(t * 0.5));
+    const uint8_t accel = (uint8_t) (0x30 + 0x30 * (1.0 + sin(t * 0.3)));
+    const uint8_t brake = 0x30;
+
+    // Motor limit switches (see OOutputs::diag_motor).
+    // BIT_5 clears at the left hand limit, BIT_4 at the centre and BIT_3 at the right hand limit.
+    uint8_t mci = BIT_3 | BIT_4 | BIT_5;
+    if (motor_pos <= MOTOR_MIN)                 mci &= ~BIT_5;
+    if (motor_pos >= MOTOR_MAX)                 mci &= ~BIT_3;
+    if (abs(motor_pos - MOTOR_CENTRE) < 0x08)   mci &= ~BIT_4;
+
+    uint8_t packet[Packet::LENGTH] =
+    {
+        'C', 'B', 'A', 'L', 'L',
+        msg_count,
+        last_received,
+        (uint8_t) (status | (past_fail ? IncomingStatus::PAST_FAIL : 0)),
+        0,                                      // di1
+        mci,
+        accel,                                  // ai0
+        (uint8_t) motor_pos,                    // ai1
+        bench ? msg_count : wheel,              // ai2
+        brake,                                  // ai3
+        0                                       // checksum
+    };
+
+    uint8_t checksum = 0x55;
+    for (int i = 5; i < Packet::LENGTH - 1; i++)
+        checksum ^= packet[i];
+    packet[Packet::LENGTH - 1] = checksum;
+
+    // Until the first packet arrives, Interface reports a zeroed packet, so writes 0 as the motor output.
+    // Those writes don't carry the first message 0, so it isn't timed.
+    if (bench && packets_in > 0)
+    {
+        sent[msg_count] = FramePacer::now();
+        packets_timed++;
+    }
+
+    if (write(master, packet, Packet::LENGTH) != Packet::LENGTH)
+        std::cerr << "Write failed" << std::endl;
+
+    msg_count++;
+    packets_in++;
+
+    // Status only reports what has happened since the last packet
+    status = 0;
+}
+
+void Simulator::receive(const int64_t t)
+{
+    uint8_t data[256];
+    const ssize_t len = read(master, data, sizeof(data));
+
+    for (ssize_t i = 0; i < len; i++)
+    {
+        const uint8_t byte = data[i];
+
+        // Match the CBALL header
+        if (frame_pos < 5)
+        {
+            if (byte == "CBALL"[frame_pos])
+                frame[frame_pos++] = byte;
+            else
+                frame_pos = (byte == 'C') ? 1 : 0;
+            continue;
+        }
+
+        frame[frame_pos++] = byte;
+
+        if (frame_pos == OUT_LENGTH)
+        {
+            frame_pos = 0;
+            packet_received(t);
+        }
+    }
+}
+
+void Simulator::packet_received(const int64_t t)
+{
+    const uint8_t type  = frame[5];
+    const uint8_t count = frame[6];
+
+    uint8_t checksum = 0x55;
+    for (int i = 5; i < OUT_LENGTH - 1; i++)
+        checksum ^= frame[i];
+
+    status |= IncomingStatus::FOUND;
+
+    if (checksum != frame[OUT_LENGTH - 1])
+    {
+        status   &= ~IncomingStatus::CSUM;
+        past_fail = true;
+        errors_out++;
+        return;
+    }
+
+    status |= IncomingStatus::CSUM;
+    last_received = count;
+    packets_out++;
+
+    if (type == MSG_RESET)
+    {
+        status    |= IncomingStatus::RESET;
+        last_count = -1;
+        resets++;
+        return;
+    }
+
+    // Message counter should go up by one each time
+    if (last_count >= 0 && count != (uint8_t) (last_count + 1))
+    {
+        status |= IncomingStatus::MISSED;
+        missed_out++;
+    }
+    last_count = count;
+
+    dig_out = frame[7];
+    mc_out  = frame[8];
+
+    if (bench)
+    {
+        // First output carrying this input
+        if (sent[mc_out])
+        {
+            latencies.push_back(t - sent[mc_out]);
+            sent[mc_out] = 0;
+        }
+    }
+    else if (mc_out != 0)
+    {
+        // Motor: 0x5 moves right, 0x8 holds, 0xB moves left (see OOutputs)
+        motor_pos += 8 - (mc_out & 0xF);
+        motor_pos  = std::max(MOTOR_MIN, std::min(MOTOR_MAX, motor_pos));
+    }
+}
+
+void Simulator::print_status()
+{
+    std::cout << "In: " << packets_in << "  Out: " << packets_out << "  Errors: " << errors_out
+              << "  Missed: " << missed_out << "  Resets: " << resets
+              << "  Digital: 0x" << std::hex << std::setfill('0') << std::setw(2) << (int) dig_out
+              << "  Motor: 0x" << std::setw(1) << (int) mc_out
+              << std::dec << std::setfill(' ') << "  Position: " << motor_pos << std::endl;
+}
+
+// ------------------------------------------------------------------------------------------------
+// Latency Benchmark
+// ------------------------------------------------------------------------------------------------
+
+static volatile bool bench_running;
+
+// Poll the interface and write the outputs once a frame, as the game does
+static void bench_game(Interface* cannonboard, const int fps)
+{
+    FramePacer pacer;
+    pacer.start();
+
+    while (bench_running)
+    {
+        Packet* packet = cannonboard->get_packet();
+        cannonboard->write(packet->di1, packet->ai2);
+
+        pacer.advance(1000.0 / fps);
+        pacer.limit_lag(0);
+        pacer.wait();
+    }
+}
+
+static void print_latency(std::vector<int64_t>& latencies, const uint32_t sent)
+{
+    if (latencies.empty())
+    {
+        std::cout << "No packets were returned" << std::endl;
+        return;
+    }
+
+    std::sort(latencies.begin(), latencies.end());
+
+    double sum = 0;
+    for (size_t i = 0; i < latencies.size(); i++)
+        sum += latencies[i];
+
+    const size_t n = latencies.size();
+
+    std::cout << std::fixed << std::setprecision(3);
+    std::cout << "Input to output latency: " << n << " of " << sent << " packets returned" << std::endl;
+    std::cout << "  Mean    " << sum / n / 1000000.0 << "ms" << std::endl;
+    std::cout << "  Min     " << latencies[0] / 1000000.0 << "ms" << std::endl;
+    std::cout << "  P50     " << latencies[n / 2] / 1000000.0 << "ms" << std::endl;
+    std::cout << "  P99     " << latencies[std::min(n - 1, (n * 99) / 100)] / 1000000.0 << "ms" << std::endl;
+    std::cout << "  Max     " << latencies[n - 1] / 1000000.0 << "ms" << std::endl;
+}
+
+int main(int argc, char* argv[])
+{
+    bool bench  = false;
+    int rate    = 60;
+    int fps     = 60;
+    int seconds = 10;
+
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--bench") == 0)
+            bench = true;
+        else if (strcmp(argv[i], "--rate") == 0 && i + 1 < argc)
+            rate = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--fps") == 0 && i + 1 < argc)
+            fps = std::max(1, atoi(argv[++i]));
+        else if (strcmp(argv[i], "--seconds") == 0 && i + 1 < argc)
+            seconds = std::max(1, atoi(argv[++i]));
+        else
+        {
+            std::cerr << "Usage: cbsim [--rate hz]" << std::endl;
+            std::cerr << "       cbsim --bench [--rate hz] [--fps fps] [--seconds n]" << std::endl;
+            return 1;
+        }
+    }
+
+    signal(SIGINT, on_signal);
+    signal(SIGTERM, on_signal);
+
+    Simulator sim;
+    sim.bench = bench;
+    if (!sim.open())
+        return 1;
+
+    if (!bench)
+    {
+        std::cout << "CannonBoard simulator on " << sim.port() << " at " << rate << "Hz" << std::endl;
+        sim.run(rate, 0);
+        return 0;
+    }
+
+    std::cout << "Benchmark: " << rate << "Hz input, " << fps << "fps, " << seconds << "s" << std::endl;
+
+    Interface cannonboard;
+    cannonboard.init(sim.port(), 57600);
+    cannonboard.start();
+    if (!cannonboard.started())
+    {
+        std::cerr << "Unable to start interface on " << sim.port() << std::endl;
+        return 1;
+    }
+
+    bench_running = true;
+    boost::thread game(boost::bind(bench_game, &cannonboard, fps));
+
+    sim.run(rate, seconds);
+
+    bench_running = false;
+    game.join();
+
+    cannonboard.stop();
+    cannonboard.close();
+
+    print_latency(sim.latencies, sim.packets_timed);
+    std::cout << "Interface: " << cannonboard.stats_found_in << " found, " << cannonboard.stats_notfound_in << " not found, "
+              << cannonboard.stats_error_in << " checksum errors" << std::endl;
+    std::cout << "Simulator: " << sim.packets_out << " outputs, " << sim.errors_out << " checksum errors, "
+              << sim.missed_out << " missed" << std::endl;
+    return 0;
+}
@@ -7,6 +7,7 @@
 
 #include "interface.hpp"
 #ifdef CANNONBOARD
+#include <iostream>
 #include "asyncserial.hpp"
 
 // ----------------------------------------------------------------------------
@@ -48,12 +49,14 @@ void Interface::init(const std::string& port, unsigned int baud)
         // Setup Serial Port
         serial = new CallbackAsyncSerial(port, baud);
 
-        // Reset Circular Array
-        memset(&buffer, 0, BUFFER_SIZE);
-        head = 0;
+        // Reset Packet Assembly
+        frame_pos = 0;
 
-        // Reset Packet
-        memset(&packet, 0, sizeof(packet));
+        // Reset Packets
+        memset(slots, 0, sizeof(slots));
+        back   = 0;
+        front  = 1;
+        latest = 2;
     }
     catch (boost::system::system_error& e)
     {
@@ -120,20 +123,13 @@ bool Interface::started()
         return false;
 }
 
+// Returns the newest packet. Never blocks: the previous packet is returned if nothing new has arrived.
 Packet* Interface::get_packet()
 {
-    boost::lock_guard<boost::mutex> guard(mtx);
-    
-    packet_copy.status = packet.status;
-    packet_copy.di1    = packet.di1;
-    packet_copy.di2    = packet.di2;
-    packet_copy.mci    = packet.mci;
-    packet_copy.ai0    = packet.ai0;
-    packet_copy.ai1    = packet.ai1;
-    packet_copy.ai2    = packet.ai2;
-    packet_copy.ai3    = packet.ai3;
-
-    return &packet_copy;
+    if (latest.load() & FRESH)
+        front = latest.exchange(front) & 3;
+
+    return &slots[front];
 }
 
 void Interface::write(uint8_t dig_out, uint8_t mc_out)
@@ -181,138 +177,97 @@ void Interface::reset_interface()
 
 void Interface::received(const char *data, unsigned int len)
 {
-    int32_t new_head = head + len;
+    bool found = false;
 
-    // Copy directly into circular array
-    if (new_head < BUFFER_SIZE)
-    {
-        memcpy(buffer + head, data, len);
-    }
-    // Spanned the join of the circular array
-    else
+    for (unsigned int i = 0; i < len; i++)
     {
-        int len1 = len - (new_head - BUFFER_SIZE);
-        int len2 = len - len1;
-        memcpy(buffer + head, data, len1);
-        memcpy(buffer, data + len1, len2);
-    }
+        const uint8_t byte = data[i];
 
-    // Increment Head Position
-    head = c_add(head, len);
+        // Match the CBALL header
+        if (frame_pos < HEADER_LENGTH)
+        {
+            if (byte == "CBALL"[frame_pos])
+                frame[frame_pos++] = byte;
+            else
+                frame_pos = (byte == 'C') ? 1 : 0;
+            continue;
+        }
 
-    // Find Most Recent Packet
-    int packet_index = find_packet();
-    if (packet_index >= 0) // Checksum OK, Packet Found
-    {
-        if (DEBUG) std::cout << "Packet Found: " << packet_index << std::endl;
+        frame[frame_pos++] = byte;
 
-        uint8_t msg_count = c_get(packet_index);
-        
-        // New Packet
-        if (msg_count != prev_msg)
+        // Packet Complete
+        if (frame_pos == Packet::LENGTH)
         {
-            boost::lock_guard<boost::mutex> guard(mtx);
-
-            prev_msg            = msg_count;
-            packet.msg_count    = msg_count;
-            packet.msg_received = c_get(++packet_index);
-            packet.status       = c_get(++packet_index);
-            packet.di1          = c_get(++packet_index);
-            packet.mci          = c_get(++packet_index);
-            packet.ai0          = c_get(++packet_index);
-            packet.ai1          = c_get(++packet_index);
-            packet.ai2          = c_get(++packet_index);
-            packet.ai3          = c_get(++packet_index);
-            stats_found_in++;
-
-            // If not resetting, do stats
-            if ((packet.status & IncomingStatus::RESET) == 0)
+            frame_pos = 0;
+            found     = true;
+
+            if (is_checksum_ok())
             {
-                // Stats on previous sent packet
-                if ((packet.status & IncomingStatus::CSUM) == 0)
-                    stats_error_out++;
-                else
-                    stats_found_out++;
-
-                if (packet.status & IncomingStatus::MISSED)
-                    stats_missed_out++;
+                if (DEBUG) std::cout << "Packet Found" << std::endl;
+                publish_packet();
+            }
+            else
+            {
+                if (DEBUG) std::cout << "Checksum Error" << std::endl;
+                stats_error_in++;
             }
         }
     }
-    else if (packet_index == PACKET_NOT_FOUND)
+
+    if (!found)
     {
         if (DEBUG) std::cout << "Packet Not Found" << std::endl;
         stats_notfound_in++;
     }
-    else if (packet_index == CHECKSUM_ERROR)
-    {
-        if (DEBUG) std::cout << "Checksum Error" << std::endl;
-        stats_error_in++;
-    }
 }
 
-int Interface::find_packet()
+// Pass a complete packet to the game thread
+void Interface::publish_packet()
 {
-    // Start by searching back at least one full packet length
-    int index  = c_sub(head, Packet::LENGTH);
-
-    for (int i = 0; i < BUFFER_SIZE; i++)
+    const uint8_t msg_count = frame[HEADER_LENGTH];
+
+    // Already seen
+    if (msg_count == prev_msg)
+        return;
+
+    Packet* packet = &slots[back];
+
+    prev_msg             = msg_count;
+    packet->msg_count    = msg_count;
+    packet->msg_received = frame[HEADER_LENGTH + 1];
+    packet->status       = frame[HEADER_LENGTH + 2];
+    packet->di1          = frame[HEADER_LENGTH + 3];
+    packet->mci          = frame[HEADER_LENGTH + 4];
+    packet->ai0          = frame[HEADER_LENGTH + 5];
+    packet->ai1          = frame[HEADER_LENGTH + 6];
+    packet->ai2          = frame[HEADER_LENGTH + 7];
+    packet->ai3          = frame[HEADER_LENGTH + 8];
+    stats_found_in++;
+
+    // If not resetting, do stats
+    if ((packet->status & IncomingStatus::RESET) == 0)
     {
-        if (buffer[c_add(index, 0)] == 'C' && 
-            buffer[c_add(index, 1)] == 'B' && 
-            buffer[c_add(index, 2)] == 'A' && 
-            buffer[c_add(index, 3)] == 'L' &&
-            buffer[c_add(index, 4)] == 'L')
-        {
-            int address = c_add(index, 5);
-            if (is_checksum_ok(address))
-                return address;
-            else
-                return CHECKSUM_ERROR;
-        }
-
-        if (--index < 0)
-            index += BUFFER_SIZE;
+        // Stats on previous sent packet
+        if ((packet->status & IncomingStatus::CSUM) == 0)
+            stats_error_out++;
+        else
+            stats_found_out++;
+
+        if (packet->status & IncomingStatus::MISSED)
+            stats_missed_out++;
     }
-    return PACKET_NOT_FOUND;
-}
-
-bool Interface::is_checksum_ok(int offset)
-{
-    uint8_t check = 0x55;
-
-    for (int i = 0; i < 9; i++)
-    {
-        check ^= buffer[offset];
 
-        if (++offset >= BUFFER_SIZE)
-            offset = 0;
-    }
-    return check == buffer[offset];
+    // Make it the newest packet, and take the old one to fill next time
+    back = latest.exchange(back | FRESH) & 3;
 }
 
-// ------------------------------------------------------------------------------------------------
-// Circular Buffer Functions
-// ------------------------------------------------------------------------------------------------
-
-uint8_t Interface::c_get(int i)
+bool Interface::is_checksum_ok()
 {
-    return buffer[i % BUFFER_SIZE];
-}
+    uint8_t check = 0x55;
 
-int Interface::c_add(int a, int b)
-{    
-    int value = a + b;
-    if (value >= BUFFER_SIZE)
-        value -= BUFFER_SIZE;
-    return value;
-}
+    for (int i = HEADER_LENGTH; i < Packet::LENGTH - 1; i++)
+        check ^= frame[i];
 
-int Interface::c_sub(int a, int b)
-{
-    int value = a - b;
-    if (value < 0)
-        value += BUFFER_SIZE;
-    return value;
+    return check == frame[Packet::LENGTH - 1];
 }
-#endif
\ No newline at end of file
+#endif
@@ -11,7 +11,7 @@
 #include <string>
 
 #ifdef CANNONBOARD
-#include <boost/thread/mutex.hpp>
+#include <boost/atomic.hpp>
 #endif
 
 class CallbackAsyncSerial;
@@ -78,25 +78,24 @@ public:
 private:
     const static bool DEBUG = false;
 
-    // Mutex Declaration
-    boost::mutex mtx;
-
     // Serial Port Handler
     CallbackAsyncSerial* serial;
 
-    // Circular Array Buffer
-    const static int BUFFER_SIZE = 1024;
-    uint8_t buffer[BUFFER_SIZE];
-    int32_t head;
+    // Incoming packet, assembled a byte at a time as data arrives. Serial thread only.
+    const static int HEADER_LENGTH = 5;
+    uint8_t frame[Packet::LENGTH];
+    int frame_pos;
+
+    // Triple buffered packets, passed from the serial thread to the game thread without a lock.
+    // The serial thread fills slots[back], and the game thread reads slots[front].
+    // The third slot holds the newest packet, and is swapped with back or front.
+    Packet slots[3];
+    int back;
+    int front;
 
-    // Packet storage
-    Packet packet;
-    Packet packet_copy;
-    enum
-    {
-        PACKET_NOT_FOUND = -1,
-        CHECKSUM_ERROR   = -2,
-    };
+    // Index of the third slot. FRESH is set when it holds a packet the game thread hasn't taken.
+    const static int FRESH = 4;
+    boost::atomic<int> latest;
 
     // Message Types
     const static uint8_t MSG_RESET  = 0;
@@ -113,12 +112,8 @@ private:
 
     void reset_interface();
     void received(const char *data, unsigned int len);
-    int find_packet();
-    bool is_checksum_ok(int offset);
-
-    uint8_t c_get(int i);
-    int c_add(int a, int b);
-    int c_sub(int a, int b);
+    void publish_packet();
+    bool is_checksum_ok();
 #endif
 };
 
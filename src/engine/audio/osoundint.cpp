@@ -12,14 +12,16 @@
 #include "engine/outrun.hpp"
 #include "engine/audio/osound.hpp"
 #include "engine/audio/osoundint.hpp"
+#include "framepacer.hpp" // now()
 
-OSoundInt osoundint;
-OSound osound;
+ENGINE_LOCAL OSoundInt osoundint;
+ENGINE_LOCAL OSound osound;
 
 OSoundInt::OSoundInt()
 {
     pcm_ram = new uint8_t[PCM_RAM_SIZE];
     has_booted = false;
+    latency_mark = 0;
 }
 
 OSoundInt::~OSoundInt()
@@ -158,6 +160,9 @@ void OSoundInt::queue_sound(uint8_t snd)
 
 void OSoundInt::add_to_queue(uint8_t snd)
 {
+    if (latency_mark == 0)
+        latency_mark = FramePacer::now();
+
     // Add sound to the tail end of the queue
     queue[sound_tail] = snd;
     sound_tail = (sound_tail + 1) & QUEUE_LENGTH;
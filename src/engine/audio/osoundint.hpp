@@ -11,6 +11,7 @@
 
 #pragma once
 
+#include "globals.hpp"
 #include "hwaudio/segapcm.hpp"
 #include "hwaudio/ym2151.hpp"
 #include "engine/audio/commands.hpp"
@@ -39,6 +40,10 @@ public:
     // [+7] Traffic data #4
     uint8_t engine_data[8];
 
+    // Time the first sound was queued since the audio code last checked (ns). 0 = None.
+    // Used to measure audio latency.
+    int64_t latency_mark;
+
     OSoundInt();
     ~OSoundInt();
 
@@ -73,4 +78,4 @@ private:
     void add_to_queue(uint8_t snd);
 };
 
-extern OSoundInt osoundint;
\ No newline at end of file
+extern ENGINE_LOCAL OSoundInt osoundint;
\ No newline at end of file
@@ -37,7 +37,7 @@
 //                     (Before Incrementing To Next Block Of 8 Bytes)
 // ----------------------------------------------------------------------------
 
-OAnimSeq oanimseq;
+ENGINE_LOCAL OAnimSeq oanimseq;
 
 OAnimSeq::OAnimSeq(void)
 {
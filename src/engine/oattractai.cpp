@@ -45,7 +45,7 @@
 #include "engine/ostats.hpp"
 #include "engine/otraffic.hpp"
 
-OAttractAI oattractai;
+ENGINE_LOCAL OAttractAI oattractai;
 
 OAttractAI::OAttractAI(void)
 {
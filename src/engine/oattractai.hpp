@@ -59,4 +59,4 @@ private:
     void set_steering();
 };
 
-extern OAttractAI oattractai;
+extern ENGINE_LOCAL OAttractAI oattractai;
@@ -12,7 +12,7 @@
 #include "engine/outils.hpp"
 #include "engine/obonus.hpp"
 
-OBonus obonus;
+ENGINE_LOCAL OBonus obonus;
 
 OBonus::OBonus(void)
 {
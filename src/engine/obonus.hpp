@@ -68,5 +68,5 @@ private:
     void decrement_bonus_secs();
 };
 
-extern OBonus obonus;
+extern ENGINE_LOCAL OBonus obonus;
 
@@ -27,7 +27,7 @@
 #include "engine/outils.hpp"
 #include "engine/ocrash.hpp"
 
-OCrash ocrash;
+ENGINE_LOCAL OCrash ocrash;
 
 OCrash::OCrash(void)
 {
@@ -29,7 +29,7 @@
 #include "engine/outils.hpp"
 #include "engine/oferrari.hpp"
 
-OFerrari oferrari;
+ENGINE_LOCAL OFerrari oferrari;
 
 OFerrari::OFerrari(void)
 {
@@ -14,7 +14,7 @@
 #include "engine/outils.hpp"
 #include "engine/ohiscore.hpp"
 
-OHiScore ohiscore;
+ENGINE_LOCAL OHiScore ohiscore;
 
 OHiScore::OHiScore(void)
 {
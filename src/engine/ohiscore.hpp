@@ -130,4 +130,4 @@ private:
     void convert_lap_time(uint16_t);
 };
 
-extern OHiScore ohiscore;
\ No newline at end of file
+extern ENGINE_LOCAL OHiScore ohiscore;
\ No newline at end of file
@@ -20,7 +20,7 @@
 #include "engine/ooutputs.hpp"
 #include "engine/ostats.hpp"
 
-OHud ohud;
+ENGINE_LOCAL OHud ohud;
 
 OHud::OHud(void)
 {
@@ -76,10 +76,17 @@ void OHud::clear_timetrial_text()
     blit_text_new(16, 7, "            ");
 }
 
-void OHud::draw_fps_counter(int16_t fps)
+// Draw FPS Counter, optionally preceded by the percentage of frames not drawn
+void OHud::draw_fps_counter(int16_t fps, int16_t skip)
 {
-    std::string str = "FPS " + Utils::to_string(fps);
+    std::string str = "FPS " + Utils::to_string(fps) + " ";
     blit_text_new(30, 0, str.c_str());
+
+    if (skip >= 0)
+    {
+        str = "SKIP " + Utils::to_string(skip) + "% ";
+        blit_text_new(20, 0, str.c_str());
+    }
 }
 
 
@@ -34,7 +34,7 @@ public:
     ~OHud(void);
 
     void draw_main_hud();
-    void draw_fps_counter(int16_t);
+    void draw_fps_counter(int16_t fps, int16_t skip = -1);
     void clear_timetrial_text();
     void do_mini_map();
     void draw_timer1(uint16_t);
@@ -63,4 +63,4 @@ private:
     void draw_mini_map(uint32_t);
 };
 
-extern OHud ohud;
\ No newline at end of file
+extern ENGINE_LOCAL OHud ohud;
\ No newline at end of file
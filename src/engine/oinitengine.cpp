@@ -30,7 +30,7 @@
 #include "engine/otraffic.hpp"
 #include "engine/oinitengine.hpp"
 
-OInitEngine oinitengine;
+ENGINE_LOCAL OInitEngine oinitengine;
 
 // Continuous Mode Level Ordering
 const static uint8_t CONTINUOUS_LEVELS[] = {0, 0x8, 0x9, 0x10, 0x11, 0x12, 0x18, 0x19, 0x1A, 0x1B, 0x20, 0x21, 0x22, 0x23, 0x24};
@@ -150,23 +150,22 @@ void OInitEngine::init_road_seg_master()
 void OInitEngine::update_road()
 {
     check_road_split(); // Check/Process road split if necessary
-    uint32_t addr = 0;
-    uint16_t d0 = trackloader.read_width_height(&addr);
+    uint16_t d0 = trackloader.read_wh_pos();
     // Update next road section
     if (d0 <= oroad.road_pos >> 16)
     {
         // Skip road width adjustment if set and adjust height
-        if (trackloader.read_width_height(&addr) == 0)
+        if (trackloader.read_wh_mode() == 0)
         {
             // ROM:0000B8A6 skip_next_width
             if (oroad.height_lookup == 0)
-                 oroad.height_lookup = trackloader.read_width_height(&addr); // Set new height lookup section
+                 oroad.height_lookup = trackloader.read_wh_value(); // Set new height lookup section
         }
         else
         {
             // ROM:0000B87A
-            int16_t width  = trackloader.read_width_height(&addr); // Segment road width
-            int16_t change = trackloader.read_width_height(&addr); // Segment adjustment speed
+            int16_t width  = trackloader.read_wh_value();  // Segment road width
+            int16_t change = trackloader.read_wh_change(); // Segment adjustment speed
 
             if (width != (int16_t) (oroad.road_width >> 16))
             {
@@ -178,7 +177,7 @@ void OInitEngine::update_road()
                 change_width = -1; // Denote road width is changing
             }
         }
-        trackloader.wh_offset += 8;
+        trackloader.wh_index++;
     }
 
     // ROM:0000B8BC set_road_width    
@@ -221,7 +220,7 @@ void OInitEngine::update_road()
 
     // ROM:0000B91C set_road_type: 
 
-    int16_t segment_pos = trackloader.read_curve(0);
+    int16_t segment_pos = trackloader.read_curve_pos();
 
     if (segment_pos != -1)
     {
@@ -229,15 +228,15 @@ void OInitEngine::update_road()
 
         if (d1 <= (int16_t) (oroad.road_pos >> 16))
         {
-            road_curve_next = trackloader.read_curve(2);
-            road_type_next  = trackloader.read_curve(4);
+            road_curve_next = trackloader.read_curve();
+            road_type_next  = trackloader.read_curve_type();
         }
 
         if (segment_pos <= (int16_t) (oroad.road_pos >> 16))
         {
-            road_curve = trackloader.read_curve(2);
-            road_type  = trackloader.read_curve(4);
-            trackloader.curve_offset += 6;
+            road_curve = trackloader.read_curve();
+            road_type  = trackloader.read_curve_type();
+            trackloader.curve_index++;
             road_type_next = 0;
             road_curve_next = 0;
         }
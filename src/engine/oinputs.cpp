@@ -16,7 +16,7 @@
 
 #include "cannonboard/interface.hpp"
 
-OInputs oinputs;
+ENGINE_LOCAL OInputs oinputs;
 
 OInputs::OInputs(void)
 {
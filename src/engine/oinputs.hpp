@@ -100,4 +100,4 @@ private:
     void digital_pedals();
 };
 
-extern OInputs oinputs;
+extern ENGINE_LOCAL OInputs oinputs;
@@ -19,7 +19,7 @@
 #include "engine/olevelobjs.hpp"
 #include "engine/ostats.hpp"
 
-OLevelObjs olevelobjs;
+ENGINE_LOCAL OLevelObjs olevelobjs;
 
 OLevelObjs::OLevelObjs(void)
 {
@@ -48,4 +48,4 @@ private:
 	void sprite_logo_text();
 };
 
-extern OLogo ologo;
\ No newline at end of file
+extern ENGINE_LOCAL OLogo ologo;
\ No newline at end of file
@@ -18,7 +18,7 @@
 #include "engine/otraffic.hpp"
 #include "engine/ostats.hpp"
 
-OMap omap;
+ENGINE_LOCAL OMap omap;
 
 // Position of Ferrari in Jump Table
 const uint8_t SPRITE_FERRARI = 25;
@@ -91,4 +91,4 @@ private:
     void move_mini_car(oentry*);  ;
 };
 
-extern OMap omap;
\ No newline at end of file
+extern ENGINE_LOCAL OMap omap;
\ No newline at end of file
@@ -16,7 +16,7 @@
 #include "engine/otraffic.hpp"
 #include "engine/ostats.hpp"
 
-OMusic omusic;
+ENGINE_LOCAL OMusic omusic;
 
 OMusic::OMusic(void)
 {
@@ -49,5 +49,5 @@ private:
     void blit_music_select();
 };
 
-extern OMusic omusic;
+extern ENGINE_LOCAL OMusic omusic;
 
@@ -13,7 +13,7 @@
 #include "engine/oinputs.hpp"
 #include "engine/opalette.hpp"
 
-OPalette opalette;
+ENGINE_LOCAL OPalette opalette;
 
 OPalette::OPalette(void)
 {
@@ -30,7 +30,7 @@
 #include "engine/oroad.hpp"
 #include "engine/ostats.hpp"
 
-ORoad oroad;
+ENGINE_LOCAL ORoad oroad;
 
 ORoad::ORoad(void)
 {
@@ -322,10 +322,9 @@ void ORoad::setup_road_x()
     if (road_pos_change != 0)
     {
         road_data_offset = (road_pos >> 16) << 2;
-        //uint32_t addr = stage_addr + road_data_offset;
-        uint32_t addr = road_data_offset; // temporary hack for custom data
-        set_tilemap_x(addr);
-        setup_x_data(addr);
+        const uint32_t pos = road_pos >> 16; // Index into compiled road path
+        set_tilemap_x(pos);
+        setup_x_data(pos);
     }
     setup_hscroll();
 }
@@ -336,10 +335,10 @@ void ORoad::setup_road_x()
 //
 // Source Address: 0x15B0
 
-void ORoad::setup_x_data(uint32_t addr)
+void ORoad::setup_x_data(uint32_t pos)
 {
-    const int16_t x = trackloader.readPath(addr)     + trackloader.readPath(addr + 4); // Length 1
-    const int16_t y = trackloader.readPath(addr + 2) + trackloader.readPath(addr + 6); // Length 2
+    const int16_t x = trackloader.read_path_x(pos) + trackloader.read_path_x(pos + 1); // Length 1
+    const int16_t y = trackloader.read_path_y(pos) + trackloader.read_path_y(pos + 1); // Length 2
 
     // Use Pythagorus' theorem to find the distance/length between x & y
     const uint16_t distance = outils::isqrt((x * x) + (y * y));
@@ -370,9 +369,9 @@ void ORoad::setup_x_data(uint32_t addr)
     // We sample 20 Road Positions to generate the road.
     for (uint8_t i = 0; i <= 0x20; i++)
     {
-        const int32_t x_next = trackloader.readPath(addr)     + trackloader.readPath(addr + 4); // Length 1
-        const int32_t y_next = trackloader.readPath(addr + 2) + trackloader.readPath(addr + 6); // Length 2
-        addr += 8;
+        const int32_t x_next = trackloader.read_path_x(pos) + trackloader.read_path_x(pos + 1); // Length 1
+        const int32_t y_next = trackloader.read_path_y(pos) + trackloader.read_path_y(pos + 1); // Length 2
+        pos += 2;
 
         curve_x_total += x_next;
         curve_y_total += y_next;
@@ -426,19 +425,15 @@ void ORoad::create_curve(
 // Use Euclidean distance between a series of points.
 // This is essentially the standard distance that you'd measure with a ruler.
 
-void ORoad::set_tilemap_x(uint32_t addr)
+void ORoad::set_tilemap_x(uint32_t pos)
 {    
     // d0 = Word 0 + Word 2 + Word 4 + Word 6 [Next 4 x positions]
     // d1 = Word 1 + Word 3 + Word 5 + Word 7 [Next 4 y positions]
     
-    int16_t x = trackloader.readPath(&addr);
-    int16_t y = trackloader.readPath(&addr);
-    x += trackloader.readPath(&addr);
-    y += trackloader.readPath(&addr);
-    x += trackloader.readPath(&addr);
-    y += trackloader.readPath(&addr);
-    x += trackloader.readPath(&addr);
-    y += trackloader.readPath(&addr);
+    int16_t x = trackloader.read_path_x(pos)     + trackloader.read_path_x(pos + 1) +
+                trackloader.read_path_x(pos + 2) + trackloader.read_path_x(pos + 3);
+    int16_t y = trackloader.read_path_y(pos)     + trackloader.read_path_y(pos + 1) +
+                trackloader.read_path_y(pos + 2) + trackloader.read_path_y(pos + 3);
 
     int16_t x_abs = x;
     int16_t y_abs = y;
@@ -318,4 +318,4 @@ private:
 	void copy_bg_color();
 };
 
-extern ORoad oroad;
\ No newline at end of file
+extern ENGINE_LOCAL ORoad oroad;
\ No newline at end of file
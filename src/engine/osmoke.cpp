@@ -12,7 +12,7 @@
 #include "engine/olevelobjs.hpp"
 #include "engine/osmoke.hpp"
 
-OSmoke osmoke;
+ENGINE_LOCAL OSmoke osmoke;
 
 OSmoke::OSmoke(void)
 {
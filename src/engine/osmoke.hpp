@@ -37,4 +37,4 @@ private:
     void tick_smoke_anim(oentry*, int8_t, uint32_t);
 };
 
-extern OSmoke osmoke;
\ No newline at end of file
+extern ENGINE_LOCAL OSmoke osmoke;
\ No newline at end of file
@@ -22,7 +22,7 @@
 #include "engine/otraffic.hpp"
 #include "engine/ozoom_lookup.hpp"
 
-OSprites osprites;
+ENGINE_LOCAL OSprites osprites;
 
 OSprites::OSprites(void)
 {
@@ -218,7 +218,7 @@ void OSprites::sprite_control()
         seg_pos = pos;                                                          // Position In Level Data [Word]
         seg_total_sprites = trackloader.read_total_sprites();                   // Number of Sprites In Segment
         uint8_t pattern_index = trackloader.read_sprite_pattern_index();        // Block Of Sprites
-        trackloader.scenery_offset += 4;                                        // Advance to next scenery point
+        trackloader.scenery_index++;                                            // Advance to next scenery point
         
         uint32_t a0 = trackloader.read_scenerymap_table(pattern_index);         // Get Address of Scenery Pattern
         seg_sprite_freq = trackloader.read16(trackloader.scenerymap_data, &a0); // Scenery Frequency
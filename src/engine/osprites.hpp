@@ -179,4 +179,4 @@ private:
 	void finalise_sprites();
 };
 
-extern OSprites osprites;
+extern ENGINE_LOCAL OSprites osprites;
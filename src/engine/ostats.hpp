@@ -105,4 +105,4 @@ private:
     void inc_lap_timer();
 };
 
-extern OStats ostats;
+extern ENGINE_LOCAL OStats ostats;
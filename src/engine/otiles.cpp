@@ -15,7 +15,7 @@
 #include "engine/opalette.hpp"
 #include "engine/otiles.hpp"
 
-OTiles otiles;
+ENGINE_LOCAL OTiles otiles;
 
 OTiles::OTiles(void)
 {
@@ -19,7 +19,7 @@
 #include "engine/ostats.hpp"
 #include "engine/otraffic.hpp"
 
-OTraffic otraffic;
+ENGINE_LOCAL OTraffic otraffic;
 
 OTraffic::OTraffic(void)
 {
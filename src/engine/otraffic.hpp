@@ -97,4 +97,4 @@ private:
     void check_collision(oentry* sprite);
 };
 
-extern OTraffic otraffic;
\ No newline at end of file
+extern ENGINE_LOCAL OTraffic otraffic;
\ No newline at end of file
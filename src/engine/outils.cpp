@@ -27,13 +27,19 @@ outils::~outils(void)
 // Output:         Long Random
 
 // Seed for random number generator
-static uint32_t rnd_seed = 0;
+static ENGINE_LOCAL uint32_t rnd_seed = 0;
 
 void outils::reset_random_seed()
 {
     rnd_seed = 0;
 }
 
+// Note: A seed of 0 falls back to the default behaviour (see config.engine.randomgen)
+void outils::set_random_seed(uint32_t seed)
+{
+    rnd_seed = seed;
+}
+
 uint32_t outils::random()
 {
 	// New seed value
@@ -21,6 +21,7 @@ public:
 	~outils();
 
     static void reset_random_seed();
+    static void set_random_seed(uint32_t seed);
 	static uint32_t random();
 	static int32_t isqrt(int32_t);
     static uint16_t convert16_dechex(uint16_t);
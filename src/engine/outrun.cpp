@@ -33,7 +33,7 @@
 #include "engine/outils.hpp"
 #include "cannonboard/interface.hpp"
 
-Outrun outrun;
+ENGINE_LOCAL Outrun outrun;
 
 /*
     Known Core Engine Issues:
@@ -154,7 +154,7 @@ void Outrun::tick(Packet* packet, bool tick_frame)
 
     // Draw FPS
     if (config.video.fps_count)
-        ohud.draw_fps_counter(cannonball::fps_counter);
+        ohud.draw_fps_counter(cannonball::fps_counter, config.video.frameskip ? cannonball::skip_counter : -1);
 }
 
 // Vertical Interrupt
@@ -245,4 +245,4 @@ private:
     void check_freeplay_start();
 };
 
-extern Outrun outrun;
+extern ENGINE_LOCAL Outrun outrun;
@@ -0,0 +1,206 @@
+/***************************************************************************
+    Engine Context.
+
+    Runs an instance of the game engine on its own thread, without a window
+    or audio device. Several contexts can run side by side in one process.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include "enginecontext.hpp"
+
+#ifdef ENGINE_CONTEXTS
+
+#include <boost/bind.hpp>
+
+#include "main.hpp"
+#include "trackloader.hpp"
+#include "engine/outrun.hpp"
+#include "engine/oinputs.hpp"
+#include "engine/omusic.hpp"
+
+EngineContext::EngineContext()
+{
+    render        = false;
+    sound         = false;
+    frame_count   = 0;
+    thread        = NULL;
+    running       = false;
+    busy          = false;
+    master_config = NULL;
+    master_roms   = NULL;
+    master_tracks = NULL;
+}
+
+EngineContext::~EngineContext()
+{
+    stop();
+}
+
+bool EngineContext::start()
+{
+    if (thread != NULL)
+        return false;
+
+    // Note: These resolve to the calling thread's instances
+    master_config = &config;
+    master_roms   = &roms;
+    master_tracks = &trackloader;
+
+    running = true;
+    post(boost::bind(&EngineContext::setup, this));
+
+    try
+    {
+        thread = new boost::thread(boost::bind(&EngineContext::thread_main, this));
+    }
+    catch (boost::thread_resource_error&)
+    {
+        running = false;
+        jobs.clear();
+        busy = false;
+        return false;
+    }
+
+    // The master state must not change while it is being copied
+    wait();
+    return true;
+}
+
+void EngineContext::stop()
+{
+    if (thread == NULL)
+        return;
+
+    {
+        boost::lock_guard<boost::mutex> lock(mtx);
+        running = false;
+    }
+    cond_job.notify_one();
+
+    thread->join();
+    delete thread;
+    thread = NULL;
+}
+
+void EngineContext::post(const boost::function<void()>& job)
+{
+    {
+        boost::lock_guard<boost::mutex> lock(mtx);
+        jobs.push_back(job);
+        busy = true;
+    }
+    cond_job.notify_one();
+}
+
+void EngineContext::wait()
+{
+    boost::unique_lock<boost::mutex> lock(mtx);
+    while (busy)
+        cond_idle.wait(lock);
+}
+
+void EngineContext::tick(const int frames)
+{
+    post(boost::bind(&EngineContext::tick_frames, this, frames));
+}
+
+void EngineContext::thread_main()
+{
+    boost::unique_lock<boost::mutex> lock(mtx);
+
+    for (;;)
+    {
+        while (jobs.empty() && running)
+            cond_job.wait(lock);
+
+        // Only exit once the queue has drained
+        if (jobs.empty())
+            break;
+
+        boost::function<void()> job = jobs.front();
+        jobs.pop_front();
+
+        lock.unlock();
+        job();
+        lock.lock();
+
+        if (jobs.empty())
+        {
+            busy = false;
+            cond_idle.notify_all();
+        }
+    }
+}
+
+// Copy the master state into this thread's engine singletons
+void EngineContext::setup()
+{
+    config = *master_config;
+    config.save_enabled        = false;
+    config.sound.enabled       = false;
+    config.cannonboard.enabled = false;
+    for (int i = 0; i < 4; i++)
+        config.sound.custom_music[i].enabled = false;
+
+    // Shallow copy: ROM data is shared with the master
+    roms       = *master_roms;
+    roms.rom0p = &roms.rom0;
+    roms.rom1p = &roms.rom1;
+
+    trackloader.share_layout_track(master_tracks);
+    omusic.load_widescreen_map();
+
+    // Graphics have already been decoded, so this only sets up the layers
+    video.init_headless(&roms, &config.video);
+
+    cannonball::frame_ms = 1000.0 / config.fps;
+    reset();
+}
+
+void EngineContext::reset()
+{
+    oinputs.init();
+    outrun.init();
+    cannonball::state      = cannonball::STATE_GAME;
+    cannonball::frame      = 0;
+    cannonball::tick_frame = true;
+}
+
+void EngineContext::tick_frames(const int frames)
+{
+    for (int i = 0; i < frames; i++)
+        tick_frame();
+}
+
+// Headless version of the main loop tick. See main.cpp.
+void EngineContext::tick_frame(Packet* packet)
+{
+    cannonball::frame++;
+
+    if (config.fps != 30)
+    {
+        if (config.fps == 60)
+            cannonball::tick_frame = cannonball::frame & 1;
+        else if (config.fps == 120)
+            cannonball::tick_frame = (cannonball::frame & 3) == 1;
+    }
+
+    if (cannonball::tick_frame)
+        oinputs.tick(packet);
+    oinputs.do_gear();
+
+    outrun.tick(packet, cannonball::tick_frame);
+    input.frame_done();
+
+    if (sound)
+        osoundint.tick();
+
+    if (render)
+        video.draw_frame();
+
+    frame_count++;
+}
+
+#endif
@@ -0,0 +1,92 @@
+/***************************************************************************
+    Engine Context.
+
+    Runs an instance of the game engine on its own thread, without a window
+    or audio device. Several contexts can run side by side in one process.
+
+    Every engine singleton (outrun, oroad, video, config, roms...) is declared
+    ENGINE_LOCAL, so each context thread sees its own copy. ROM data and the
+    decoded tile, sprite and road graphics are shared between all contexts.
+
+    Requires ENGINE_CONTEXTS to be defined (C++11 thread_local).
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include "globals.hpp"
+
+#ifdef ENGINE_CONTEXTS
+
+#include <deque>
+#include <boost/function.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+class Config;
+class Roms;
+class TrackLoader;
+struct Packet;
+
+class EngineContext
+{
+public:
+    // Render the video layers every frame (only needed when reading pixels back)
+    bool render;
+
+    // Run the Z80 sound program every frame
+    bool sound;
+
+    // Frames ticked since the context was started
+    uint32_t frame_count;
+
+    EngineContext();
+    ~EngineContext();
+
+    // Start the engine thread.
+    //
+    // Must be called from the thread that loaded the ROMs and config, after
+    // video.init() or video.init_headless() has decoded the graphics.
+    // The context takes a copy of that thread's config, roms and LayOut track.
+    bool start();
+    void stop();
+
+    // Queue a job to run on the engine thread. Jobs run in order.
+    void post(const boost::function<void()>& job);
+
+    // Block until every queued job has completed
+    void wait();
+
+    // Queue a number of engine frames
+    void tick(const int frames);
+
+    // Engine thread only: Restart the game from boot
+    void reset();
+
+    // Engine thread only: Run a single engine frame
+    void tick_frame(Packet* packet = NULL);
+
+private:
+    boost::thread* thread;
+    boost::mutex mtx;
+    boost::condition_variable cond_job;
+    boost::condition_variable cond_idle;
+    std::deque< boost::function<void()> > jobs;
+
+    bool running;
+    bool busy;
+
+    // State copied from the thread that called start()
+    const Config*      master_config;
+    const Roms*        master_roms;
+    const TrackLoader* master_tracks;
+
+    void thread_main();
+    void setup();
+    void tick_frames(const int frames);
+};
+
+#endif
@@ -0,0 +1,160 @@
+/***************************************************************************
+    Frame Pacer.
+
+    Paces frames to absolute deadlines on a monotonic nanosecond clock.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <iostream>
+#include <iomanip>
+#include <cmath>
+#include <cstring>
+#include <cerrno>
+#include <unistd.h>
+
+#include "framepacer.hpp"
+
+#if defined(_POSIX_TIMERS) && _POSIX_TIMERS > 0
+#include <time.h>
+#define PACER_POSIX 1
+#else
+#include <SDL.h>
+#endif
+
+FramePacer::FramePacer()
+{
+    deadline        = 0;
+    last_frame      = 0;
+    frames          = 0;
+    interval_min    = 0;
+    interval_max    = 0;
+    interval_sum    = 0;
+    interval_sum_sq = 0;
+    memset(histogram, 0, sizeof(histogram));
+}
+
+int64_t FramePacer::now()
+{
+#ifdef PACER_POSIX
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ((int64_t) ts.tv_sec * 1000000000) + ts.tv_nsec;
+#else
+    return (int64_t) SDL_GetTicks() * 1000000;
+#endif
+}
+
+void FramePacer::start()
+{
+    deadline   = now();
+    last_frame = 0;
+}
+
+double FramePacer::advance(const double period_ms)
+{
+    deadline += (int64_t) (period_ms * 1000000.0);
+    return (deadline - now()) / 1000000.0;
+}
+
+void FramePacer::limit_lag(const double max_ms)
+{
+    const int64_t oldest = now() - (int64_t) (max_ms * 1000000.0);
+    if (deadline < oldest)
+        deadline = oldest;
+}
+
+void FramePacer::wait()
+{
+    const int64_t sleep_until = deadline - SPIN_NS;
+
+    // Sleep for most of the remaining time
+    if (now() < sleep_until)
+    {
+#ifdef PACER_POSIX
+        timespec ts;
+        ts.tv_sec  = sleep_until / 1000000000;
+        ts.tv_nsec = sleep_until % 1000000000;
+        while (clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL) == EINTR) {} // Restart if interrupted
+#else
+        SDL_Delay((Uint32) ((sleep_until - now()) / 1000000));
+#endif
+    }
+
+    // Spin the final stretch
+    while (now() < deadline) {}
+}
+
+void FramePacer::record()
+{
+    const int64_t t = now();
+
+    if (last_frame)
+    {
+        const int64_t interval = t - last_frame;
+
+        int bin = (int) (interval / BIN_NS);
+        if (bin > BINS)
+            bin = BINS;
+        histogram[bin]++;
+
+        if (frames == 0 || interval < interval_min) interval_min = interval;
+        if (frames == 0 || interval > interval_max) interval_max = interval;
+        interval_sum    += interval;
+        interval_sum_sq += (double) interval * interval;
+        frames++;
+    }
+
+    last_frame = t;
+}
+
+void FramePacer::print_stats(std::ostream& out) const
+{
+    if (frames == 0)
+        return;
+
+    const double mean   = interval_sum / frames;
+    const double var    = (interval_sum_sq / frames) - (mean * mean);
+    const double stddev = var > 0 ? sqrt(var) : 0;
+
+    out << std::fixed << std::setprecision(3);
+    out << "Frame intervals: " << frames << " frames" << std::endl;
+    out << "  Mean    " << mean / 1000000.0 << "ms" << std::endl;
+    out << "  Std Dev " << stddev / 1000000.0 << "ms" << std::endl;
+    out << "  Min     " << interval_min / 1000000.0 << "ms" << std::endl;
+    out << "  Max     " << interval_max / 1000000.0 << "ms" << std::endl;
+
+    // Percentiles, rounded up to the end of their bin
+    const double percentiles[] = { 50.0, 99.0, 99.9 };
+    const char* labels[]       = { "P50     ", "P99     ", "P99.9   " };
+    for (int p = 0; p < 3; p++)
+    {
+        const uint32_t target = (uint32_t) ceil(frames * percentiles[p] / 100.0);
+        uint32_t count = 0;
+        int bin = 0;
+        for (; bin < BINS; bin++)
+        {
+            count += histogram[bin];
+            if (count >= target)
+                break;
+        }
+        out << "  " << labels[p] << ((bin + 1) * BIN_NS) / 1000000.0 << "ms" << std::endl;
+    }
+
+    uint32_t peak = 0;
+    for (int bin = 0; bin <= BINS; bin++)
+        if (histogram[bin] > peak)
+            peak = histogram[bin];
+
+    out << "  Histogram (0.1ms bins):" << std::endl;
+    for (int bin = 0; bin <= BINS; bin++)
+    {
+        if (histogram[bin] == 0)
+            continue;
+
+        out << "  " << (bin < BINS ? " " : ">") << std::setw(7) << std::setprecision(1)
+            << (bin * BIN_NS) / 1000000.0 << "ms " << std::setw(8) << histogram[bin] << " "
+            << std::string((histogram[bin] * 50 + peak - 1) / peak, '#') << std::endl;
+    }
+}
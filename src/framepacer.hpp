@@ -0,0 +1,61 @@
+/***************************************************************************
+    Frame Pacer.
+
+    Paces frames to absolute deadlines on a monotonic nanosecond clock.
+    Sleeps until shortly before each deadline and then spins the rest of the
+    way, so frames aren't delayed by scheduler oversleep.
+
+    Also keeps a histogram of the intervals between frames, to measure how
+    evenly they are delivered.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <iosfwd>
+#include "stdint.hpp"
+
+class FramePacer
+{
+public:
+    FramePacer();
+
+    // Start pacing from the current time
+    void start();
+
+    // Move the deadline on by a frame. Returns the milliseconds remaining until it.
+    // Negative when behind schedule.
+    double advance(const double period_ms);
+
+    // Don't let the deadline fall more than max_ms behind, so a long stall isn't caught up
+    void limit_lag(const double max_ms);
+
+    // Wait until the deadline. Returns immediately when behind schedule.
+    void wait();
+
+    // Record the interval since the previous frame
+    void record();
+
+    void print_stats(std::ostream& out) const;
+
+    // Monotonic time in nanoseconds
+    static int64_t now();
+
+private:
+    // Time to spin, rather than sleep, before each deadline
+    static const int SPIN_NS = 500000;
+
+    // Histogram: 0.1ms bins up to 50ms. The last bin counts anything longer.
+    static const int BIN_NS = 100000;
+    static const int BINS   = 500;
+
+    int64_t deadline;
+    int64_t last_frame;
+
+    uint32_t histogram[BINS + 1];
+    uint32_t frames;
+    int64_t interval_min, interval_max;
+    double interval_sum, interval_sum_sq;
+};
@@ -12,9 +12,11 @@
 #include <boost/property_tree/ptree.hpp>
 #include <boost/property_tree/xml_parser.hpp>
 #include <iostream>
+#include <sstream>
 
 #include "main.hpp"
 #include "config.hpp"
+#include "scorewriter.hpp"
 #include "globals.hpp"
 #include "setup.hpp"
 #include "../utils.hpp"
@@ -32,11 +34,11 @@ typedef boost::property_tree::xml_writer_settings<std::string> xml_writer_settin
 typedef boost::property_tree::xml_writer_settings<char> xml_writer_settings;
 #endif
 
-Config config;
+ENGINE_LOCAL Config config;
 
 Config::Config(void)
 {
-
+    save_enabled = true;
 }
 
 
@@ -83,9 +85,12 @@ void Config::load(const std::string &filename)
     video.scanlines  = pt_config.get("video.scanlines",          0); // Scanlines
     video.fps        = pt_config.get("video.fps",                0); // Default is 30 fps
     video.fps_count  = pt_config.get("video.fps_counter",        0); // FPS Counter
+    video.frameskip  = pt_config.get("video.frameskip",          0); // Adaptive Frameskip
     video.widescreen = pt_config.get("video.widescreen",         0); // Enable Widescreen Mode
     video.hires      = pt_config.get("video.hires",              0); // Hi-Resolution Mode
     video.filtering  = pt_config.get("video.filtering",          0); // Open GL Filtering Mode
+    video.sprites_front = pt_config.get("video.sprites_front",   0); // Front to back sprite rendering
+    video.present_thread = pt_config.get("video.present_thread", 0); // Present on a separate thread
           
     set_fps(video.fps);
 
@@ -97,6 +102,11 @@ void Config::load(const std::string &filename)
     sound.preview     = pt_config.get("sound.preview",     1);
     sound.fix_samples = pt_config.get("sound.fix_samples", 1);
 
+    // Audio Buffering: Lower values reduce latency, but risk drop outs
+    sound.buffer_samples = pt_config.get("sound.buffer.samples", 1024);
+    sound.buffer_frags   = pt_config.get("sound.buffer.frags",   5);
+    sound.delay          = pt_config.get("sound.buffer.delay",   20);
+
     // Custom Music
     for (int i = 0; i < 4; i++)
     {
@@ -261,11 +271,32 @@ bool Config::save(const std::string &filename)
     return true;
 }
 
+// Serialise the scores here, and leave the disk access to the background writer
+static void write_scores(const std::string &filename, const ptree &pt)
+{
+    std::ostringstream out;
+
+    try
+    {
+        write_xml(out, pt, xml_writer_settings('\t', 1)); // Tab space 1
+    }
+    catch (std::exception &e)
+    {
+        std::cout << "Error saving hiscores: " << e.what() << "\n";
+        return;
+    }
+
+    scorewriter.write(filename, out.str());
+}
+
 void Config::load_scores(const std::string &filename)
 {
     // Create empty property tree object
     ptree pt;
 
+    // Make sure the latest save has reached the disk
+    scorewriter.flush();
+
     try
     {
         read_xml(engine.jap ? filename + "_jap.xml" : filename + ".xml" , pt, boost::property_tree::xml_parser::trim_whitespace);
@@ -299,6 +330,9 @@ void Config::load_scores(const std::string &filename)
 
 void Config::save_scores(const std::string &filename)
 {
+    if (!save_enabled)
+        return;
+
     // Create empty property tree object
     ptree pt;
         
@@ -317,14 +351,7 @@ void Config::save_scores(const std::string &filename)
         pt.put(xmltag + ".time",     Utils::to_hex_string(e->time));
     }
     
-    try
-    {
-        write_xml(engine.jap ? filename + "_jap.xml" : filename + ".xml", pt, std::locale(), xml_writer_settings('\t', 1)); // Tab space 1
-    }
-    catch (std::exception &e)
-    {
-        std::cout << "Error saving hiscores: " << e.what() << "\n";
-    }
+    write_scores(engine.jap ? filename + "_jap.xml" : filename + ".xml", pt);
 }
 
 void Config::load_tiletrial_scores()
@@ -339,6 +366,9 @@ void Config::load_tiletrial_scores()
     // Create empty property tree object
     ptree pt;
 
+    // Make sure the latest save has reached the disk
+    scorewriter.flush();
+
     try
     {
         read_xml(engine.jap ? filename + "_jap.xml" : filename + ".xml" , pt, boost::property_tree::xml_parser::trim_whitespace);
@@ -361,9 +391,12 @@ void Config::load_tiletrial_scores()
 
 void Config::save_tiletrial_scores()
 {
-	std::string filename;
-	filename = ttrialload;
-	
+    if (!save_enabled)
+        return;
+
+    std::string filename;
+    filename = ttrialload;
+
     //const std::string filename = FILENAME_TTRIAL;
 
     // Create empty property tree object
@@ -375,14 +408,7 @@ void Config::save_tiletrial_scores()
         pt.put("time_trial.score" + Utils::to_string(i), ttrial.best_times[i]);
     }
 
-    try
-    {
-        write_xml(engine.jap ? filename + "_jap.xml" : filename + ".xml", pt, std::locale(), xml_writer_settings('\t', 1)); // Tab space 1
-    }
-    catch (std::exception &e)
-    {
-        std::cout << "Error saving hiscores: " << e.what() << "\n";
-    }
+    write_scores(engine.jap ? filename + "_jap.xml" : filename + ".xml", pt);
 }
 
 bool Config::clear_scores()
@@ -390,6 +416,9 @@ bool Config::clear_scores()
     // Init Default Hiscores
     ohiscore.init_def_scores();
 
+    // Don't let an outstanding save recreate a file once it's been removed
+    scorewriter.flush();
+
     int clear = 0;
 
     // Remove XML files if they exist
@@ -13,6 +13,7 @@
 #include <set>
 #include <string>
 #include "stdint.hpp"
+#include "globals.hpp"
 
 struct custom_music_t
 {
@@ -46,8 +47,11 @@ struct video_settings_t
     int widescreen;
     int fps;
     int fps_count;
+    int frameskip;  // Maximum consecutive frames to skip drawing when running slow (0 = Off)
     int hires;
     int filtering;
+    int sprites_front; // Draw sprites front to back, skipping hidden pixels
+    int present_thread; // SDL2 surface renderer: Present frames on a separate thread (experimental)
 };
 
 struct sound_settings_t
@@ -56,6 +60,9 @@ struct sound_settings_t
     int advertise;
     int preview;
     int fix_samples;
+    int buffer_samples; // Samples per audio callback
+    int buffer_frags;   // Callback sized fragments held in the audio buffer
+    int delay;          // Target audio buffer fill (ms)
     custom_music_t custom_music[4];
 };
 
@@ -138,6 +145,9 @@ public:
 
     // Continuous Mode: Traffic Setting
     int cont_traffic;
+
+    // Write scores to disk. Disabled for headless engine instances.
+    bool save_enabled;
     
     Config(void);
     ~Config(void);
@@ -155,4 +165,4 @@ public:
 private:
 };
 
-extern Config config;
+extern ENGINE_LOCAL Config config;
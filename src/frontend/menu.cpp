@@ -390,7 +390,7 @@ void Menu::tick_ui()
 
     // Draw FPS
     if (config.video.fps_count)
-        ohud.draw_fps_counter(cannonball::fps_counter);
+        ohud.draw_fps_counter(cannonball::fps_counter, config.video.frameskip ? cannonball::skip_counter : -1);
 
     oroad.tick();
 }
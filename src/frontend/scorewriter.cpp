@@ -0,0 +1,179 @@
+/***************************************************************************
+    Background Score Writer.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <boost/bind.hpp>
+
+#ifndef _WIN32
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "frontend/scorewriter.hpp"
+
+ScoreWriter scorewriter;
+
+ScoreWriter::ScoreWriter()
+{
+    thread = NULL;
+    busy   = false;
+    quit   = false;
+}
+
+ScoreWriter::~ScoreWriter()
+{
+    stop();
+}
+
+void ScoreWriter::write(const std::string& filename, const std::string& data)
+{
+    {
+        boost::mutex::scoped_lock lock(mtx);
+
+        // Started on first use
+        if (thread == NULL && !quit)
+        {
+            try
+            {
+                thread = new boost::thread(boost::bind(&ScoreWriter::writer_thread, this));
+            }
+            catch (boost::thread_resource_error&)
+            {
+                thread = NULL;
+            }
+        }
+
+        if (thread != NULL)
+        {
+            // Replaces any earlier save of the same file that hasn't been written yet
+            pending[filename] = data;
+            cond_work.notify_one();
+            return;
+        }
+    }
+
+    // No thread: Write on the calling thread instead
+    write_file(filename, data);
+}
+
+void ScoreWriter::flush()
+{
+    boost::mutex::scoped_lock lock(mtx);
+    while (busy || !pending.empty())
+        cond_done.wait(lock);
+}
+
+void ScoreWriter::stop()
+{
+    {
+        boost::mutex::scoped_lock lock(mtx);
+        quit = true;
+        if (thread == NULL)
+            return;
+    }
+
+    // The thread writes everything pending before exiting
+    cond_work.notify_one();
+    thread->join();
+    delete thread;
+    thread = NULL;
+}
+
+void ScoreWriter::writer_thread()
+{
+    boost::mutex::scoped_lock lock(mtx);
+
+    for (;;)
+    {
+        while (pending.empty() && !quit)
+            cond_work.wait(lock);
+
+        if (pending.empty())
+            break;
+
+        // Take everything queued, and write it without holding the lock
+        std::map<std::string, std::string> files;
+        files.swap(pending);
+        busy = true;
+
+        lock.unlock();
+        for (std::map<std::string, std::string>::const_iterator it = files.begin(); it != files.end(); ++it)
+            write_file(it->first, it->second);
+        lock.lock();
+
+        busy = false;
+        cond_done.notify_all();
+    }
+
+    cond_done.notify_all();
+}
+
+// Write to a temporary file, sync it, and rename it over the original
+bool ScoreWriter::write_file(const std::string& filename, const std::string& data)
+{
+    const std::string temp = filename + ".tmp";
+
+#ifdef _WIN32
+    std::ofstream out(temp.c_str(), std::ios::out | std::ios::binary | std::ios::trunc);
+    out.write(data.data(), data.size());
+    out.close();
+
+    // rename() doesn't replace an existing file on Windows
+    bool ok = !out.fail();
+    if (ok)
+    {
+        remove(filename.c_str());
+        ok = rename(temp.c_str(), filename.c_str()) == 0;
+    }
+#else
+    bool ok = false;
+
+    const int fd = open(temp.c_str(), O_WRONLY | O_CREAT | O_TRUNC, 0644);
+    if (fd >= 0)
+    {
+        const char* p    = data.data();
+        size_t remaining = data.size();
+
+        while (remaining > 0)
+        {
+            const ssize_t written = ::write(fd, p, remaining);
+            if (written <= 0)
+                break;
+            p         += written;
+            remaining -= written;
+        }
+
+        ok = remaining == 0 && fsync(fd) == 0;
+        ok = close(fd) == 0 && ok;
+        ok = ok && rename(temp.c_str(), filename.c_str()) == 0;
+    }
+
+    // Sync the directory, so the rename itself survives a power cut
+    if (ok)
+    {
+        const size_t slash = filename.find_last_of('/');
+        const std::string dir = slash == std::string::npos ? "." : filename.substr(0, slash + 1);
+
+        const int dir_fd = open(dir.c_str(), O_RDONLY);
+        if (dir_fd >= 0)
+        {
+            fsync(dir_fd);
+            close(dir_fd);
+        }
+    }
+#endif
+
+    if (!ok)
+    {
+        remove(temp.c_str());
+        std::cout << "Error saving hiscores: " << filename << std::endl;
+    }
+
+    return ok;
+}
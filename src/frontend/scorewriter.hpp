@@ -0,0 +1,56 @@
+/***************************************************************************
+    Background Score Writer.
+
+    Writes the hiscore and time trial files on a background thread, so
+    saving doesn't stall the game on slow storage.
+
+    - Each file is written to a temporary file, synced to disk and then
+      renamed over the old one. A crash or power cut leaves either the old
+      file or the new one, never a partial file.
+    - If a file is saved again before the previous save has been written,
+      only the latest contents are written.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <map>
+#include <string>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+class ScoreWriter
+{
+public:
+    ScoreWriter();
+    ~ScoreWriter();
+
+    // Queue the contents of a file to be written
+    void write(const std::string& filename, const std::string& data);
+
+    // Wait until everything queued has been written
+    void flush();
+
+    // Write anything outstanding and stop the thread. Call on exit.
+    void stop();
+
+private:
+    // Latest contents of each file waiting to be written
+    std::map<std::string, std::string> pending;
+
+    boost::thread* thread;
+    boost::mutex mtx;
+    boost::condition_variable cond_work;
+    boost::condition_variable cond_done;
+    bool busy;
+    bool quit;
+
+    void writer_thread();
+    static bool write_file(const std::string& filename, const std::string& data);
+};
+
+// Shared by every engine in the process
+extern ScoreWriter scorewriter;
@@ -0,0 +1,32 @@
+/***************************************************************************
+    Shared Variables.
+
+    Kept separate from main.cpp, so the engine can be linked without the
+    SDL front end (see rlenv.hpp).
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include "main.hpp"
+#include "setup.hpp"
+
+using namespace cannonball;
+
+char FILENAME_CONFIG[256];
+char FILENAME_SCORES[256];
+char FILENAME_TTRIAL[256];
+char FILENAME_CONT[256];
+
+ENGINE_LOCAL int    cannonball::state       = STATE_BOOT;
+ENGINE_LOCAL double cannonball::frame_ms    = 0;
+ENGINE_LOCAL int    cannonball::frame       = 0;
+ENGINE_LOCAL bool   cannonball::tick_frame  = true;
+ENGINE_LOCAL int    cannonball::fps_counter = 0;
+ENGINE_LOCAL int    cannonball::skip_counter = 0;
+
+char configload[128], ttrialload[128], contload[128], scoresload[128];
+
+#ifdef COMPILE_SOUND_CODE
+ENGINE_LOCAL Audio cannonball::audio;
+#endif
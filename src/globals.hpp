@@ -9,6 +9,23 @@
 // Comment out to disable SDL specific sound code
 #define COMPILE_SOUND_CODE 1
 
+// Define ENGINE_CONTEXTS (requires C++11) to give every thread its own copy of the
+// engine singletons. See enginecontext.hpp for running several engines per process.
+#ifdef ENGINE_CONTEXTS
+#define ENGINE_LOCAL thread_local
+#else
+#define ENGINE_LOCAL
+#endif
+
+// Define LOW_MEMORY to reduce memory use on handheld targets (see Makefile.gcw0).
+// The road graphics are packed to 2bpp and the native endian ROM mirrors are not created.
+
+// Tile patches are applied in place and undone from a journal of the overwritten tiles.
+// Engine contexts share the tiles between threads, so patch a private copy instead.
+#ifndef ENGINE_CONTEXTS
+#define TILE_JOURNAL 1
+#endif
+
 // ------------------------------------------------------------------------------------------------
 // Debug Settings
 // ------------------------------------------------------------------------------------------------
@@ -18,6 +35,9 @@ const bool DEBUG_LEVEL = false;
 // Force AI to play the levels
 const bool FORCE_AI = false;
 
+// Check reads from the native endian ROM mirrors against the original byte reads
+const bool DEBUG_ROM_READS = false;
+
 // ------------------------------------------------------------------------------------------------
 // General useful stuff
 // ------------------------------------------------------------------------------------------------
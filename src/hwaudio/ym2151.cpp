@@ -14,66 +14,67 @@
 #include <cmath>
 #include <cstring>  // For memset on GCC
 
+#include "globals.hpp"
 #include "hwaudio/ym2151.hpp"
 
-signed int     chanout[8];
-signed int     m2,c1,c2;            /* Phase Modulation input for operators 2,3,4  */
-signed int     mem;                 /* one sample delay memory */
+ENGINE_LOCAL signed int     chanout[8];
+ENGINE_LOCAL signed int     m2,c1,c2;            /* Phase Modulation input for operators 2,3,4  */
+ENGINE_LOCAL signed int     mem;                 /* one sample delay memory */
 
-YM2151Operator oper[32];            /* the 32 operators */
+ENGINE_LOCAL YM2151Operator oper[32];            /* the 32 operators */
 
-uint32_t       pan[16];             /* channels output masks (0xffffffff = enable) */
+ENGINE_LOCAL uint32_t       pan[16];             /* channels output masks (0xffffffff = enable) */
 
-uint32_t       eg_cnt;              /* global envelope generator counter */
-uint32_t       eg_timer;            /* global envelope generator counter works at frequency = chipclock/64/3 */
-uint32_t       eg_timer_add;        /* step of eg_timer */
-uint32_t       eg_timer_overflow;   /* envelope generator timer overlfows every 3 samples (on real chip) */
+ENGINE_LOCAL uint32_t       eg_cnt;              /* global envelope generator counter */
+ENGINE_LOCAL uint32_t       eg_timer;            /* global envelope generator counter works at frequency = chipclock/64/3 */
+ENGINE_LOCAL uint32_t       eg_timer_add;        /* step of eg_timer */
+ENGINE_LOCAL uint32_t       eg_timer_overflow;   /* envelope generator timer overlfows every 3 samples (on real chip) */
 
-uint32_t       lfo_phase;           /* accumulated LFO phase (0 to 255) */
-uint32_t       lfo_timer;           /* LFO timer                        */
-uint32_t       lfo_timer_add;       /* step of lfo_timer                */
-uint32_t       lfo_overflow;        /* LFO generates new output when lfo_timer reaches this value */
-uint32_t       lfo_counter;         /* LFO phase increment counter      */
-uint32_t       lfo_counter_add;     /* step of lfo_counter              */
-uint8_t        lfo_wsel;            /* LFO waveform (0-saw, 1-square, 2-triangle, 3-random noise) */
-uint8_t        amd;                 /* LFO Amplitude Modulation Depth   */
-int8_t         pmd;                 /* LFO Phase Modulation Depth       */
-uint32_t       lfa;                 /* LFO current AM output            */
-int32_t        lfp;                 /* LFO current PM output            */
+ENGINE_LOCAL uint32_t       lfo_phase;           /* accumulated LFO phase (0 to 255) */
+ENGINE_LOCAL uint32_t       lfo_timer;           /* LFO timer                        */
+ENGINE_LOCAL uint32_t       lfo_timer_add;       /* step of lfo_timer                */
+ENGINE_LOCAL uint32_t       lfo_overflow;        /* LFO generates new output when lfo_timer reaches this value */
+ENGINE_LOCAL uint32_t       lfo_counter;         /* LFO phase increment counter      */
+ENGINE_LOCAL uint32_t       lfo_counter_add;     /* step of lfo_counter              */
+ENGINE_LOCAL uint8_t        lfo_wsel;            /* LFO waveform (0-saw, 1-square, 2-triangle, 3-random noise) */
+ENGINE_LOCAL uint8_t        amd;                 /* LFO Amplitude Modulation Depth   */
+ENGINE_LOCAL int8_t         pmd;                 /* LFO Phase Modulation Depth       */
+ENGINE_LOCAL uint32_t       lfa;                 /* LFO current AM output            */
+ENGINE_LOCAL int32_t        lfp;                 /* LFO current PM output            */
 
-uint8_t        test;                /* TEST register */
-uint8_t        ct;                  /* output control pins (bit1-CT2, bit0-CT1) */
+ENGINE_LOCAL uint8_t        test;                /* TEST register */
+ENGINE_LOCAL uint8_t        ct;                  /* output control pins (bit1-CT2, bit0-CT1) */
 
-uint32_t       noise;               /* noise enable/period register (bit 7 - noise enable, bits 4-0 - noise period */
-uint32_t       noise_rng;           /* 17 bit noise shift register */
-uint32_t       noise_p;             /* current noise 'phase'*/
-uint32_t       noise_f;             /* current noise period */
+ENGINE_LOCAL uint32_t       noise;               /* noise enable/period register (bit 7 - noise enable, bits 4-0 - noise period */
+ENGINE_LOCAL uint32_t       noise_rng;           /* 17 bit noise shift register */
+ENGINE_LOCAL uint32_t       noise_p;             /* current noise 'phase'*/
+ENGINE_LOCAL uint32_t       noise_f;             /* current noise period */
 
-uint32_t       csm_req;             /* CSM  KEY ON / KEY OFF sequence request */
+ENGINE_LOCAL uint32_t       csm_req;             /* CSM  KEY ON / KEY OFF sequence request */
 
-uint32_t       irq_enable;          /* IRQ enable for timer B (bit 3) and timer A (bit 2); bit 7 - CSM mode (keyon to all slots, everytime timer A overflows) */
-uint32_t       status;              /* chip status (BUSY, IRQ Flags) */
-uint8_t        connects[8];         /* channels connections */
+ENGINE_LOCAL uint32_t       irq_enable;          /* IRQ enable for timer B (bit 3) and timer A (bit 2); bit 7 - CSM mode (keyon to all slots, everytime timer A overflows) */
+ENGINE_LOCAL uint32_t       status;              /* chip status (BUSY, IRQ Flags) */
+ENGINE_LOCAL uint8_t        connects[8];         /* channels connections */
 
 #ifdef USE_MAME_TIMERS
 /* ASG 980324 -- added for tracking timers */
-    emu_timer  *timer_A;
-    emu_timer  *timer_B;
-    attotime   timer_A_time[1024];  /* timer A times for MAME */
-    attotime   timer_B_time[256];   /* timer B times for MAME */
-    int        irqlinestate;
+    ENGINE_LOCAL emu_timer  *timer_A;
+    ENGINE_LOCAL emu_timer  *timer_B;
+    ENGINE_LOCAL attotime   timer_A_time[1024];  /* timer A times for MAME */
+    ENGINE_LOCAL attotime   timer_B_time[256];   /* timer B times for MAME */
+    ENGINE_LOCAL int        irqlinestate;
 #else
-    uint8_t    tim_A;               /* timer A enable (0-disabled) */
-    uint8_t    tim_B;               /* timer B enable (0-disabled) */
-    int32_t    tim_A_val;           /* current value of timer A */
-    int32_t    tim_B_val;           /* current value of timer B */
-    uint32_t   tim_A_tab[1024];     /* timer A deltas */
-    uint32_t   tim_B_tab[256];      /* timer B deltas */
+    ENGINE_LOCAL uint8_t    tim_A;               /* timer A enable (0-disabled) */
+    ENGINE_LOCAL uint8_t    tim_B;               /* timer B enable (0-disabled) */
+    ENGINE_LOCAL int32_t    tim_A_val;           /* current value of timer A */
+    ENGINE_LOCAL int32_t    tim_B_val;           /* current value of timer B */
+    ENGINE_LOCAL uint32_t   tim_A_tab[1024];     /* timer A deltas */
+    ENGINE_LOCAL uint32_t   tim_B_tab[256];      /* timer B deltas */
 #endif
-uint32_t       timer_A_index;       /* timer A index */
-uint32_t       timer_B_index;       /* timer B index */
-uint32_t       timer_A_index_old;   /* timer A previous index */
-uint32_t       timer_B_index_old;   /* timer B previous index */
+ENGINE_LOCAL uint32_t       timer_A_index;       /* timer A index */
+ENGINE_LOCAL uint32_t       timer_B_index;       /* timer B index */
+ENGINE_LOCAL uint32_t       timer_A_index_old;   /* timer A previous index */
+ENGINE_LOCAL uint32_t       timer_B_index_old;   /* timer B previous index */
 
 /*  Frequency-deltas to get the closest frequency possible.
 *   There are 11 octaves because of DT2 (max 950 cents over base frequency)
@@ -91,14 +92,14 @@ uint32_t       timer_B_index_old;   /* timer B previous index */
 *              9       note code + DT2 + LFO PM
 *              10      note code + DT2 + LFO PM
 */
-uint32_t       freq[11*768];        /* 11 octaves, 768 'cents' per octave */
+ENGINE_LOCAL uint32_t       freq[11*768];        /* 11 octaves, 768 'cents' per octave */
 
 /*  Frequency deltas for DT1. These deltas alter operator frequency
 *   after it has been taken from frequency-deltas table.
 */
-int32_t        dt1_freq[8*32];      /* 8 DT1 levels, 32 KC values */
+ENGINE_LOCAL int32_t        dt1_freq[8*32];      /* 8 DT1 levels, 32 KC values */
 
-uint32_t       noise_tab[32];       /* 17bit Noise Generator periods */
+ENGINE_LOCAL uint32_t       noise_tab[32];       /* 17bit Noise Generator periods */
 
 
 #define M_PI             3.14159265358979323846
@@ -140,15 +141,15 @@ uint32_t       noise_tab[32];       /* 17bit Noise Generator periods */
 *   TL_RES_LEN - sinus resolution (X axis)
 */
 #define TL_TAB_LEN (13*2*TL_RES_LEN)
-static signed int tl_tab[TL_TAB_LEN];
+static ENGINE_LOCAL signed int tl_tab[TL_TAB_LEN];
 
 #define ENV_QUIET        (TL_TAB_LEN>>3)
 
 /* sin waveform table in 'decibel' scale */
-static unsigned int sin_tab[SIN_LEN];
+static ENGINE_LOCAL unsigned int sin_tab[SIN_LEN];
 
 /* translate from D1L to volume index (16 D1L levels) */
-static uint32_t d1l_tab[16];
+static ENGINE_LOCAL uint32_t d1l_tab[16];
 
 #define RATE_STEPS (8)
 static const uint8_t eg_inc[19*RATE_STEPS]={
@@ -0,0 +1,170 @@
+/***************************************************************************
+    Decoded Graphics Cache.
+
+    Stores the converted tile, sprite and road graphics on disk, so they
+    don't need to be decoded from the source roms on every start.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "roms.hpp"
+#include "hwvideo/gfxcache.hpp"
+#include "hwvideo/hwtiles.hpp"
+#include "hwvideo/hwsprites.hpp"
+#include "hwvideo/hwroad.hpp"
+
+// Shared by every engine in the process
+GfxCache gfxcache;
+
+static const char MAGIC[8] = {'C', 'B', 'G', 'F', 'X', 0, 0, 0};
+
+static uint32_t align(const uint32_t offset, const uint32_t alignment)
+{
+    return (offset + alignment - 1) & ~(alignment - 1);
+}
+
+GfxCache::GfxCache()
+{
+    data   = NULL;
+    length = 0;
+}
+
+// The mapping is kept until the process exits, as the video hardware points into it
+GfxCache::~GfxCache()
+{
+}
+
+void GfxCache::get_path(char* path, const int size, const char* filename)
+{
+    snprintf(path, size, "%s/.cannonball/cache%s%s", getenv("HOME"), filename ? "/" : "", filename ? filename : "");
+}
+
+void GfxCache::create_header(header_t* header, const Roms* roms)
+{
+    memset(header, 0, sizeof(header_t));
+    memcpy(header->magic, MAGIC, sizeof(MAGIC));
+    header->version        = VERSION;
+    header->byte_order     = 0x01020304;
+    header->crc_tiles      = roms->tiles.crc;
+    header->crc_sprites    = roms->sprites.crc;
+    header->crc_road       = roms->road.crc;
+    header->tiles_length   = hwtiles::TILES_LENGTH * sizeof(uint32_t);
+    header->sprites_length = hwsprites::SPRITES_LENGTH * sizeof(uint32_t);
+    header->roads_length   = HWRoad::ROADS_LENGTH;
+    header->tiles_offset   = align(sizeof(header_t), ALIGN);
+    header->sprites_offset = align(header->tiles_offset + header->tiles_length, ALIGN);
+    header->roads_offset   = align(header->sprites_offset + header->sprites_length, ALIGN);
+}
+
+bool GfxCache::map(const Roms* roms)
+{
+#ifdef _WIN32
+    return false;
+#else
+    // Only the roms that were loaded this run can be checked
+    if (!roms->tiles.loaded || !roms->sprites.loaded || !roms->road.loaded)
+        return false;
+
+    if (data != NULL)
+        return true;
+
+    char path[256];
+    get_path(path, sizeof(path), "gfx.bin");
+
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    header_t expected;
+    create_header(&expected, roms);
+    const uint32_t file_length = expected.roads_offset + expected.roads_length;
+
+    // Tile patches are written to the mapping when journalled. Only the pages touched are copied.
+#ifdef TILE_JOURNAL
+    const int prot = PROT_READ | PROT_WRITE;
+#else
+    const int prot = PROT_READ;
+#endif
+
+    struct stat st;
+    void* map = MAP_FAILED;
+    if (fstat(fd, &st) == 0 && st.st_size == (off_t) file_length)
+        map = mmap(NULL, file_length, prot, MAP_PRIVATE, fd, 0);
+    close(fd);
+
+    if (map == MAP_FAILED)
+        return false;
+
+    // Stale cache: It will be replaced once the graphics have been decoded
+    if (memcmp(map, &expected, sizeof(header_t)) != 0)
+    {
+        munmap(map, file_length);
+        return false;
+    }
+
+    data   = map;
+    length = file_length;
+
+    const uint8_t* base   = (const uint8_t*) data;
+    hwtiles::tiles_base   = (const uint32_t*) (base + expected.tiles_offset);
+    hwsprites::sprites    = (const uint32_t*) (base + expected.sprites_offset);
+    HWRoad::roads         = base + expected.roads_offset;
+    return true;
+#endif
+}
+
+bool GfxCache::save(const Roms* roms)
+{
+#ifdef _WIN32
+    return false;
+#else
+    if (!roms->tiles.loaded || !roms->sprites.loaded || !roms->road.loaded)
+        return false;
+
+    char dir[256], path[256], temp[256];
+    get_path(dir, sizeof(dir), NULL);
+    get_path(path, sizeof(path), "gfx.bin");
+    snprintf(temp, sizeof(temp), "%s.%d", path, (int) getpid());
+    mkdir(dir, 0755); // create $HOME/.cannonball/cache if it doesn't exist
+
+    header_t header;
+    create_header(&header, roms);
+
+    const uint32_t file_length = header.roads_offset + header.roads_length;
+    uint8_t* buffer = new uint8_t[file_length];
+    memset(buffer, 0, file_length);
+    memcpy(buffer, &header, sizeof(header_t));
+    memcpy(buffer + header.tiles_offset,   hwtiles::tiles_base, header.tiles_length);
+    memcpy(buffer + header.sprites_offset, hwsprites::sprites,  header.sprites_length);
+    memcpy(buffer + header.roads_offset,   HWRoad::roads,       header.roads_length);
+
+    // Write to a temporary file first, so a running process never maps a partial cache
+    std::ofstream out(temp, std::ios::out | std::ios::binary);
+    out.write((const char*) buffer, file_length);
+    out.close();
+    delete[] buffer;
+
+    if (!out || rename(temp, path) != 0)
+    {
+        remove(temp);
+        std::cout << "Unable to write graphics cache: " << path << std::endl;
+        return false;
+    }
+
+    return true;
+#endif
+}
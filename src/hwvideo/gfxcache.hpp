@@ -0,0 +1,68 @@
+/***************************************************************************
+    Decoded Graphics Cache.
+
+    Stores the converted tile, sprite and road graphics on disk, so they
+    don't need to be decoded from the source roms on every start.
+
+    The cache lives in $HOME/.cannonball/cache and is keyed by the checksums
+    of the source roms. It is mapped read-only, so the pages are shared with
+    any other process using the same cache. (Builds that journal tile patches
+    map it copy-on-write instead.)
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include "stdint.hpp"
+
+class Roms;
+
+class GfxCache
+{
+public:
+    GfxCache();
+    ~GfxCache();
+
+    // True if the graphics are mapped from the cache
+    bool is_mapped() const { return data != NULL; }
+
+    // Map the cache for the loaded roms and point the video hardware at it.
+    // Returns false if there is no cache, or it does not match the roms.
+    bool map(const Roms* roms);
+
+    // Write the currently decoded graphics to the cache
+    bool save(const Roms* roms);
+
+private:
+    // Increment when the format of the decoded graphics changes
+    static const uint32_t VERSION = 1;
+
+    // Sections start on a page boundary
+    static const uint32_t ALIGN = 0x1000;
+
+    struct header_t
+    {
+        char     magic[8];
+        uint32_t version;
+        uint32_t byte_order;    // Data is stored in native endian format
+        uint32_t crc_tiles;     // RomLoader::crc of each source rom
+        uint32_t crc_sprites;
+        uint32_t crc_road;
+        uint32_t tiles_offset;
+        uint32_t tiles_length;
+        uint32_t sprites_offset;
+        uint32_t sprites_length;
+        uint32_t roads_offset;
+        uint32_t roads_length;
+    };
+
+    void* data;
+    uint32_t length;
+
+    void create_header(header_t* header, const Roms* roms);
+    void get_path(char* path, const int size, const char* filename);
+};
+
+extern GfxCache gfxcache;
@@ -106,7 +106,10 @@
  *
  *******************************************************************************************/
 
-HWRoad hwroad;
+ENGINE_LOCAL HWRoad hwroad;
+
+uint8_t HWRoad::roads_decoded[HWRoad::ROADS_LENGTH];
+const uint8_t* HWRoad::roads = HWRoad::roads_decoded;
 
 HWRoad::HWRoad()
 {
@@ -117,7 +120,7 @@ HWRoad::~HWRoad()
 }
 
 // Convert road to a more useable format
-void HWRoad::init(const uint8_t* src_road, const bool hires)
+void HWRoad::init(const uint8_t* src_road)
 {
     road_control = 0;
     color_offset1 = 0x400;
@@ -127,19 +130,30 @@ void HWRoad::init(const uint8_t* src_road, const bool hires)
 
     if (src_road)
         decode_road(src_road);
-    
+}
+
+// Select the renderers for the screen size. Called whenever the video mode changes.
+void HWRoad::set_mode(const bool hires, const bool widescreen)
+{
     if (hires)
     {
-        render_background = &HWRoad::render_background_hires;
-        render_foreground = &HWRoad::render_foreground_hires;
+        if (widescreen) set_kernels<2, S16_WIDTH_WIDE * 2>();
+        else            set_kernels<2, S16_WIDTH * 2>();
     }
     else
     {
-        render_background = &HWRoad::render_background_lores;
-        render_foreground = &HWRoad::render_foreground_lores;   
+        if (widescreen) set_kernels<1, S16_WIDTH_WIDE>();
+        else            set_kernels<1, S16_WIDTH>();
     }
 }
 
+template <int SCALE, int WIDTH>
+void HWRoad::set_kernels()
+{
+    render_background = &HWRoad::render_background_scaled<SCALE, WIDTH>;
+    render_foreground = &HWRoad::render_foreground_scaled<SCALE, WIDTH>;
+}
+
 /*
     There are TWO (identical) roads we need to decode.
     Each of these roads is represented using a 512x256 map.
@@ -165,27 +179,44 @@ void HWRoad::init(const uint8_t* src_road, const bool hires)
 
 void HWRoad::decode_road(const uint8_t* src_road)
 {
+    uint8_t* roads = roads_decoded;
+#ifdef LOW_MEMORY
+    memset(roads_decoded, 0, ROADS_LENGTH);
+#endif
+
     for (int y = 0; y < 256 * 2; y++) 
     {
         const int src = ((y & 0xff) * 0x40 + (y >> 8) * 0x8000) % rom_size; // tempGfx
-        const int dst = y * 512; // System16Roads
+        const int dst = y * ROW_LENGTH; // System16Roads
 
         // loop over columns
         for (int x = 0; x < 512; x++) 
         {
-            roads[dst + x] = (((src_road[src + (x / 8)] >> (~x & 7)) & 1) << 0) | (((src_road[src + (x / 8 + 0x4000)] >> (~x & 7)) & 1) << 1);
+            uint8_t pix = (((src_road[src + (x / 8)] >> (~x & 7)) & 1) << 0) | (((src_road[src + (x / 8 + 0x4000)] >> (~x & 7)) & 1) << 1);
 
+#ifdef LOW_MEMORY
+            // stripe is marked by read_pixel()
+            roads[dst + (x >> 2)] |= pix << ((x & 3) << 1);
+#else
             // pre-mark road data in the "stripe" area with a high bit
-            if (x >= 256 - 8 && x < 256 && roads[dst + x] == 3)
-                roads[dst + x] |= 4;
+            if (x >= 256 - 8 && x < 256 && pix == 3)
+                pix |= 4;
+            roads[dst + x] = pix;
+#endif
         }
     }
 
     // set up a dummy road in the last entry
-    for (int i = 0; i < 512; i++) 
+    for (uint32_t i = 0; i < ROW_LENGTH; i++) 
     {
-        roads[256 * 2 * 512 + i] = 3;
+#ifdef LOW_MEMORY
+        roads[256 * 2 * ROW_LENGTH + i] = 0xFF;
+#else
+        roads[256 * 2 * ROW_LENGTH + i] = 3;
+#endif
     }
+
+    HWRoad::roads = roads_decoded;
 }
 
 // Writes go to RAM, but we read from the RAM Buffer.
@@ -231,11 +262,14 @@ void HWRoad::write_road_control(const uint8_t road_control)
 }
 
 // ------------------------------------------------------------------------------------------------
-// Road Rendering: Lores Version
+// Road Rendering.
+// In Hi-Res Mode (SCALE 2), each road scanline is drawn twice. The second is interpolated
+// from the previous scanline and the next.
 // ------------------------------------------------------------------------------------------------
 
 // Background: Look for solid fill scanlines
-void HWRoad::render_background_lores(uint16_t* pixels)
+template <int SCALE, int WIDTH>
+void HWRoad::render_background_scaled(uint16_t* pixels)
 {
     int x, y;
     uint16_t* roadram = ramBuff;
@@ -275,204 +309,26 @@ void HWRoad::render_background_lores(uint16_t* pixels)
                 break;
         }
 
-        // fill the scanline with color
-        if (color != -1) 
-        {
-            uint16_t* pPixel = pixels + (y * config.s16_width);
-            color |= color_offset3;
-            
-            for (x = 0; x < config.s16_width; x++)
-                *(pPixel)++ = color;
-        }
-    }
-}
-
-// Foreground: Render From ROM
-void HWRoad::render_foreground_lores(uint16_t* pixels)
-{
-    int x, y;
-    uint16_t* roadram = ramBuff;
-    
-    for (y = 0; y < S16_HEIGHT; y++) 
-    {
-        uint16_t color_table[32];
-
-        static const uint8_t priority_map[2][8] =
-        {
-            { 0x80,0x81,0x81,0x87,0,0,0,0x00 },
-            { 0x81,0x81,0x81,0x8f,0,0,0,0x80 }
-        };
-
-        const uint32_t data0 = roadram[0x000 + y];
-        const uint32_t data1 = roadram[0x100 + y];
-
-        // if both roads are low priority, skip
-        if (((data0 & 0x800) != 0) && ((data1 & 0x800) != 0))
-            continue;
-
-        uint16_t* pPixel = pixels + (y * config.s16_width);
-        int32_t hpos0, hpos1, color0, color1;
-        int32_t control = road_control & 3;
-
-        uint8_t *src0, *src1;
-        int32_t bgcolor; // 8 bits
-
-        // get road 0 data
-        src0   = ((data0 & 0x800) != 0) ? roads + 256 * 2 * 512 : (roads + (0x000 + ((data0 >> 1) & 0xff)) * 512);
-        hpos0  = roadram[0x200 + (((road_control & 4) != 0) ? y : (data0 & 0x1ff))] & 0xfff;
-        color0 = roadram[0x600 + (((road_control & 4) != 0) ? y : (data0 & 0x1ff))];
-
-        // get road 1 data
-        src1   = ((data1 & 0x800) != 0) ? roads + 256 * 2 * 512 : (roads + (0x100 + ((data1 >> 1) & 0xff)) * 512);
-        hpos1  = roadram[0x400 + (((road_control & 4) != 0) ? (0x100 + y) : (data1 & 0x1ff))] & 0xfff;
-        color1 = roadram[0x600 + (((road_control & 4) != 0) ? (0x100 + y) : (data1 & 0x1ff))];
-
-        // determine the 5 colors for road 0
-        color_table[0x00] = color_offset1 ^ 0x00 ^ ((color0 >> 0) & 1);
-        color_table[0x01] = color_offset1 ^ 0x02 ^ ((color0 >> 1) & 1);
-        color_table[0x02] = color_offset1 ^ 0x04 ^ ((color0 >> 2) & 1);
-        bgcolor = (color0 >> 8) & 0xf;
-        color_table[0x03] = ((data0 & 0x200) != 0) ? color_table[0x00] : (color_offset2 ^ 0x00 ^ bgcolor);
-        color_table[0x07] = color_offset1 ^ 0x06 ^ ((color0 >> 3) & 1);
-
-        // determine the 5 colors for road 1
-        color_table[0x10] = color_offset1 ^ 0x08 ^ ((color1 >> 4) & 1);
-        color_table[0x11] = color_offset1 ^ 0x0a ^ ((color1 >> 5) & 1);
-        color_table[0x12] = color_offset1 ^ 0x0c ^ ((color1 >> 6) & 1);
-        bgcolor = (color1 >> 8) & 0xf;
-        color_table[0x13] = ((data1 & 0x200) != 0) ? color_table[0x10] : (color_offset2 ^ 0x10 ^ bgcolor);
-        color_table[0x17] = color_offset1 ^ 0x0e ^ ((color1 >> 7) & 1);
-
-        // Shift road dependent on whether we are in widescreen mode or not
-        uint16_t s16_x = 0x5f8 + config.s16_x_off;
-
-        // draw the road
-        switch (control) 
-        {
-            case 0:
-                if (data0 & 0x800)
-                    continue;
-                hpos0 = (hpos0 - (s16_x + x_offset)) & 0xfff;
-                for (x = 0; x < config.s16_width; x++) 
-                {
-                    int pix0 = (hpos0 < 0x200) ? src0[hpos0] : 3;
-                    pPixel[x] = color_table[0x00 + pix0];
-                    hpos0 = (hpos0 + 1) & 0xfff;
-                }
-                break;
-
-            case 1:
-                hpos0 = (hpos0 - (s16_x + x_offset)) & 0xfff;
-                hpos1 = (hpos1 - (s16_x + x_offset)) & 0xfff;
-                for (x = 0; x < config.s16_width; x++) 
-                {
-                    int pix0 = (hpos0 < 0x200) ? src0[hpos0] : 3;
-                    int pix1 = (hpos1 < 0x200) ? src1[hpos1] : 3;
-                    if (((priority_map[0][pix0] >> pix1) & 1) != 0)
-                        pPixel[x] = color_table[0x10 + pix1];
-                    else
-                        pPixel[x] = color_table[0x00 + pix0];
-
-                    hpos0 = (hpos0 + 1) & 0xfff;
-                    hpos1 = (hpos1 + 1) & 0xfff;
-                }
-                break;
-
-            case 2:
-                hpos0 = (hpos0 - (s16_x + x_offset)) & 0xfff;
-                hpos1 = (hpos1 - (s16_x + x_offset)) & 0xfff;
-                for (x = 0; x < config.s16_width; x++) 
-                {
-                    int pix0 = (hpos0 < 0x200) ? src0[hpos0] : 3;
-                    int pix1 = (hpos1 < 0x200) ? src1[hpos1] : 3;
-                    if (((priority_map[1][pix0] >> pix1) & 1) != 0)
-                        pPixel[x] = color_table[0x10 + pix1];
-                    else
-                        pPixel[x] = color_table[0x00 + pix0];
-
-                    hpos0 = (hpos0 + 1) & 0xfff;
-                    hpos1 = (hpos1 + 1) & 0xfff;
-                }
-                break;
-
-            case 3:
-                if (data1 & 0x800)
-                    continue;
-                hpos1 = (hpos1 - (s16_x + x_offset)) & 0xfff;
-                for (x = 0; x < config.s16_width; x++) 
-                {
-                    int pix1 = (hpos1 < 0x200) ? src1[hpos1] : 3;
-                    pPixel[x] = color_table[0x10 + pix1];
-                    hpos1 = (hpos1 + 1) & 0xfff;
-                }
-                break;
-            } // end switch
-    } // end for
-}
-
-// ------------------------------------------------------------------------------------------------
-// High Resolution (Double Resolution) Road Rendering
-// ------------------------------------------------------------------------------------------------
-void HWRoad::render_background_hires(uint16_t* pixels)
-{
-    int x, y;
-    uint16_t* roadram = ramBuff;
-
-    for (y = 0; y < config.s16_height; y += 2) 
-    {
-        int data0 = roadram[0x000 + (y >> 1)];
-        int data1 = roadram[0x100 + (y >> 1)];
-
-        int color = -1;
-
-        // based on the info->control, we can figure out which sky to draw
-        switch (road_control & 3) 
-        {
-            case 0:
-                if (data0 & 0x800)
-                    color = data0 & 0x7f;
-                break;
-
-            case 1:
-                if (data0 & 0x800)
-                    color = data0 & 0x7f;
-                else if (data1 & 0x800)
-                    color = data1 & 0x7f;
-                break;
-
-            case 2:
-                if (data1 & 0x800)
-                    color = data1 & 0x7f;
-                else if (data0 & 0x800)
-                    color = data0 & 0x7f;
-                break;
-
-            case 3:
-                if (data1 & 0x800)
-                    color = data1 & 0x7f;
-                break;
-        }
+        uint16_t* const pPixel = pixels + (y * SCALE * WIDTH);
 
         // fill the scanline with color
         if (color != -1) 
         {
-            uint16_t* pPixel = pixels + (y * config.s16_width);
             color |= color_offset3;
             
-            for (x = 0; x < config.s16_width; x++)
-                *(pPixel)++ = color;
+            for (x = 0; x < WIDTH; x++)
+                pPixel[x] = color;
         }
 
         // Hi-Res Mode: Copy extra line of background
-        memcpy(pixels + ((y+1) * config.s16_width), pixels + (y * config.s16_width), sizeof(uint16_t) * config.s16_width);
+        for (int i = 1; i < SCALE; i++)
+            memcpy(pPixel + (i * WIDTH), pPixel, sizeof(uint16_t) * WIDTH);
     }
 }
 
-// ------------------------------------------------------------------------------------------------
-// Render Road Foreground - High Resolution Version
-// Interpolates previous scanline with next.
-// ------------------------------------------------------------------------------------------------
-void HWRoad::render_foreground_hires(uint16_t* pixels)
+// Foreground: Render From ROM
+template <int SCALE, int WIDTH>
+void HWRoad::render_foreground_scaled(uint16_t* pixels)
 {
     int x, y, yy;
     uint16_t* roadram = ramBuff;
@@ -481,9 +337,12 @@ void HWRoad::render_foreground_hires(uint16_t* pixels)
     int32_t color0, color1;
     int32_t bgcolor; // 8 bits
 
-    for (y = 0; y < config.s16_height; y++) 
+    // Shift road dependent on whether we are in widescreen mode or not
+    const uint16_t s16_x = 0x5f8 + (((WIDTH / SCALE) - S16_WIDTH) / 2);
+
+    for (y = 0; y < S16_HEIGHT * SCALE; y++) 
     {
-        yy = y >> 1;
+        yy = y / SCALE;
        
         static const uint8_t priority_map[2][8] =
         {
@@ -497,11 +356,11 @@ void HWRoad::render_foreground_hires(uint16_t* pixels)
         // if both roads are low priority, skip
         if (((data0 & 0x800) != 0) && ((data1 & 0x800) != 0))
         {
-            y++; 
+            y += SCALE - 1;
             continue;
         }
 
-        uint8_t *src0 = NULL, *src1 = NULL;
+        const uint8_t *src0 = NULL, *src1 = NULL;
 
         // get road 0 data
         int32_t hpos0  = roadram[0x200 + (((road_control & 4) != 0) ? yy : (data0 & 0x1ff))] & 0xfff;
@@ -512,7 +371,7 @@ void HWRoad::render_foreground_hires(uint16_t* pixels)
         // ----------------------------------------------------------------------------------------
         // Interpolate Scanlines when in hi-resolution mode.
         // ----------------------------------------------------------------------------------------
-        if (y & 1 && yy < S16_HEIGHT - 1)
+        if ((y % SCALE) == 1 && yy < S16_HEIGHT - 1)
         {
             uint32_t data0_next = roadram[0x000 + yy + 1];
             uint32_t data1_next = roadram[0x100 + yy + 1];
@@ -526,7 +385,7 @@ void HWRoad::render_foreground_hires(uint16_t* pixels)
                 data0      = (data0      >> 1) & 0xFF;
                 data0_next = (data0_next >> 1) & 0xFF;
                 int32_t diff = (data0 + ((data0_next - data0) >> 1)) & 0xFF;
-                src0 = (roads + (0x000 + diff) * 512);
+                src0 = (roads + (0x000 + diff) * ROW_LENGTH);
                 hpos0 = (hpos0 + ((hpos0_next - hpos0) >> 1)) & 0xFFF;
             }
             // Interpolate road 2 source position
@@ -535,7 +394,7 @@ void HWRoad::render_foreground_hires(uint16_t* pixels)
                 data1      = (data1      >> 1) & 0xFF;
                 data1_next = (data1_next >> 1) & 0xFF;
                 int32_t diff = (data1 + ((data1_next - data1) >> 1)) & 0xFF;
-                src1 = (roads + (0x100 + diff) * 512);
+                src1 = (roads + (0x100 + diff) * ROW_LENGTH);
                 hpos1 = (hpos1 + ((hpos1_next - hpos1) >> 1)) & 0xFFF;
             }     
         }
@@ -565,26 +424,24 @@ void HWRoad::render_foreground_hires(uint16_t* pixels)
         }
         
         if (src0 == NULL)
-            src0 = ((data0 & 0x800) != 0) ? roads + 256 * 2 * 512 : (roads + (0x000 + ((data0 >> 1) & 0xff)) * 512);
+            src0 = ((data0 & 0x800) != 0) ? roads + 256 * 2 * ROW_LENGTH : (roads + (0x000 + ((data0 >> 1) & 0xff)) * ROW_LENGTH);
         if (src1 == NULL)
-            src1 = ((data1 & 0x800) != 0) ? roads + 256 * 2 * 512 : (roads + (0x100 + ((data1 >> 1) & 0xff)) * 512);
+            src1 = ((data1 & 0x800) != 0) ? roads + 256 * 2 * ROW_LENGTH : (roads + (0x100 + ((data1 >> 1) & 0xff)) * ROW_LENGTH);
 
-        // Shift road dependent on whether we are in widescreen mode or not
-        uint16_t s16_x = 0x5f8 + config.s16_x_off;
-        uint16_t* const pPixel = pixels + (y * config.s16_width);
+        uint16_t* const pPixel = pixels + (y * WIDTH);
 
-        // draw the road
+        // draw the road. Each road pixel is SCALE screen pixels wide.
         switch (road_control & 3)
         {
             case 0:
                 if (data0 & 0x800)
                     continue;
                 hpos0 = (hpos0 - (s16_x + x_offset)) & 0xfff;
-                for (x = 0; x < config.s16_width; x++) 
+                for (x = 0; x < WIDTH; x++) 
                 {
-                    int pix0 = (hpos0 < 0x200) ? src0[hpos0] : 3;
+                    int pix0 = (hpos0 < 0x200) ? read_pixel(src0, hpos0) : 3;
                     pPixel[x] = color_table[0x00 + pix0];
-                    if (x & 1)
+                    if ((x % SCALE) == SCALE - 1)
                         hpos0 = (hpos0 + 1) & 0xfff;
                 }
                 break;
@@ -592,16 +449,16 @@ void HWRoad::render_foreground_hires(uint16_t* pixels)
             case 1:
                 hpos0 = (hpos0 - (s16_x + x_offset)) & 0xfff;
                 hpos1 = (hpos1 - (s16_x + x_offset)) & 0xfff;
-                for (x = 0; x < config.s16_width; x++) 
+                for (x = 0; x < WIDTH; x++) 
                 {
-                    int pix0 = (hpos0 < 0x200) ? src0[hpos0] : 3;
-                    int pix1 = (hpos1 < 0x200) ? src1[hpos1] : 3;
+                    int pix0 = (hpos0 < 0x200) ? read_pixel(src0, hpos0) : 3;
+                    int pix1 = (hpos1 < 0x200) ? read_pixel(src1, hpos1) : 3;
                     if (((priority_map[0][pix0] >> pix1) & 1) != 0)
                         pPixel[x] = color_table[0x10 + pix1];
                     else
                         pPixel[x] = color_table[0x00 + pix0];
 
-                    if (x & 1)
+                    if ((x % SCALE) == SCALE - 1)
                     {
                         hpos0 = (hpos0 + 1) & 0xfff;
                         hpos1 = (hpos1 + 1) & 0xfff;
@@ -612,16 +469,16 @@ void HWRoad::render_foreground_hires(uint16_t* pixels)
             case 2:
                 hpos0 = (hpos0 - (s16_x + x_offset)) & 0xfff;
                 hpos1 = (hpos1 - (s16_x + x_offset)) & 0xfff;
-                for (x = 0; x < config.s16_width; x++) 
+                for (x = 0; x < WIDTH; x++) 
                 {
-                    int pix0 = (hpos0 < 0x200) ? src0[hpos0] : 3;
-                    int pix1 = (hpos1 < 0x200) ? src1[hpos1] : 3;
+                    int pix0 = (hpos0 < 0x200) ? read_pixel(src0, hpos0) : 3;
+                    int pix1 = (hpos1 < 0x200) ? read_pixel(src1, hpos1) : 3;
                     if (((priority_map[1][pix0] >> pix1) & 1) != 0)
                         pPixel[x] = color_table[0x10 + pix1];
                     else
                         pPixel[x] = color_table[0x00 + pix0];
                       
-                    if (x & 1)
+                    if ((x % SCALE) == SCALE - 1)
                     {
                         hpos0 = (hpos0 + 1) & 0xfff;
                         hpos1 = (hpos1 + 1) & 0xfff;
@@ -633,15 +490,14 @@ void HWRoad::render_foreground_hires(uint16_t* pixels)
                 if (data1 & 0x800)
                     continue;
                 hpos1 = (hpos1 - (s16_x + x_offset)) & 0xfff;
-                for (x = 0; x < config.s16_width; x++) 
+                for (x = 0; x < WIDTH; x++) 
                 {
-                    int pix1 = (hpos1 < 0x200) ? src1[hpos1] : 3;
+                    int pix1 = (hpos1 < 0x200) ? read_pixel(src1, hpos1) : 3;
                     pPixel[x] = color_table[0x10 + pix1];                   
-                    if (x & 1)
+                    if ((x % SCALE) == SCALE - 1)
                         hpos1 = (hpos1 + 1) & 0xfff;
                 }
                 break;
             } // end switch
     } // end for
 }
-
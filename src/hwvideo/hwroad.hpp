@@ -1,6 +1,7 @@
 #pragma once
 
 #include "stdint.hpp"
+#include "globals.hpp"
 
 class HWRoad
 {
@@ -8,7 +9,8 @@ public:
     HWRoad();
     ~HWRoad();
 
-    void init(const uint8_t*, const bool hires);
+    void init(const uint8_t*);
+    void set_mode(const bool hires, const bool widescreen);
     void write16(uint32_t adr, const uint16_t data);
     void write16(uint32_t* adr, const uint16_t data);
     void write32(uint32_t* adr, const uint32_t data);
@@ -16,6 +18,17 @@ public:
     void write_road_control(const uint8_t);
     void (HWRoad::*render_background)(uint16_t*);
     void (HWRoad::*render_foreground)(uint16_t*);
+
+    // Decoded road graphics (shared by all instances).
+    // Points to roads_decoded, or to the graphics cache when it has been mapped.
+    // 513 rows of 512 pixels: 256 for each road, plus an empty row.
+#ifdef LOW_MEMORY
+    static const uint32_t ROW_LENGTH   = 512 / 4; // Packed: 4 pixels per byte
+#else
+    static const uint32_t ROW_LENGTH   = 512;
+#endif
+    static const uint32_t ROADS_LENGTH = ROW_LENGTH * ((256 * 2) + 1);
+    static const uint8_t* roads;
   
 private:
     uint8_t road_control;
@@ -27,18 +40,37 @@ private:
     static const uint16_t ROAD_RAM_SIZE = 0x1000;
     static const uint16_t rom_size = 0x8000;
 
-    // Decoded road graphics
-    uint8_t roads[0x40200];
+    // Road graphics decoded from the source rom
+    static uint8_t roads_decoded[ROADS_LENGTH];
 
     // Two halves of RAM
     uint16_t ram[ROAD_RAM_SIZE / 2];
     uint16_t ramBuff[ROAD_RAM_SIZE / 2];
 
     void decode_road(const uint8_t*);
-    void render_background_lores(uint16_t*);
-    void render_foreground_lores(uint16_t*);
-    void render_background_hires(uint16_t*);
-    void render_foreground_hires(uint16_t*);
+
+    // Read pixel from a decoded row
+    static inline int read_pixel(const uint8_t* row, const int x)
+    {
+#ifdef LOW_MEMORY
+        // The stripe marker does not fit in 2bpp, so restore it from the position.
+        // The dummy road in the last row is not marked.
+        const int pix = (row[x >> 2] >> ((x & 3) << 1)) & 3;
+        return (pix == 3 && x >= 256 - 8 && x < 256 && row != roads + (256 * 2 * ROW_LENGTH)) ? 7 : pix;
+#else
+        return row[x];
+#endif
+    }
+
+    // Renderers for each screen size. Pixels are drawn SCALE x SCALE, to a buffer WIDTH pixels wide.
+    template <int SCALE, int WIDTH>
+    void set_kernels();
+
+    template <int SCALE, int WIDTH>
+    void render_background_scaled(uint16_t*);
+
+    template <int SCALE, int WIDTH>
+    void render_foreground_scaled(uint16_t*);
 };
 
-extern HWRoad hwroad;
\ No newline at end of file
+extern ENGINE_LOCAL HWRoad hwroad;
\ No newline at end of file
@@ -48,12 +48,26 @@
 *
  *******************************************************************************************/
 
+uint32_t hwsprites::sprites_decoded[hwsprites::SPRITES_LENGTH];
+const uint32_t* hwsprites::sprites = hwsprites::sprites_decoded;
+
 hwsprites::hwsprites()
 {
+    row_cache        = new row_entry_t[ROW_CACHE_SETS * ROW_CACHE_WAYS];
+    row_cache_time   = 0;
+    row_cache_hits   = 0;
+    row_cache_misses = 0;
+    cover            = NULL;
+    shade            = NULL;
+
+    for (uint32_t i = 0; i < ROW_CACHE_SETS * ROW_CACHE_WAYS; i++)
+        row_cache[i].used = 0;
 }
 
 hwsprites::~hwsprites()
 {
+    delete[] row_cache;
+    if (cover) delete[] cover;
 }
 
 void hwsprites::init(const uint8_t* src_sprites)
@@ -72,8 +86,9 @@ void hwsprites::init(const uint8_t* src_sprites)
             uint8_t d1 = *spr++;
             uint8_t d0 = *spr++;
 
-            sprites[i] = (d0 << 24) | (d1 << 16) | (d2 << 8) | d3;
+            sprites_decoded[i] = (d0 << 24) | (d1 << 16) | (d2 << 8) | d3;
         }
+        sprites = sprites_decoded;
     }
 }
 
@@ -87,6 +102,28 @@ void hwsprites::reset()
     }
 }
 
+// Select the renderers for the screen size. Called whenever the video mode changes.
+void hwsprites::set_mode(const bool hires, const bool widescreen)
+{
+    if (hires)
+    {
+        if (widescreen) set_kernels<2, S16_WIDTH_WIDE * 2>();
+        else            set_kernels<2, S16_WIDTH * 2>();
+    }
+    else
+    {
+        if (widescreen) set_kernels<1, S16_WIDTH_WIDE>();
+        else            set_kernels<1, S16_WIDTH>();
+    }
+}
+
+template <int SCALE, int WIDTH>
+void hwsprites::set_kernels()
+{
+    render_back  = &hwsprites::render_back_scaled<SCALE, WIDTH>;
+    render_front = &hwsprites::render_front_scaled<SCALE, WIDTH>;
+}
+
 // Clip areas of the screen in wide-screen mode
 void hwsprites::set_x_clip(bool on)
 {
@@ -139,26 +176,296 @@ void hwsprites::swap()
     }
 }
 
+// Shadow the pixel underneath, using the shadow / highlight flag of its palette entry
+#define shadow_pixel(p) { p = shadow_map[p & 0xfff]; }
+
 #define draw_pixel()                                                                                  \
 {                                                                                                     \
     if (x >= x1 && x < x2 && pix != 0 && pix != 15)                                                   \
     {                                                                                                 \
         if (shadow && pix == 0xa)                                                                     \
-        {                                                                                             \
-            pPixel[x] &= 0xfff;                                                                       \
-            pPixel[x] += ((S16_PALETTE_ENTRIES * 2) - ((video.read_pal16(pPixel[x]) & 0x8000) >> 3)); \
-        }                                                                                             \
+            shadow_pixel(pPixel[x])                                                                   \
+        else                                                                                          \
+            pPixel[x] = (pix | color);                                                                \
+    }                                                                                                 \
+}
+
+// Front to back: skip covered pixels. Shadows are recorded, and applied to whatever ends up below.
+#define plot_front()                                                                                  \
+{                                                                                                     \
+    const uint32_t bit = 1u << (x & 31);                                                              \
+    if ((cov[x >> 5] & bit) == 0)                                                                     \
+    {                                                                                                 \
+        if (shadow && pix == 0xa)                                                                     \
+            shd[x >> 5] |= bit;                                                                       \
         else                                                                                          \
         {                                                                                             \
             pPixel[x] = (pix | color);                                                                \
+            if (shd[x >> 5] & bit)                                                                    \
+                shadow_pixel(pPixel[x])                                                               \
+            cov[x >> 5] |= bit;                                                                       \
+            left--;                                                                                   \
         }                                                                                             \
     }                                                                                                 \
 }
 
-void hwsprites::render(const uint8_t priority)
+#define draw_pixel_front()                                                                            \
+{                                                                                                     \
+    if (x >= x1 && x < x2 && pix != 0 && pix != 15)                                                   \
+        plot_front()                                                                                  \
+}
+
+// Draw a row straight from the sprite data, a pixel at a time.
+#define draw_words(draw)                                                                              \
+{                                                                                                     \
+    int32_t xacc = 0;                                                                                 \
+                                                                                                      \
+    /* non-flipped case */                                                                            \
+    if (flip == 0)                                                                                    \
+    {                                                                                                 \
+        /* start at the word before because we preincrement below */                                  \
+        ramBuff[data+7] = (addr - 1);                                                                 \
+                                                                                                      \
+        for (x = xpos; (xdelta > 0 && x < WIDTH) || (xdelta < 0 && x >= 0); )                         \
+        {                                                                                             \
+            uint32_t pixels = spritedata[++ramBuff[data+7]];                                          \
+                                                                                                      \
+            /* draw eight pixels */                                                                   \
+            pix = (pixels >> 28) & 0xf; while (xacc < 0x200) { draw(); x += xdelta; xacc += hzoom; } xacc -= 0x200; \
+            pix = (pixels >> 24) & 0xf; while (xacc < 0x200) { draw(); x += xdelta; xacc += hzoom; } xacc -= 0x200; \
+            pix = (pixels >> 20) & 0xf; while (xacc < 0x200) { draw(); x += xdelta; xacc += hzoom; } xacc -= 0x200; \
+            pix = (pixels >> 16) & 0xf; while (xacc < 0x200) { draw(); x += xdelta; xacc += hzoom; } xacc -= 0x200; \
+            pix = (pixels >> 12) & 0xf; while (xacc < 0x200) { draw(); x += xdelta; xacc += hzoom; } xacc -= 0x200; \
+            pix = (pixels >>  8) & 0xf; while (xacc < 0x200) { draw(); x += xdelta; xacc += hzoom; } xacc -= 0x200; \
+            pix = (pixels >>  4) & 0xf; while (xacc < 0x200) { draw(); x += xdelta; xacc += hzoom; } xacc -= 0x200; \
+            pix = (pixels >>  0) & 0xf; while (xacc < 0x200) { draw(); x += xdelta; xacc += hzoom; } xacc -= 0x200; \
+                                                                                                      \
+            /* stop if the second-to-last pixel in the group was 0xf */                               \
+            if ((pixels & 0x000000f0) == 0x000000f0)                                                  \
+                break;                                                                                \
+        }                                                                                             \
+    }                                                                                                 \
+    /* flipped case */                                                                                \
+    else                                                                                              \
+    {                                                                                                 \
+        /* start at the word after because we predecrement below */                                   \
+        ramBuff[data+7] = (addr + 1);                                                                 \
+                                                                                                      \
+        for (x = xpos; (xdelta > 0 && x < WIDTH) || (xdelta < 0 && x >= 0); )                         \
+        {                                                                                             \
+            uint32_t pixels = spritedata[--ramBuff[data+7]];                                          \
+                                                                                                      \
+            /* draw eight pixels */                                                                   \
+            pix = (pixels >>  0) & 0xf; while (xacc < 0x200) { draw(); x += xdelta; xacc += hzoom; } xacc -= 0x200; \
+            pix = (pixels >>  4) & 0xf; while (xacc < 0x200) { draw(); x += xdelta; xacc += hzoom; } xacc -= 0x200; \
+            pix = (pixels >>  8) & 0xf; while (xacc < 0x200) { draw(); x += xdelta; xacc += hzoom; } xacc -= 0x200; \
+            pix = (pixels >> 12) & 0xf; while (xacc < 0x200) { draw(); x += xdelta; xacc += hzoom; } xacc -= 0x200; \
+            pix = (pixels >> 16) & 0xf; while (xacc < 0x200) { draw(); x += xdelta; xacc += hzoom; } xacc -= 0x200; \
+            pix = (pixels >> 20) & 0xf; while (xacc < 0x200) { draw(); x += xdelta; xacc += hzoom; } xacc -= 0x200; \
+            pix = (pixels >> 24) & 0xf; while (xacc < 0x200) { draw(); x += xdelta; xacc += hzoom; } xacc -= 0x200; \
+            pix = (pixels >> 28) & 0xf; while (xacc < 0x200) { draw(); x += xdelta; xacc += hzoom; } xacc -= 0x200; \
+                                                                                                      \
+            /* stop if the second-to-last pixel in the group was 0xf */                               \
+            if ((pixels & 0x0f000000) == 0x0f000000)                                                  \
+                break;                                                                                \
+        }                                                                                             \
+    }                                                                                                 \
+}
+
+// Unpack the sprite parameters used by the row drawing code
+#define unpack_sprite(s)                              \
+    const uint32_t* spritedata = s->spritedata;       \
+    const uint32_t addr   = s->addr;                  \
+    const int32_t bank    = s->bank;                  \
+    const int32_t xpos    = s->xpos;                  \
+    const int32_t xdelta  = s->xdelta;                \
+    const int32_t flip    = s->flip;                  \
+    const int32_t hzoom   = s->hzoom;                 \
+    const int32_t color   = s->color;                 \
+    const uint8_t shadow  = s->shadow;                \
+    const uint16_t* shadow_map = video.shadow_map;    \
+    int32_t x, pix;
+
+// Return the expanded row, from the cache if possible. NULL if the row is too wide to cache.
+const hwsprites::row_entry_t* hwsprites::get_row(const uint32_t* spritedata, const int32_t bank, const int32_t flip, const int32_t hzoom, const uint16_t addr)
+{
+    const uint32_t key = row_key(bank, flip, hzoom, addr);
+    row_entry_t* set   = &row_cache[((key * 2654435761u) >> 16) & (ROW_CACHE_SETS - 1)];
+    row_entry_t* lru   = set;
+
+    row_cache_time++;
+
+    for (uint32_t i = 0; i < ROW_CACHE_WAYS; i++)
+    {
+        row_entry_t* row = &set[i];
+        if (row->used && row->key == key)
+        {
+            row->used = row_cache_time;
+            row_cache_hits++;
+            return row;
+        }
+
+        if (row->used < lru->used)
+            lru = row;
+    }
+
+    row_cache_misses++;
+
+    if (!expand_row(lru, spritedata, flip, hzoom, addr))
+    {
+        lru->used = 0;
+        return NULL;
+    }
+
+    lru->key  = key;
+    lru->used = row_cache_time;
+    return lru;
+}
+
+// Expand a row of sprite data to one pen per screen pixel, in the same way as render().
+// Returns false if the row does not fit in the cache.
+bool hwsprites::expand_row(row_entry_t* row, const uint32_t* spritedata, const int32_t flip, const int32_t hzoom, const uint16_t addr)
+{
+    uint16_t a    = flip ? (addr + 1) : (addr - 1);
+    int32_t xacc  = 0;
+    uint32_t n    = 0;
+    uint16_t words = 0;
+
+    for (;;)
+    {
+        const uint32_t pixels = spritedata[flip ? --a : ++a];
+        words++;
+
+        for (int p = 0; p < 8; p++)
+        {
+            const uint8_t pix = flip ? (pixels >> (p << 2)) & 0xf : (pixels >> (28 - (p << 2))) & 0xf;
+
+            while (xacc < 0x200)
+            {
+                if (n == ROW_CACHE_PIXELS)
+                    return false;
+                row->pens[n++] = pix;
+                xacc += hzoom;
+            }
+            xacc -= 0x200;
+        }
+
+        // stop if the second-to-last pixel in the group was 0xf
+        if (flip ? (pixels & 0x0f000000) == 0x0f000000 : (pixels & 0x000000f0) == 0x000000f0)
+            break;
+    }
+
+    row->length = n;
+    row->words  = words;
+    return true;
+}
+
+// Decode a sprite list entry. Returns false if the sprite is hidden.
+template <int SCALE, int WIDTH>
+bool hwsprites::setup_sprite(const uint16_t data, sprite_t* s)
 {
     const uint32_t numbanks = SPRITES_LENGTH / 0x10000;
 
+    // if hidden, or top greater than/equal to bottom, or invalid bank, punt
+    int16_t hide    = (ramBuff[data+0] & 0x5000);
+    int32_t height  = (ramBuff[data+5] >> 8) + 1;
+    if (hide != 0 || height == 0) return false;
+
+    int16_t bank    = (ramBuff[data+0] >> 9) & 7;
+    int32_t top     = (ramBuff[data+0] & 0x1ff) - 0x100;
+    uint32_t addr   = ramBuff[data+1];
+    int32_t pitch   = ((ramBuff[data+2] >> 1) | ((ramBuff[data+4] & 0x1000) << 3)) >> 8;
+    int32_t xpos    =  ramBuff[data+6]; // moved from original structure to accomodate widescreen
+    uint8_t shadow  = (ramBuff[data+3] >> 14) & 1;
+    int32_t vzoom   = ramBuff[data+3] & 0x7ff;
+    int32_t ydelta  = ((ramBuff[data+4] & 0x8000) != 0) ? 1 : -1;
+    int32_t flip    = (~ramBuff[data+4] >> 14) & 1;
+    int32_t xdelta  = ((ramBuff[data+4] & 0x2000) != 0) ? 1 : -1;
+    int32_t hzoom   = ramBuff[data+4] & 0x7ff;
+    int32_t color   = COLOR_BASE + ((ramBuff[data+5] & 0x7f) << 4);
+    int32_t ytarget;
+
+    // adjust X coordinate
+    // note: the threshhold below is a guess. If it is too high, rachero will draw garbage
+    // If it is too low, smgp won't draw the bottom part of the road
+    if (xpos < 0x80 && xdelta < 0)
+        xpos += 0x200;
+    xpos -= 0xbe;
+
+    // initialize the end address to the start address
+    ramBuff[data+7] = addr;
+
+    // clamp to within the memory region size
+    if (numbanks)
+        bank %= numbanks;
+
+    // clamp to a maximum of 8x (not 100% confirmed)
+    if (vzoom < 0x40) vzoom = 0x40;
+    if (hzoom < 0x40) hzoom = 0x40;
+
+    // loop from top to bottom
+    ytarget = top + ydelta * height;
+
+    // Adjust for widescreen mode
+    xpos += ((WIDTH / SCALE) - S16_WIDTH) / 2;
+
+    // Adjust for hi-res mode
+    if (SCALE > 1)
+    {
+        xpos    *= SCALE;
+        top     *= SCALE;
+        ytarget *= SCALE;
+        hzoom   /= SCALE;
+        vzoom   /= SCALE;
+    }
+
+    s->spritedata = sprites + 0x10000 * bank;
+    s->bank       = bank;
+    s->top        = top;
+    s->ytarget    = ytarget;
+    s->addr       = addr;
+    s->pitch      = pitch;
+    s->xpos       = xpos;
+    s->shadow     = shadow;
+    s->vzoom      = vzoom;
+    s->ydelta     = ydelta;
+    s->flip       = flip;
+    s->xdelta     = xdelta;
+    s->hzoom      = hzoom;
+    s->color      = color;
+    return true;
+}
+
+// Range of indices into an expanded row that fall within the clip window
+void hwsprites::clip_row(const sprite_t* s, const row_entry_t* row, int32_t* first, int32_t* last)
+{
+    if (s->xdelta > 0)
+    {
+        *first = x1 - s->xpos;
+        *last  = x2 - s->xpos;
+    }
+    else
+    {
+        *first = s->xpos - (x2 - 1);
+        *last  = s->xpos - x1 + 1;
+    }
+    if (*first < 0) *first = 0;
+    if (*last > row->length) *last = row->length;
+}
+
+void hwsprites::render(const uint8_t priority)
+{
+    if (config.video.sprites_front)
+        (this->*render_front)(priority);
+    else
+        (this->*render_back)(priority);
+}
+
+template <int SCALE, int WIDTH>
+void hwsprites::render_back_scaled(const uint8_t priority)
+{
+    sprite_t s;
+
     for (uint16_t data = 0; data < SPRITE_RAM_SIZE; data += 8) 
     {
         // stop when we hit the end of sprite list
@@ -167,124 +474,183 @@ void hwsprites::render(const uint8_t priority)
         uint32_t sprpri  = 1 << ((ramBuff[data+3] >> 12) & 3);
         if (sprpri != priority) continue;
 
-        // if hidden, or top greater than/equal to bottom, or invalid bank, punt
-        int16_t hide    = (ramBuff[data+0] & 0x5000);
-        int32_t height  = (ramBuff[data+5] >> 8) + 1;       
-        if (hide != 0 || height == 0) continue;
-        
-        int16_t bank    = (ramBuff[data+0] >> 9) & 7;
-        int32_t top     = (ramBuff[data+0] & 0x1ff) - 0x100;
-        uint32_t addr    = ramBuff[data+1];
-        int32_t pitch  = ((ramBuff[data+2] >> 1) | ((ramBuff[data+4] & 0x1000) << 3)) >> 8;
-        int32_t xpos    =  ramBuff[data+6]; // moved from original structure to accomodate widescreen
-        uint8_t shadow  = (ramBuff[data+3] >> 14) & 1;
-        int32_t vzoom    = ramBuff[data+3] & 0x7ff;
-        int32_t ydelta = ((ramBuff[data+4] & 0x8000) != 0) ? 1 : -1;
-        int32_t flip   = (~ramBuff[data+4] >> 14) & 1;
-        int32_t xdelta = ((ramBuff[data+4] & 0x2000) != 0) ? 1 : -1;
-        int32_t hzoom    = ramBuff[data+4] & 0x7ff;     
-        int32_t color   = COLOR_BASE + ((ramBuff[data+5] & 0x7f) << 4);
-        int32_t x, y, ytarget, yacc = 0, pix;
-            
-        // adjust X coordinate
-        // note: the threshhold below is a guess. If it is too high, rachero will draw garbage
-        // If it is too low, smgp won't draw the bottom part of the road
-        if (xpos < 0x80 && xdelta < 0)
-            xpos += 0x200;
-        xpos -= 0xbe;
-
-        // initialize the end address to the start address
-        ramBuff[data+7] = addr;
-
-        // clamp to within the memory region size
-        if (numbanks)
-            bank %= numbanks;
-
-        const uint32_t* spritedata = sprites + 0x10000 * bank;
-
-        // clamp to a maximum of 8x (not 100% confirmed)
-        if (vzoom < 0x40) vzoom = 0x40;
-        if (hzoom < 0x40) hzoom = 0x40;
-
-        // loop from top to bottom
-        ytarget = top + ydelta * height;
-
-        // Adjust for widescreen mode
-        xpos += config.s16_x_off;
-
-        // Adjust for hi-res mode
-        if (config.video.hires)
+        if (!setup_sprite<SCALE, WIDTH>(data, &s)) continue;
+
+        int32_t yacc = 0;
+
+        for (int32_t y = s.top; y != s.ytarget; y += s.ydelta)
         {
-            xpos <<= 1;
-            top <<= 1;
-            ytarget <<= 1;
-            hzoom >>= 1;
-            vzoom >>= 1;
+            // skip drawing if not within the cliprect
+            if (y >= 0 && y < S16_HEIGHT * SCALE)
+                draw_row<WIDTH>(&s, data, &video.pixels[y * WIDTH]);
+
+            // accumulate zoom factors; if we carry into the high bit, skip an extra row
+            yacc += s.vzoom; 
+            s.addr += s.pitch * (yacc >> 9);
+            yacc &= 0x1ff;
         }
+    }
+}
+
+template <int WIDTH>
+void hwsprites::draw_row(const sprite_t* s, const uint16_t data, uint16_t* pPixel)
+{
+    unpack_sprite(s);
+
+    const row_entry_t* row = get_row(spritedata, bank, flip, hzoom, addr);
 
-        for (y = top; y != ytarget; y += ydelta)
+    // cached case: copy the visible part of the expanded row
+    if (row != NULL)
+    {
+        int32_t first, last;
+        clip_row(s, row, &first, &last);
+
+        for (int32_t i = first; i < last; i++)
         {
-            // skip drawing if not within the cliprect
-            if (y >= 0 && y < config.s16_height)
+            pix = row->pens[i];
+            if (pix != 0 && pix != 15)
             {
-                uint16_t* pPixel = &video.pixels[y * config.s16_width];
-                int32_t xacc = 0;
-
-                // non-flipped case
-                if (flip == 0)
-                {
-                    // start at the word before because we preincrement below
-                    ramBuff[data+7] = (addr - 1);
-
-                    for (x = xpos; (xdelta > 0 && x < config.s16_width) || (xdelta < 0 && x >= 0); )
-                    {
-                        uint32_t pixels = spritedata[++ramBuff[data+7]]; // Add to base sprite data the vzoom value
-
-                        // draw four pixels
-                        pix = (pixels >> 28) & 0xf; while (xacc < 0x200) { draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
-                        pix = (pixels >> 24) & 0xf; while (xacc < 0x200) { draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
-                        pix = (pixels >> 20) & 0xf; while (xacc < 0x200) { draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
-                        pix = (pixels >> 16) & 0xf; while (xacc < 0x200) { draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
-                        pix = (pixels >> 12) & 0xf; while (xacc < 0x200) { draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
-                        pix = (pixels >>  8) & 0xf; while (xacc < 0x200) { draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
-                        pix = (pixels >>  4) & 0xf; while (xacc < 0x200) { draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
-                        pix = (pixels >>  0) & 0xf; while (xacc < 0x200) { draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
-
-                        // stop if the second-to-last pixel in the group was 0xf
-                        if ((pixels & 0x000000f0) == 0x000000f0)
-                            break;
-                    }
-                }
-                // flipped case
+                x = xpos + (i * xdelta);
+                if (shadow && pix == 0xa)
+                    shadow_pixel(pPixel[x])
                 else
-                {
-                    // start at the word after because we predecrement below
-                    ramBuff[data+7] = (addr + 1);
-
-                    for (x = xpos; (xdelta > 0 && x < config.s16_width) || (xdelta < 0 && x >= 0); )
-                    {
-                        uint32_t pixels = spritedata[--ramBuff[data+7]];
-
-                        // draw four pixels
-                        pix = (pixels >>  0) & 0xf; while (xacc < 0x200) { draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
-                        pix = (pixels >>  4) & 0xf; while (xacc < 0x200) { draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
-                        pix = (pixels >>  8) & 0xf; while (xacc < 0x200) { draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
-                        pix = (pixels >> 12) & 0xf; while (xacc < 0x200) { draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
-                        pix = (pixels >> 16) & 0xf; while (xacc < 0x200) { draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
-                        pix = (pixels >> 20) & 0xf; while (xacc < 0x200) { draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
-                        pix = (pixels >> 24) & 0xf; while (xacc < 0x200) { draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
-                        pix = (pixels >> 28) & 0xf; while (xacc < 0x200) { draw_pixel(); x += xdelta; xacc += hzoom; } xacc -= 0x200;
-
-                        // stop if the second-to-last pixel in the group was 0xf
-                        if ((pixels & 0x0f000000) == 0x0f000000)
-                            break;
-                    }
-                }
+                    pPixel[x] = (pix | color);
             }
+        }
+
+        ramBuff[data+7] = flip ? (addr + 1 - row->words) : (addr - 1 + row->words);
+    }
+    else
+    {
+        draw_words(draw_pixel);
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// Front to back rendering.
+//
+// The sprite list is drawn back to front, so distant scenery is drawn in full and then
+// overdrawn by nearer objects. Instead, walk the list backwards and keep a coverage bitmap
+// per scanline. Pixels that are already opaque are skipped, as are fully covered scanlines.
+//
+// Shadows darken whatever is drawn below them, and shadowing twice has no further effect.
+// So shadow pixels are only recorded, and applied to the opaque pixel that is eventually
+// drawn underneath, or to the tile and road layers once the list is finished.
+// ------------------------------------------------------------------------------------------------
+
+template <int SCALE, int WIDTH>
+void hwsprites::render_front_scaled(const uint8_t priority)
+{
+    if (cover == NULL)
+    {
+        cover = new uint32_t[COVER_LINES * COVER_WORDS * 2];
+        shade = cover + (COVER_LINES * COVER_WORDS);
+        for (uint32_t i = 0; i < COVER_LINES * COVER_WORDS * 2; i++)
+            cover[i] = 0;
+    }
+
+    // Find the sprites to draw, in list order
+    uint16_t list[SPRITE_RAM_SIZE / 8];
+    int count = 0;
+
+    for (uint16_t data = 0; data < SPRITE_RAM_SIZE; data += 8)
+    {
+        // stop when we hit the end of sprite list
+        if ((ramBuff[data+0] & 0x8000) != 0) break;
+
+        uint32_t sprpri  = 1 << ((ramBuff[data+3] >> 12) & 3);
+        if (sprpri == priority)
+            list[count++] = data;
+    }
+
+    for (int32_t y = 0; y < S16_HEIGHT * SCALE; y++)
+        open[y] = x2 - x1;
+
+    sprite_t s;
+
+    for (int i = count - 1; i >= 0; i--)
+    {
+        const uint16_t data = list[i];
+        if (!setup_sprite<SCALE, WIDTH>(data, &s)) continue;
+
+        int32_t yacc = 0;
+
+        for (int32_t y = s.top; y != s.ytarget; y += s.ydelta)
+        {
+            // skip drawing if not within the cliprect, or nothing more can be seen
+            if (y >= 0 && y < S16_HEIGHT * SCALE && open[y] != 0)
+                draw_row_front<WIDTH>(&s, data, y);
+
             // accumulate zoom factors; if we carry into the high bit, skip an extra row
-            yacc += vzoom; 
-            addr += pitch * (yacc >> 9);
+            yacc += s.vzoom; 
+            s.addr += s.pitch * (yacc >> 9);
             yacc &= 0x1ff;
         }
     }
-}
\ No newline at end of file
+
+    // Apply the remaining shadows to the layers below, and clear the bitmaps for next time
+    if (x2 <= x1)
+        return;
+
+    const uint16_t* shadow_map = video.shadow_map;
+
+    for (int32_t y = 0; y < S16_HEIGHT * SCALE; y++)
+    {
+        uint16_t* pPixel = &video.pixels[y * WIDTH];
+        uint32_t* cov    = &cover[y * COVER_WORDS];
+        uint32_t* shd    = &shade[y * COVER_WORDS];
+
+        for (int32_t w = x1 >> 5; w <= (x2 - 1) >> 5; w++)
+        {
+            uint32_t bits = shd[w] & ~cov[w];
+            while (bits)
+            {
+                int32_t x = (w << 5);
+                while ((bits & (1u << (x & 31))) == 0)
+                    x++;
+                bits &= ~(1u << (x & 31));
+                shadow_pixel(pPixel[x])
+            }
+            cov[w] = 0;
+            shd[w] = 0;
+        }
+    }
+}
+
+template <int WIDTH>
+void hwsprites::draw_row_front(const sprite_t* s, const uint16_t data, const int32_t y)
+{
+    unpack_sprite(s);
+
+    uint16_t* pPixel = &video.pixels[y * WIDTH];
+    uint32_t* cov    = &cover[y * COVER_WORDS];
+    uint32_t* shd    = &shade[y * COVER_WORDS];
+    uint16_t left    = open[y];
+
+    const row_entry_t* row = get_row(spritedata, bank, flip, hzoom, addr);
+
+    // cached case: copy the visible, uncovered, part of the expanded row
+    if (row != NULL)
+    {
+        int32_t first, last;
+        clip_row(s, row, &first, &last);
+
+        for (int32_t i = first; i < last && left; i++)
+        {
+            pix = row->pens[i];
+            if (pix != 0 && pix != 15)
+            {
+                x = xpos + (i * xdelta);
+                plot_front();
+            }
+        }
+
+        ramBuff[data+7] = flip ? (addr + 1 - row->words) : (addr - 1 + row->words);
+    }
+    else
+    {
+        draw_words(draw_pixel_front);
+    }
+
+    open[y] = left;
+}
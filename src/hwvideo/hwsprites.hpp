@@ -1,6 +1,7 @@
 #pragma once
 
 #include "stdint.hpp"
+#include "globals.hpp"
 
 class video;
 
@@ -10,6 +11,7 @@ public:
     hwsprites();
     ~hwsprites();
     void init(const uint8_t*);
+    void set_mode(const bool hires, const bool widescreen);
     void reset();
     void set_x_clip(bool);
     void swap();
@@ -17,19 +19,108 @@ public:
     void write(const uint16_t adr, const uint16_t data);
     void render(const uint8_t);
 
+    // Converted sprites (shared by all instances).
+    // Points to sprites_decoded, or to the graphics cache when it has been mapped.
+    static const uint32_t SPRITES_LENGTH = 0x100000 >> 2;
+    static const uint32_t* sprites;
+
+    // Zoomed row cache statistics
+    uint32_t row_cache_hits;
+    uint32_t row_cache_misses;
+
 private:
     // Clip values.
     uint16_t x1, x2;
 
     // 128 sprites, 16 bytes each (0x400)
     static const uint16_t SPRITE_RAM_SIZE = 128 * 8;
-    static const uint32_t SPRITES_LENGTH = 0x100000 >> 2;
     static const uint16_t COLOR_BASE = 0x800;
 
-    uint32_t sprites[SPRITES_LENGTH]; // Converted sprites
+    static uint32_t sprites_decoded[SPRITES_LENGTH]; // Sprites converted from the source rom
     
     // Two halves of RAM
     uint16_t ram[SPRITE_RAM_SIZE];
     uint16_t ramBuff[SPRITE_RAM_SIZE];
+
+    // Sprite list entry, decoded and adjusted for the screen mode
+    struct sprite_t
+    {
+        const uint32_t* spritedata;
+        uint32_t addr;
+        int32_t bank, top, ytarget, pitch, xpos, vzoom, hzoom;
+        int32_t ydelta, xdelta, flip, color;
+        uint8_t shadow;
+    };
+
+    // Sprite list renderers for the current screen size. See set_mode().
+    void (hwsprites::*render_back)(const uint8_t priority);
+    void (hwsprites::*render_front)(const uint8_t priority);
+
+    // Renderers for each screen size. Sprites are scaled by SCALE, to a buffer WIDTH pixels wide.
+    template <int SCALE, int WIDTH>
+    void set_kernels();
+
+    template <int SCALE, int WIDTH>
+    bool setup_sprite(const uint16_t data, sprite_t* s);
+
+    template <int SCALE, int WIDTH>
+    void render_back_scaled(const uint8_t priority);
+
+    template <int WIDTH>
+    void draw_row(const sprite_t* s, const uint16_t data, uint16_t* pPixel);
+
+    // ------------------------------------------------------------------------
+    // Front to back rendering (config.video.sprites_front). See render_front_scaled().
+    // ------------------------------------------------------------------------
+
+    static const uint32_t COVER_LINES = S16_HEIGHT << 1;
+    static const uint32_t COVER_WORDS = ((S16_WIDTH_WIDE << 1) + 31) >> 5;
+
+    uint32_t* cover;            // 1 bit per pixel: opaque sprite pixel drawn
+    uint32_t* shade;            // 1 bit per pixel: shadow to apply to the pixel below
+    uint16_t open[COVER_LINES]; // Pixels on each line not yet covered
+
+    template <int SCALE, int WIDTH>
+    void render_front_scaled(const uint8_t priority);
+
+    template <int WIDTH>
+    void draw_row_front(const sprite_t* s, const uint16_t data, const int32_t y);
+
+    // ------------------------------------------------------------------------
+    // Zoomed row cache.
+    //
+    // Scenery draws the same sprite rows at the same zoom many times a frame.
+    // Rows are expanded to one pen per screen pixel, so that repeats only need
+    // to be copied. Set associative, with least recently used replacement.
+    // ------------------------------------------------------------------------
+
+#ifdef LOW_MEMORY
+    static const uint32_t ROW_CACHE_SETS = 32;
+#else
+    static const uint32_t ROW_CACHE_SETS = 128;
+#endif
+    static const uint32_t ROW_CACHE_WAYS   = 4;
+    static const uint32_t ROW_CACHE_PIXELS = 512; // Wider rows are not cached
+
+    struct row_entry_t
+    {
+        uint32_t key;       // Bank, flip, zoom and address. See row_key().
+        uint32_t used;      // Time last used. 0 = empty.
+        uint16_t length;    // Pixels in row
+        uint16_t words;     // Words of sprite data read
+        uint8_t pens[ROW_CACHE_PIXELS];
+    };
+
+    row_entry_t* row_cache;
+    uint32_t row_cache_time;
+
+    static inline uint32_t row_key(const int32_t bank, const int32_t flip, const int32_t hzoom, const uint16_t addr)
+    {
+        return (bank << 29) | (flip << 28) | (hzoom << 16) | addr;
+    }
+
+    void clip_row(const sprite_t* s, const row_entry_t* row, int32_t* first, int32_t* last);
+    const row_entry_t* get_row(const uint32_t* spritedata, const int32_t bank, const int32_t flip, const int32_t hzoom, const uint16_t addr);
+    bool expand_row(row_entry_t* row, const uint32_t* spritedata, const int32_t flip, const int32_t hzoom, const uint16_t addr);
 };
 
@@ -76,8 +76,16 @@
  *
  *******************************************************************************************/
 
+uint32_t hwtiles::tiles_decoded[hwtiles::TILES_LENGTH];
+const uint32_t* hwtiles::tiles_base = hwtiles::tiles_decoded;
+
 hwtiles::hwtiles(void)
 {
+    tiles         = tiles_base;
+#ifndef TILE_JOURNAL
+    tiles_patched = NULL;
+#endif
+
     for (int i = 0; i < 2; i++)
         tile_banks[i] = i;
 
@@ -86,11 +94,14 @@ hwtiles::hwtiles(void)
 
 hwtiles::~hwtiles(void)
 {
-
+#ifndef TILE_JOURNAL
+    if (tiles_patched)
+        delete[] tiles_patched;
+#endif
 }
 
 // Convert S16 tiles to a more useable format
-void hwtiles::init(uint8_t* src_tiles, const bool hires)
+void hwtiles::init(uint8_t* src_tiles)
 {
     if (src_tiles)
     {
@@ -108,48 +119,111 @@ void hwtiles::init(uint8_t* src_tiles, const bool hires)
                 uint8_t pix = ((((p0 >> bit)) & 1) | (((p1 >> bit) << 1) & 2) | (((p2 >> bit) << 2) & 4));
                 val = (val << 4) | pix;
             }
-            tiles[i] = val; // Store converted value
+            tiles_decoded[i] = val; // Store converted value
         }
-        memcpy(tiles_backup, tiles, TILES_LENGTH * sizeof(uint32_t));
+        tiles_base = tiles_decoded;
     }
-    
+
+    // The converted tiles may have moved (see gfxcache.hpp)
+#ifdef TILE_JOURNAL
+    tiles = tiles_base;
+#else
+    if (tiles != tiles_patched)
+        tiles = tiles_base;
+#endif
+}
+
+// Select the renderers for the screen size. Called whenever the video mode changes.
+void hwtiles::set_mode(const bool hires, const bool widescreen)
+{
+    s16_width_noscale = widescreen ? S16_WIDTH_WIDE : S16_WIDTH;
+
     if (hires)
     {
-        s16_width_noscale = config.s16_width >> 1;
-        render8x8_tile_mask      = &hwtiles::render8x8_tile_mask_hires;
-        render8x8_tile_mask_clip = &hwtiles::render8x8_tile_mask_clip_hires;
+        if (widescreen) set_kernels<2, S16_WIDTH_WIDE * 2>();
+        else            set_kernels<2, S16_WIDTH * 2>();
     }
     else
     {
-        s16_width_noscale = config.s16_width;
-        render8x8_tile_mask      = &hwtiles::render8x8_tile_mask_lores;
-        render8x8_tile_mask_clip = &hwtiles::render8x8_tile_mask_clip_lores;
+        if (widescreen) set_kernels<1, S16_WIDTH_WIDE>();
+        else            set_kernels<1, S16_WIDTH>();
     }
 }
 
+template <int SCALE, int WIDTH>
+void hwtiles::set_kernels()
+{
+    render8x8_tile_mask      = &hwtiles::render8x8_tile_mask_scaled<SCALE, WIDTH>;
+    render8x8_tile_mask_clip = &hwtiles::render8x8_tile_mask_clip_scaled<SCALE, WIDTH>;
+}
+
 // Patch Tileset with new data
+#ifdef TILE_JOURNAL
+//
+// The tiles are patched in place. The rows that are overwritten are recorded, so restoring
+// them only costs time in proportion to the size of the patch.
+void hwtiles::patch_tiles(RomLoader* patch)
+{
+    uint32_t* dst = const_cast<uint32_t*>(tiles_base);
+
+    for (uint32_t i = 0; i < patch->length;)
+    {
+        const uint32_t tile_index = patch->read16(&i) << 3;
+
+        journal.push_back(tile_index);
+        journal.insert(journal.end(), dst + tile_index, dst + tile_index + 8);
+
+        for (int row = 0; row < 8; row++)
+            dst[tile_index + row] = patch->read32(&i);
+    }
+}
+
+void hwtiles::restore_tiles()
+{
+    uint32_t* dst = const_cast<uint32_t*>(tiles_base);
+
+    // Undo in reverse order, in case a tile was patched more than once
+    for (size_t j = journal.size(); j > 0;)
+    {
+        j -= 9;
+        memcpy(dst + journal[j], &journal[j + 1], 8 * sizeof(uint32_t));
+    }
+
+    journal.clear();
+}
+#else
+//
+// The shared tileset is never written to. The patch is applied to a private copy instead.
 void hwtiles::patch_tiles(RomLoader* patch)
 {
-    memcpy(tiles_backup, tiles, TILES_LENGTH * sizeof(uint32_t));
+    if (tiles_patched == NULL)
+        tiles_patched = new uint32_t[TILES_LENGTH];
+
+    if (tiles == tiles_base)
+    {
+        memcpy(tiles_patched, tiles_base, TILES_LENGTH * sizeof(uint32_t));
+        tiles = tiles_patched;
+    }
 
     for (uint32_t i = 0; i < patch->length;)
     {
         uint32_t tile_index = patch->read16(&i) << 3;
-        tiles[tile_index++] = patch->read32(&i);
-        tiles[tile_index++] = patch->read32(&i);
-        tiles[tile_index++] = patch->read32(&i);
-        tiles[tile_index++] = patch->read32(&i);
-        tiles[tile_index++] = patch->read32(&i);
-        tiles[tile_index++] = patch->read32(&i);
-        tiles[tile_index++] = patch->read32(&i);
-        tiles[tile_index++] = patch->read32(&i);
+        tiles_patched[tile_index++] = patch->read32(&i);
+        tiles_patched[tile_index++] = patch->read32(&i);
+        tiles_patched[tile_index++] = patch->read32(&i);
+        tiles_patched[tile_index++] = patch->read32(&i);
+        tiles_patched[tile_index++] = patch->read32(&i);
+        tiles_patched[tile_index++] = patch->read32(&i);
+        tiles_patched[tile_index++] = patch->read32(&i);
+        tiles_patched[tile_index++] = patch->read32(&i);
     }
 }
 
 void hwtiles::restore_tiles()
 {
-    memcpy(tiles, tiles_backup, TILES_LENGTH * sizeof(uint32_t));
+    tiles = tiles_base;
 }
+#endif
 
 // Set Tilemap X Clamp
 //
@@ -314,101 +388,13 @@ void hwtiles::render_text_layer(uint16_t* buf, uint8_t priority_draw)
     }
 }
 
-void hwtiles::render8x8_tile_mask_lores(
-    uint16_t *buf,
-    uint16_t nTileNumber, 
-    uint16_t StartX, 
-    uint16_t StartY, 
-    uint16_t nTilePalette, 
-    uint16_t nColourDepth, 
-    uint16_t nMaskColour, 
-    uint16_t nPaletteOffset) 
-{
-    uint32_t nPalette = (nTilePalette << nColourDepth) | nMaskColour;
-    uint32_t* pTileData = tiles + (nTileNumber << 3);
-    buf += (StartY * config.s16_width) + StartX;
-
-    for (int y = 0; y < 8; y++) 
-    {
-        uint32_t p0 = *pTileData;
-
-        if (p0 != nMaskColour) 
-        {
-            uint32_t c7 = p0 & 0xf;
-            uint32_t c6 = (p0 >> 4) & 0xf;
-            uint32_t c5 = (p0 >> 8) & 0xf;
-            uint32_t c4 = (p0 >> 12) & 0xf;
-            uint32_t c3 = (p0 >> 16) & 0xf;
-            uint32_t c2 = (p0 >> 20) & 0xf;
-            uint32_t c1 = (p0 >> 24) & 0xf;
-            uint32_t c0 = (p0 >> 28);
-
-            if (c0) buf[0] = nPalette + c0;
-            if (c1) buf[1] = nPalette + c1;
-            if (c2) buf[2] = nPalette + c2;
-            if (c3) buf[3] = nPalette + c3;
-            if (c4) buf[4] = nPalette + c4;
-            if (c5) buf[5] = nPalette + c5;
-            if (c6) buf[6] = nPalette + c6;
-            if (c7) buf[7] = nPalette + c7;
-        }
-        buf += config.s16_width;
-        pTileData++;
-    }
-}
-
-void hwtiles::render8x8_tile_mask_clip_lores(
-    uint16_t *buf,
-    uint16_t nTileNumber, 
-    int16_t StartX, 
-    int16_t StartY, 
-    uint16_t nTilePalette, 
-    uint16_t nColourDepth, 
-    uint16_t nMaskColour, 
-    uint16_t nPaletteOffset) 
-{
-    uint32_t nPalette = (nTilePalette << nColourDepth) | nMaskColour;
-    uint32_t* pTileData = tiles + (nTileNumber << 3);
-    buf += (StartY * config.s16_width) + StartX;
-
-    for (int y = 0; y < 8; y++) 
-    {
-        if ((StartY + y) >= 0 && (StartY + y) < S16_HEIGHT) 
-        {
-            uint32_t p0 = *pTileData;
-
-            if (p0 != nMaskColour) 
-            {
-                uint32_t c7 = p0 & 0xf;
-                uint32_t c6 = (p0 >> 4) & 0xf;
-                uint32_t c5 = (p0 >> 8) & 0xf;
-                uint32_t c4 = (p0 >> 12) & 0xf;
-                uint32_t c3 = (p0 >> 16) & 0xf;
-                uint32_t c2 = (p0 >> 20) & 0xf;
-                uint32_t c1 = (p0 >> 24) & 0xf;
-                uint32_t c0 = (p0 >> 28);
-
-                if (c0 && 0 + StartX >= 0 && 0 + StartX < config.s16_width) buf[0] = nPalette + c0;
-                if (c1 && 1 + StartX >= 0 && 1 + StartX < config.s16_width) buf[1] = nPalette + c1;
-                if (c2 && 2 + StartX >= 0 && 2 + StartX < config.s16_width) buf[2] = nPalette + c2;
-                if (c3 && 3 + StartX >= 0 && 3 + StartX < config.s16_width) buf[3] = nPalette + c3;
-                if (c4 && 4 + StartX >= 0 && 4 + StartX < config.s16_width) buf[4] = nPalette + c4;
-                if (c5 && 5 + StartX >= 0 && 5 + StartX < config.s16_width) buf[5] = nPalette + c5;
-                if (c6 && 6 + StartX >= 0 && 6 + StartX < config.s16_width) buf[6] = nPalette + c6;
-                if (c7 && 7 + StartX >= 0 && 7 + StartX < config.s16_width) buf[7] = nPalette + c7;
-            }
-        }
-        buf += config.s16_width;
-        pTileData++;
-    }
-}
-
 // ------------------------------------------------------------------------------------------------
-// Additional routines for Hi-Res Mode.
-// Note that the tilemaps are displayed at the same resolution, we just want everything to be
-// proportional.
+// Tile Renderers.
+// In Hi-Res Mode the tilemaps are displayed at the same resolution, with each pixel doubled.
+// We just want everything to be proportional.
 // ------------------------------------------------------------------------------------------------
-void hwtiles::render8x8_tile_mask_hires(
+template <int SCALE, int WIDTH>
+void hwtiles::render8x8_tile_mask_scaled(
     uint16_t *buf,
     uint16_t nTileNumber, 
     uint16_t StartX, 
@@ -419,8 +405,8 @@ void hwtiles::render8x8_tile_mask_hires(
     uint16_t nPaletteOffset) 
 {
     uint32_t nPalette = (nTilePalette << nColourDepth) | nMaskColour;
-    uint32_t* pTileData = tiles + (nTileNumber << 3);
-    buf += ((StartY << 1) * config.s16_width) + (StartX << 1);
+    const uint32_t* pTileData = tiles + (nTileNumber << 3);
+    buf += ((StartY * SCALE) * WIDTH) + (StartX * SCALE);
 
     for (int y = 0; y < 8; y++) 
     {
@@ -437,21 +423,22 @@ void hwtiles::render8x8_tile_mask_hires(
             uint32_t c1 = (p0 >> 24) & 0xf;
             uint32_t c0 = (p0 >> 28);
 
-            if (c0) set_pixel_x4(&buf[0],  nPalette + c0);
-            if (c1) set_pixel_x4(&buf[2],  nPalette + c1);
-            if (c2) set_pixel_x4(&buf[4],  nPalette + c2);
-            if (c3) set_pixel_x4(&buf[6],  nPalette + c3);
-            if (c4) set_pixel_x4(&buf[8],  nPalette + c4);
-            if (c5) set_pixel_x4(&buf[10], nPalette + c5);
-            if (c6) set_pixel_x4(&buf[12], nPalette + c6);
-            if (c7) set_pixel_x4(&buf[14], nPalette + c7);
+            if (c0) set_pixel<SCALE, WIDTH>(&buf[0 * SCALE], nPalette + c0);
+            if (c1) set_pixel<SCALE, WIDTH>(&buf[1 * SCALE], nPalette + c1);
+            if (c2) set_pixel<SCALE, WIDTH>(&buf[2 * SCALE], nPalette + c2);
+            if (c3) set_pixel<SCALE, WIDTH>(&buf[3 * SCALE], nPalette + c3);
+            if (c4) set_pixel<SCALE, WIDTH>(&buf[4 * SCALE], nPalette + c4);
+            if (c5) set_pixel<SCALE, WIDTH>(&buf[5 * SCALE], nPalette + c5);
+            if (c6) set_pixel<SCALE, WIDTH>(&buf[6 * SCALE], nPalette + c6);
+            if (c7) set_pixel<SCALE, WIDTH>(&buf[7 * SCALE], nPalette + c7);
         }
-        buf += (config.s16_width << 1);
+        buf += WIDTH * SCALE;
         pTileData++;
     }
 }
 
-void hwtiles::render8x8_tile_mask_clip_hires(
+template <int SCALE, int WIDTH>
+void hwtiles::render8x8_tile_mask_clip_scaled(
     uint16_t *buf,
     uint16_t nTileNumber, 
     int16_t StartX, 
@@ -461,9 +448,12 @@ void hwtiles::render8x8_tile_mask_clip_hires(
     uint16_t nMaskColour, 
     uint16_t nPaletteOffset) 
 {
+    // Clip against the screen width, ignoring the scale
+    const int16_t W = WIDTH / SCALE;
+
     uint32_t nPalette = (nTilePalette << nColourDepth) | nMaskColour;
-    uint32_t* pTileData = tiles + (nTileNumber << 3);
-    buf += ((StartY << 1) * config.s16_width) + (StartX << 1);
+    const uint32_t* pTileData = tiles + (nTileNumber << 3);
+    buf += ((StartY * SCALE) * WIDTH) + (StartX * SCALE);
 
     for (int y = 0; y < 8; y++) 
     {
@@ -482,23 +472,26 @@ void hwtiles::render8x8_tile_mask_clip_hires(
                 uint32_t c1 = (p0 >> 24) & 0xf;
                 uint32_t c0 = (p0 >> 28);
 
-                if (c0 && 0 + StartX >= 0 && 0 + StartX < s16_width_noscale) set_pixel_x4(&buf[0],  nPalette + c0);
-                if (c1 && 1 + StartX >= 0 && 1 + StartX < s16_width_noscale) set_pixel_x4(&buf[2],  nPalette + c1);
-                if (c2 && 2 + StartX >= 0 && 2 + StartX < s16_width_noscale) set_pixel_x4(&buf[4],  nPalette + c2);
-                if (c3 && 3 + StartX >= 0 && 3 + StartX < s16_width_noscale) set_pixel_x4(&buf[6],  nPalette + c3);
-                if (c4 && 4 + StartX >= 0 && 4 + StartX < s16_width_noscale) set_pixel_x4(&buf[8],  nPalette + c4);
-                if (c5 && 5 + StartX >= 0 && 5 + StartX < s16_width_noscale) set_pixel_x4(&buf[10], nPalette + c5);
-                if (c6 && 6 + StartX >= 0 && 6 + StartX < s16_width_noscale) set_pixel_x4(&buf[12], nPalette + c6);
-                if (c7 && 7 + StartX >= 0 && 7 + StartX < s16_width_noscale) set_pixel_x4(&buf[14], nPalette + c7);
+                if (c0 && 0 + StartX >= 0 && 0 + StartX < W) set_pixel<SCALE, WIDTH>(&buf[0 * SCALE], nPalette + c0);
+                if (c1 && 1 + StartX >= 0 && 1 + StartX < W) set_pixel<SCALE, WIDTH>(&buf[1 * SCALE], nPalette + c1);
+                if (c2 && 2 + StartX >= 0 && 2 + StartX < W) set_pixel<SCALE, WIDTH>(&buf[2 * SCALE], nPalette + c2);
+                if (c3 && 3 + StartX >= 0 && 3 + StartX < W) set_pixel<SCALE, WIDTH>(&buf[3 * SCALE], nPalette + c3);
+                if (c4 && 4 + StartX >= 0 && 4 + StartX < W) set_pixel<SCALE, WIDTH>(&buf[4 * SCALE], nPalette + c4);
+                if (c5 && 5 + StartX >= 0 && 5 + StartX < W) set_pixel<SCALE, WIDTH>(&buf[5 * SCALE], nPalette + c5);
+                if (c6 && 6 + StartX >= 0 && 6 + StartX < W) set_pixel<SCALE, WIDTH>(&buf[6 * SCALE], nPalette + c6);
+                if (c7 && 7 + StartX >= 0 && 7 + StartX < W) set_pixel<SCALE, WIDTH>(&buf[7 * SCALE], nPalette + c7);
             }
         }
-        buf += (config.s16_width << 1);
+        buf += WIDTH * SCALE;
         pTileData++;
     }
 }
 
-// Hires Mode: Set 4 pixels instead of one.
-void hwtiles::set_pixel_x4(uint16_t *buf, uint32_t data)
+// Set a block of SCALE x SCALE pixels
+template <int SCALE, int WIDTH>
+void hwtiles::set_pixel(uint16_t *buf, uint32_t data)
 {
-    buf[0] = buf[1] = buf[0  + config.s16_width] = buf[1 + config.s16_width] = data;
+    for (int y = 0; y < SCALE; y++)
+        for (int x = 0; x < SCALE; x++)
+            buf[(y * WIDTH) + x] = data;
 }
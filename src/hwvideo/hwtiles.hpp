@@ -1,6 +1,8 @@
 #pragma once
 
+#include <vector>
 #include "stdint.hpp"
+#include "globals.hpp"
 
 class RomLoader;
 
@@ -20,7 +22,8 @@ public:
     hwtiles(void);
     ~hwtiles(void);
 
-    void init(uint8_t* src_tiles, const bool hires);
+    void init(uint8_t* src_tiles);
+    void set_mode(const bool hires, const bool widescreen);
     void patch_tiles(RomLoader* patch);
     void restore_tiles();
     void set_x_clamp(const uint16_t);
@@ -29,15 +32,27 @@ public:
     void render_text_layer(uint16_t*, uint8_t);
     void render_all_tiles(uint16_t*);
 
+    // Converted tiles (shared by all instances).
+    // Points to tiles_decoded, or to the graphics cache when it has been mapped.
+    // With TILE_JOURNAL defined, patches are written here directly.
+    static const int TILES_LENGTH = 0x10000;
+    static const uint32_t* tiles_base;
+
 private:
     int16_t x_clamp;
     
     // S16 Width, ignoring widescreen related scaling.
     uint16_t s16_width_noscale;
 
-    static const int TILES_LENGTH = 0x10000;
-    uint32_t tiles[TILES_LENGTH];        // Converted tiles
-    uint32_t tiles_backup[TILES_LENGTH]; // Converted tiles (backup without patch)
+    static uint32_t tiles_decoded[TILES_LENGTH]; // Tiles converted from the source rom
+    const uint32_t* tiles;                       // Tiles in use
+
+#ifdef TILE_JOURNAL
+    // Tiles overwritten by patches, in order. Each entry is the tile index followed by its 8 rows.
+    std::vector<uint32_t> journal;
+#else
+    uint32_t* tiles_patched;                     // Private copy, only allocated once patched
+#endif
 
     uint16_t page[4];
     uint16_t scroll_x[4];
@@ -48,6 +63,7 @@ private:
     static const uint16_t NUM_TILES = 0x2000; // Length of graphic rom / 24
     static const uint16_t TILEMAP_COLOUR_OFFSET = 0x1c00;
     
+    // Tile renderers for the current screen size. See set_mode().
     void (hwtiles::*render8x8_tile_mask)(
         uint16_t *buf,
         uint16_t nTileNumber, 
@@ -67,28 +83,13 @@ private:
         uint16_t nColourDepth, 
         uint16_t nMaskColour, 
         uint16_t nPaletteOffset); 
-        
-    void render8x8_tile_mask_lores(
-        uint16_t *buf,
-        uint16_t nTileNumber, 
-        uint16_t StartX, 
-        uint16_t StartY, 
-        uint16_t nTilePalette, 
-        uint16_t nColourDepth, 
-        uint16_t nMaskColour, 
-        uint16_t nPaletteOffset); 
 
-    void render8x8_tile_mask_clip_lores(
-        uint16_t *buf,
-        uint16_t nTileNumber, 
-        int16_t StartX, 
-        int16_t StartY, 
-        uint16_t nTilePalette, 
-        uint16_t nColourDepth, 
-        uint16_t nMaskColour, 
-        uint16_t nPaletteOffset);
-        
-    void render8x8_tile_mask_hires(
+    // Renderers for each screen size. Pixels are drawn SCALE x SCALE, to a buffer WIDTH pixels wide.
+    template <int SCALE, int WIDTH>
+    void set_kernels();
+
+    template <int SCALE, int WIDTH>
+    void render8x8_tile_mask_scaled(
         uint16_t *buf,
         uint16_t nTileNumber, 
         uint16_t StartX, 
@@ -97,8 +98,9 @@ private:
         uint16_t nColourDepth, 
         uint16_t nMaskColour, 
         uint16_t nPaletteOffset); 
-        
-    void render8x8_tile_mask_clip_hires(
+
+    template <int SCALE, int WIDTH>
+    void render8x8_tile_mask_clip_scaled(
         uint16_t *buf,
         uint16_t nTileNumber, 
         int16_t StartX, 
@@ -107,6 +109,7 @@ private:
         uint16_t nColourDepth, 
         uint16_t nMaskColour, 
         uint16_t nPaletteOffset);
-        
-    inline void set_pixel_x4(uint16_t *buf, uint32_t data);
+
+    template <int SCALE, int WIDTH>
+    inline void set_pixel(uint16_t *buf, uint32_t data);
 };
\ No newline at end of file
@@ -6,11 +6,15 @@
 ***************************************************************************/
 
 #include <stdlib.h>
+#include <time.h>
 #include <sys/stat.h>
 #include <sys/types.h>
 
 // Error reporting
 #include <iostream>
+#include <iomanip>
+#include <fstream>
+#include <string>
 
 // SDL Library
 #include <SDL.h>
@@ -25,6 +29,10 @@
 #endif
 
 #include "video.hpp"
+#include "framepacer.hpp"
+#include "replay.hpp"
+#include "audiorender.hpp"
+#include "hwvideo/gfxcache.hpp"
 
 #include "romloader.hpp"
 #include "trackloader.hpp"
@@ -34,6 +42,7 @@
 #include "engine/outrun.hpp"
 #include "frontend/config.hpp"
 #include "frontend/menu.hpp"
+#include "frontend/scorewriter.hpp"
 
 #include "cannonboard/interface.hpp"
 #include "engine/oinputs.hpp"
@@ -44,34 +53,44 @@
 // Fine to include on non-windows builds as dummy functions used.
 #include "directx/ffeedback.hpp"
 
-// Initialize Shared Variables
+// Shared Variables are initialized in globals.cpp
 using namespace cannonball;
 
-char FILENAME_CONFIG[256];
-char FILENAME_SCORES[256];
-char FILENAME_TTRIAL[256];
-char FILENAME_CONT[256];
+Menu* menu;
+Interface cannonboard;
+
+// Frame timing, and whether to print the frame interval histogram on exit
+static FramePacer pacer;
+static bool frame_stats;
 
-int    cannonball::state       = STATE_BOOT;
-double cannonball::frame_ms    = 0;
-int    cannonball::frame       = 0;
-bool   cannonball::tick_frame  = true;
-int    cannonball::fps_counter = 0;
+// Present frames on a separate thread, overriding the config (--present-thread)
+static bool present_thread;
 
-char configload[128], ttrialload[128], contload[128], scoresload[128];
+// Input recording and replay (--record-input, --replay-input)
+static InputReplay replay;
 
 #ifdef COMPILE_SOUND_CODE
-Audio cannonball::audio;
+// Headless rendering of the sound output to a WAV file (--audio-render)
+static AudioRender audio_render;
 #endif
 
-Menu* menu;
-Interface cannonboard;
-
 static void quit_func(int code)
 {
+    if (frame_stats)
+        pacer.print_stats(std::cout);
+
+    if (roms.verbose)
+    {
+        std::cout << "Sprite row cache: " << video.sprite_layer->row_cache_hits << " hits, "
+                  << video.sprite_layer->row_cache_misses << " misses" << std::endl;
+    }
+
 #ifdef COMPILE_SOUND_CODE
+    audio_render.close();
     audio.stop_audio();
 #endif
+    replay.close();
+    scorewriter.stop(); // Finish writing any scores
     input.close();
     forcefeedback::close();
     delete menu;
@@ -123,10 +142,62 @@ static void process_events(void)
 // Pause Engine
 bool pause_engine;
 
-static void tick()
+// Turbo Mode: Engine ticks per displayed frame (toggle with F4)
+static bool turbo;
+static int turbo_ticks = 4;
+const static int TURBO_MAX = 32;
+
+// Record the controls for this tick, or overwrite them from the replay
+static void replay_input()
+{
+    replay_frame_t f;
+
+    if (replay.is_replaying())
+    {
+        if (!replay.replay(f))
+        {
+            std::cout << "Replay finished: " << replay.frames << " frames" << std::endl;
+            replay.close();
+            return;
+        }
+
+        for (int i = 0; i < 16; i++)
+            input.keys[i] = (f.keys >> i) & 1;
+        input.a_wheel = f.wheel;
+        input.a_accel = f.accel;
+        input.a_brake = f.brake;
+    }
+    else if (replay.is_recording())
+    {
+        f.keys = 0;
+        for (int i = 0; i < 16; i++)
+            f.keys |= input.keys[i] << i;
+        f.wheel = input.a_wheel;
+        f.accel = input.a_accel;
+        f.brake = input.a_brake;
+        replay.record(f);
+    }
+}
+
+#ifdef COMPILE_SOUND_CODE
+// Output the sound chips. When rendering to a file, every tick is written.
+static void tick_audio(bool last_tick)
+{
+    if (audio_render.is_open())
+        audio_render.tick();
+    else if (last_tick)
+        audio.tick();
+}
+#endif
+
+// Tick the engine by one frame.
+// Audio is only output on the last tick of a displayed frame, so is decimated in turbo mode.
+static void tick_engine(bool last_tick)
 {
     frame++;
 
+    replay_input();
+
     // Get CannonBoard Packet Data
     Packet* packet = config.cannonboard.enabled ? cannonboard.get_packet() : NULL;
 
@@ -140,8 +211,6 @@ static void tick()
             tick_frame = (frame & 3) == 1;
     }
 
-    process_events();
-
     if (tick_frame)
         oinputs.tick(packet); // Do Controls
     oinputs.do_gear();        // Digital Gear
@@ -156,6 +225,9 @@ static void tick()
             if (input.has_pressed(Input::PAUSE))
                 pause_engine = !pause_engine;
 
+            if (input.has_pressed(Input::TURBO))
+                turbo = !turbo;
+
             if (input.has_pressed(Input::MENU))
                 state = STATE_INIT_MENU;
 
@@ -168,7 +240,7 @@ static void tick()
                 // Tick audio program code
                 osoundint.tick();
                 // Tick SDL Audio
-                audio.tick();
+                tick_audio(last_tick);
                 #endif
             }
             else
@@ -199,7 +271,7 @@ static void tick()
             // Tick audio program code
             osoundint.tick();
             // Tick SDL Audio
-            audio.tick();
+            tick_audio(true);
             #endif
         }
         break;
@@ -214,71 +286,162 @@ static void tick()
     // Write CannonBoard Outputs
     if (config.cannonboard.enabled)
         cannonboard.write(outrun.outputs->dig_out, outrun.outputs->hw_motor_control);
+}
+
+static void tick(bool draw)
+{
+    process_events();
+
+    // Turbo Mode: Only the final engine tick is drawn
+    int ticks = (turbo && state == STATE_GAME && !pause_engine) ? turbo_ticks : 1;
+
+    for (; ticks > 0; ticks--)
+    {
+        tick_engine(ticks == 1);
+
+        // Stop fast forwarding on entering the menu
+        if (state != STATE_GAME)
+            break;
+    }
 
     // Draw SDL Video
-    video.draw_frame();  
+    if (draw)
+        video.draw_frame();  
+}
+
+// Report time taken by a stage of startup (--verbose-startup)
+static void startup_time(const char* stage, Uint32& ticks)
+{
+    if (!roms.verbose)
+        return;
+
+    const Uint32 now = SDL_GetTicks();
+    std::cout << stage << ": " << (now - ticks) << "ms" << std::endl;
+    ticks = now;
+}
+
+// Report the larger allocations and the resident set size (--verbose-startup, or LOW_MEMORY builds)
+static void report_memory()
+{
+    const char* shared = gfxcache.is_mapped() ? " (mapped from cache)" : "";
+    const RomLoader* programs[] = { &roms.rom0, &roms.rom1, &roms.j_rom0, &roms.j_rom1 };
+
+    uint32_t program = 0, mirrors = 0;
+    for (int i = 0; i < 4; i++)
+    {
+        if (!programs[i]->loaded)
+            continue;
+        program += programs[i]->length;
+        if (programs[i]->rom16 != NULL)
+            mirrors += programs[i]->length * 2;
+    }
+
+    std::cout << "Memory (KB):" << std::endl;
+    std::cout << "  68000 ROMs      " << std::setw(6) << (program >> 10) << std::endl;
+    std::cout << "  ROM mirrors     " << std::setw(6) << (mirrors >> 10) << std::endl;
+    std::cout << "  Z80 ROM         " << std::setw(6) << (roms.z80.length >> 10) << std::endl;
+    std::cout << "  PCM ROM         " << std::setw(6) << (roms.pcm.length >> 10) << std::endl;
+    std::cout << "  Tiles           " << std::setw(6) << ((hwtiles::TILES_LENGTH * sizeof(uint32_t)) >> 10) << shared << std::endl;
+    std::cout << "  Sprites         " << std::setw(6) << ((hwsprites::SPRITES_LENGTH * sizeof(uint32_t)) >> 10) << shared << std::endl;
+    std::cout << "  Road            " << std::setw(6) << (HWRoad::ROADS_LENGTH >> 10) << shared << std::endl;
+    std::cout << "  Pixels          " << std::setw(6) << ((config.s16_width * config.s16_height * sizeof(uint16_t)) >> 10) << std::endl;
+
+    // Linux only
+    std::ifstream status("/proc/self/status");
+    std::string line;
+    while (std::getline(status, line))
+    {
+        if (line.compare(0, 6, "VmRSS:") == 0)
+            std::cout << "  Resident        " << std::setw(6) << atoi(line.c_str() + 6) << std::endl;
+    }
 }
 
 static void main_loop()
 {
     // FPS Counter (If Enabled)
-    //Timer fps_count;
-    int frame = 0;
-    //fps_count.start();
+    Timer fps_count;
+    int frames_drawn   = 0;
+    int frames_skipped = 0;
+    fps_count.start();
+
+    // Adaptive Frameskip
+    int skip_run      = 0;
+    bool draw         = true;
 
-    // General Frame Timing
-    Timer frame_time;
-    int t;
-    double deltatime  = 0;
-    int deltaintegral = 0;
+    pacer.start();
 
     while (state != STATE_QUIT)
     {
-        frame_time.start();
-        tick();
-        #ifdef COMPILE_SOUND_CODE
-        deltatime += (frame_ms * audio.adjust_speed());
-        #else
-        deltatime += frame_ms;
-        #endif
-        deltaintegral  = (int) deltatime;
-        t = frame_time.get_ticks();
+        tick(draw);
 
-        // Cap Frame Rate: Sleep Remaining Frame Time
-        #ifndef GCW
-        if (t < deltatime)
+        // Milliseconds until this frame is due. Negative when behind schedule.
+        // The audio is resampled to keep in sync, so the frame rate is fixed.
+        const double remaining = pacer.advance(frame_ms);
+
+        if (draw) frames_drawn++;
+        else      frames_skipped++;
+
+        if (config.video.frameskip)
+        {
+            // Don't attempt to catch up after a long stall
+            pacer.limit_lag(frame_ms * 8);
+
+            // Keep the logic running at full rate, but skip drawing frames until we catch up
+            if (remaining < 0 && skip_run < config.video.frameskip)
+            {
+                draw = false;
+                skip_run++;
+            }
+            else
+            {
+                draw     = true;
+                skip_run = 0;
+            }
+        }
+        else
         {
-            SDL_Delay((Uint32) (deltatime - t));
+            // Don't catch up at all. Late frames push the schedule back.
+            pacer.limit_lag(0);
         }
+
+        // Cap Frame Rate: Sleep until the frame is due
+        #ifndef GCW
+        pacer.wait();
         #endif
-        
-        deltatime -= deltaintegral;
 
-        /*if (config.video.fps_count)
+        if (frame_stats)
+            pacer.record();
+
+        if (config.video.fps_count)
         {
-            frame++;
             // One second has elapsed
             if (fps_count.get_ticks() >= 1000)
             {
-                fps_counter = frame;
-                frame       = 0;
+                fps_counter    = frames_drawn;
+                skip_counter   = (frames_skipped * 100) / (frames_drawn + frames_skipped);
+                frames_drawn   = 0;
+                frames_skipped = 0;
                 fps_count.start();
             }
-        }*/
+        }
     }
 
     quit_func(0);
 }
 
+#ifdef COMPILE_SOUND_CODE
+// Run a replay as fast as possible, writing the sound to a WAV file. Nothing is drawn.
+static void render_loop()
+{
+    while (state != STATE_QUIT && replay.is_replaying())
+        tick_engine(true);
+
+    quit_func(0);
+}
+#endif
+
 int main(int argc, char* argv[])
 {
-    // Initialize timer and video systems
-    if( SDL_Init( SDL_INIT_TIMER | SDL_INIT_VIDEO | SDL_INIT_JOYSTICK) == -1 ) 
-    { 
-        std::cerr << "SDL Initialization Failed: " << SDL_GetError() << std::endl;
-        return 1; 
-    }
-    
 	char homedir[128];
 	snprintf(homedir, sizeof(homedir), "%s/.cannonball", getenv("HOME"));
 	mkdir(homedir, 0755); // create $HOME/.cannonball if it doesn't exist
@@ -294,10 +457,95 @@ int main(int argc, char* argv[])
 
     bool loaded = false;
 
+    // Command Line Options
+    const char* layout_file = NULL;
+    const char* record_file = NULL;
+    const char* replay_file = NULL;
+    const char* render_file = NULL;
+
+    for (int i = 1; i < argc; i++)
+    {
+        // Load LayOut File
+        if (strcmp(argv[i], "-file") == 0 && i + 1 < argc)
+        {
+            layout_file = argv[++i];
+        }
+        // Start in turbo mode, running the engine a number of times per displayed frame
+        else if (strcmp(argv[i], "-turbo") == 0 && i + 1 < argc)
+        {
+            turbo_ticks = atoi(argv[++i]);
+            if (turbo_ticks < 2)
+                turbo_ticks = 2;
+            else if (turbo_ticks > TURBO_MAX)
+                turbo_ticks = TURBO_MAX;
+            turbo = true;
+        }
+        // Report how long each stage of startup takes
+        else if (strcmp(argv[i], "--verbose-startup") == 0)
+        {
+            roms.verbose = true;
+        }
+        // Print a histogram of frame intervals on exit
+        else if (strcmp(argv[i], "--frame-stats") == 0)
+        {
+            frame_stats = true;
+        }
+        // Present frames on a separate thread, so waiting for vsync doesn't stall the game
+        else if (strcmp(argv[i], "--present-thread") == 0)
+        {
+            present_thread = true;
+        }
+        // Record the controls to a file
+        else if (strcmp(argv[i], "--record-input") == 0 && i + 1 < argc)
+        {
+            record_file = argv[++i];
+        }
+        // Play back controls recorded with --record-input
+        else if (strcmp(argv[i], "--replay-input") == 0 && i + 1 < argc)
+        {
+            replay_file = argv[++i];
+        }
+#ifdef COMPILE_SOUND_CODE
+        // Run a replay without a window or audio device, as fast as possible, and write the sound to a WAV file
+        else if (strcmp(argv[i], "--audio-render") == 0 && i + 1 < argc)
+        {
+            render_file = argv[++i];
+        }
+        // Print the audio buffer fill and resampling ratio once a second
+        else if (strcmp(argv[i], "--audio-sync-log") == 0)
+        {
+            audio.log_sync = true;
+        }
+        // Print the latency of each sound effect, from being queued to leaving the audio buffer
+        else if (strcmp(argv[i], "--audio-latency") == 0)
+        {
+            audio.log_latency = true;
+        }
+#endif
+    }
+
+    // Nothing is drawn or read from the controls when rendering audio to a file
+    const bool headless = render_file != NULL;
+
+    if (headless && replay_file == NULL)
+    {
+        std::cerr << "--audio-render requires --replay-input" << std::endl;
+        return 1;
+    }
+
+    // Initialize timer and video systems
+    if( SDL_Init( headless ? SDL_INIT_TIMER : (SDL_INIT_TIMER | SDL_INIT_VIDEO | SDL_INIT_JOYSTICK)) == -1 ) 
+    { 
+        std::cerr << "SDL Initialization Failed: " << SDL_GetError() << std::endl;
+        return 1; 
+    }
+
+    Uint32 startup_ticks = SDL_GetTicks();
+
     // Load LayOut File
-    if (argc == 3 && strcmp(argv[1], "-file") == 0)
+    if (layout_file != NULL)
     {
-        if (trackloader.set_layout_track(argv[2]))
+        if (trackloader.set_layout_track(layout_file))
             loaded = roms.load_revb_roms(); 
     }
     // Load Roms Only
@@ -309,10 +557,15 @@ int main(int argc, char* argv[])
     //trackloader.set_layout_track("d:/temp.bin");
     //loaded = roms.load_revb_roms();
 
+    startup_time("ROMs", startup_ticks);
+
     if (loaded)
     {
         // Load XML Config
         config.load(FILENAME_CONFIG);
+        if (present_thread)
+            config.video.present_thread = 1;
+        startup_time("Config", startup_ticks);
 
         // Load fixed PCM ROM based on config
         if (config.sound.fix_samples)
@@ -321,6 +574,7 @@ int main(int argc, char* argv[])
         // Load patched widescreen tilemaps
         if (!omusic.load_widescreen_map())
             std::cout << "Unable to load widescreen tilemaps" << std::endl;
+        startup_time("Widescreen tilemaps", startup_ticks);
 
 #ifndef SDL2
         //Set the window caption 
@@ -328,31 +582,92 @@ int main(int argc, char* argv[])
 #endif
 
         // Initialize SDL Video
-        if (!video.init(&roms, &config.video))
+        if (headless)
+            video.init_headless(&roms, &config.video);
+        else if (!video.init(&roms, &config.video))
             quit_func(1);
+        startup_time("Video", startup_ticks);
 
 #ifdef COMPILE_SOUND_CODE
-        audio.init();
+        if (headless)
+        {
+            if (!audio_render.open(render_file))
+                quit_func(1);
+        }
+        else
+        {
+            audio.init();
+        }
+        startup_time("Audio", startup_ticks);
+#endif
+
+#ifdef LOW_MEMORY
+        report_memory();
+#else
+        if (roms.verbose)
+            report_memory();
 #endif
         state = config.menu.enabled ? STATE_INIT_MENU : STATE_INIT_GAME;
 
-        // Initalize controls
-        input.init(config.controls.pad_id,
-                   config.controls.keyconfig, config.controls.padconfig, 
-                   config.controls.analog,    config.controls.axis, config.controls.asettings);
+        if (headless)
+        {
+            // Controls only come from the replay
+            config.cannonboard.enabled = false;
+            config.controls.haptic     = 0;
+        }
+        else
+        {
+            // Initalize controls
+            input.init(config.controls.pad_id,
+                       config.controls.keyconfig, config.controls.padconfig, 
+                       config.controls.analog,    config.controls.axis, config.controls.asettings);
+
+            if (config.controls.haptic) 
+                config.controls.haptic = forcefeedback::init(config.controls.max_force, config.controls.min_force, config.controls.force_duration);
+            
+            // Initalize CannonBoard (For use in original cabinets)
+            if (config.cannonboard.enabled)
+            {
+                cannonboard.init(config.cannonboard.port, config.cannonboard.baud);
+                cannonboard.start();
+            }
+        }
+
+        // Record or replay the controls.
+        // The random seed is stored too, so the attract mode makes the same choices.
+        if (replay_file != NULL)
+        {
+            if (replay.start_replay(replay_file))
+            {
+                if (replay.fps != config.fps)
+                    std::cout << "Replay was recorded at " << (int) replay.fps << "fps, not " << config.fps << "fps" << std::endl;
 
-        if (config.controls.haptic) 
-            config.controls.haptic = forcefeedback::init(config.controls.max_force, config.controls.min_force, config.controls.force_duration);
-        
-        // Initalize CannonBoard (For use in original cabinets)
-        if (config.cannonboard.enabled)
+                input.analog  = replay.analog;
+                input.gamepad = replay.gamepad != 0;
+                srand(replay.seed);
+            }
+            else if (headless)
+            {
+                quit_func(1);
+            }
+        }
+        else if (record_file != NULL)
         {
-            cannonboard.init(config.cannonboard.port, config.cannonboard.baud);
-            cannonboard.start();
+            replay.fps     = config.fps;
+            replay.analog  = input.analog;
+            replay.gamepad = input.gamepad;
+            replay.seed    = (uint32_t) time(NULL);
+            srand(replay.seed);
+            replay.start_record(record_file);
         }
 
         // Populate menus
         menu->populate();
+
+#ifdef COMPILE_SOUND_CODE
+        if (headless)
+            render_loop();
+#endif
         main_loop();  // Loop until we quit the app
     }
     else
@@ -13,23 +13,24 @@
 namespace cannonball
 {
 #ifdef COMPILE_SOUND_CODE
-    extern Audio audio;
+    extern ENGINE_LOCAL Audio audio;
 #endif
 
     // Frame counter
-	extern int frame;
+	extern ENGINE_LOCAL int frame;
 
     // Tick Logic. Used when running at non-standard > 30 fps
-    extern bool tick_frame;
+    extern ENGINE_LOCAL bool tick_frame;
 
     // Millisecond Time Per Frame
-    extern double frame_ms;
+    extern ENGINE_LOCAL double frame_ms;
 
     // FPS Counter
-    extern int fps_counter;
+    extern ENGINE_LOCAL int fps_counter;
+    extern ENGINE_LOCAL int skip_counter;
 
     // Engine Master State
-    extern int state;
+    extern ENGINE_LOCAL int state;
     
     enum
     {
@@ -0,0 +1,403 @@
+/***************************************************************************
+    Software Post Processing.
+
+    Shared by the software renderers. Converts the System 16 pixel array to
+    32bpp, scales it by an integer factor and adds scanlines.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <cstring>
+#include <boost/bind.hpp>
+
+#include "globals.hpp"
+#include "postprocess.hpp"
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON) || defined(__ARM_NEON__)
+#include <arm_neon.h>
+#define POST_NEON 1
+#endif
+
+PostProcess::PostProcess()
+{
+    src_width  = 0;
+    src_height = 0;
+    scale      = 1;
+    scanlines  = 0;
+    threads    = 1;
+    pool       = NULL;
+    generation = 0;
+    pending    = 0;
+    quit       = false;
+}
+
+PostProcess::~PostProcess()
+{
+    stop_workers();
+}
+
+void PostProcess::init(const int src_width, const int src_height, const int scale, const int scanlines,
+                       const uint32_t rmask, const uint32_t gmask, const uint32_t bmask)
+{
+    stop_workers();
+
+    this->src_width  = src_width;
+    this->src_height = src_height;
+    this->scale      = scale < 1 ? 1 : scale;
+    this->scanlines  = this->scale > 1 ? scanlines : 0;
+
+    masks[0] = rmask;
+    masks[1] = gmask;
+    masks[2] = bmask;
+    rgb_mask = rmask | gmask | bmask;
+
+    byte_channels = true;
+    for (int c = 0; c < 3; c++)
+    {
+        shifts[c] = 0;
+        if (masks[c])
+            while (!((masks[c] >> shifts[c]) & 1))
+                shifts[c]++;
+
+        if ((shifts[c] & 7) || (masks[c] >> shifts[c]) != 0xFF)
+            byte_channels = false;
+    }
+
+    // Scanline brightness, as per the original blueMSX routine
+    weight_blend = ((100 - this->scanlines) << 8) / 200;
+    weight_last  = ((100 - this->scanlines) << 8) / 100;
+
+    int count = 1;
+    if (this->scale > 1)
+    {
+        count = boost::thread::hardware_concurrency();
+        if (count > MAX_THREADS)
+            count = MAX_THREADS;
+        if (count > src_height)
+            count = src_height;
+        if (count < 1)
+            count = 1;
+    }
+
+    lines.resize(count * 2 * src_width);
+    start_workers(count);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Threading
+// ------------------------------------------------------------------------------------------------
+
+void PostProcess::start_workers(const int count)
+{
+    threads = 1;
+    quit    = false;
+
+    if (count < 2)
+        return;
+
+    pool = new boost::thread_group();
+
+    // Band 0 is drawn by the calling thread
+    for (int t = 1; t < count; t++)
+    {
+        try
+        {
+            pool->create_thread(boost::bind(&PostProcess::worker, this, t, generation));
+        }
+        catch (boost::thread_resource_error&)
+        {
+            // Split the frame between the threads we have
+            break;
+        }
+        threads++;
+    }
+}
+
+void PostProcess::stop_workers()
+{
+    if (pool == NULL)
+        return;
+
+    {
+        boost::mutex::scoped_lock lock(mtx);
+        quit = true;
+    }
+    cond_start.notify_all();
+
+    pool->join_all();
+    delete pool;
+    pool    = NULL;
+    threads = 1;
+}
+
+void PostProcess::worker(const int band, uint32_t seen)
+{
+    for (;;)
+    {
+        {
+            boost::mutex::scoped_lock lock(mtx);
+            while (generation == seen && !quit)
+                cond_start.wait(lock);
+
+            if (quit)
+                return;
+
+            seen = generation;
+        }
+
+        draw_band(band);
+
+        boost::mutex::scoped_lock lock(mtx);
+        if (--pending == 0)
+            cond_done.notify_one();
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// Drawing
+// ------------------------------------------------------------------------------------------------
+
+void PostProcess::draw(const uint16_t* pixels, const uint32_t* palette, uint32_t* dst, const int dst_pitch)
+{
+    frame_pixels  = pixels;
+    frame_palette = palette;
+    frame_dst     = dst;
+    frame_pitch   = dst_pitch;
+
+    if (threads > 1)
+    {
+        {
+            boost::mutex::scoped_lock lock(mtx);
+            pending = threads - 1;
+            generation++;
+        }
+        cond_start.notify_all();
+    }
+
+    draw_band(0);
+
+    if (threads > 1)
+    {
+        boost::mutex::scoped_lock lock(mtx);
+        while (pending)
+            cond_done.wait(lock);
+    }
+}
+
+void PostProcess::draw_band(const int band)
+{
+    const int y_start = (src_height * band) / threads;
+    const int y_end   = (src_height * (band + 1)) / threads;
+
+    uint32_t* line0 = &lines[band * 2 * src_width];
+    uint32_t* line1 = line0 + src_width;
+
+    for (int y = y_start; y < y_end; y++)
+        draw_row(y, line0, line1);
+}
+
+void PostProcess::draw_row(const int y, uint32_t* line0, uint32_t* line1)
+{
+    const int dst_width = src_width * scale;
+    uint32_t* dst = frame_dst + (y * scale * frame_pitch);
+
+    // No Scaling
+    if (scale == 1)
+    {
+        lookup(frame_pixels + (y * src_width), frame_palette, dst, src_width);
+        return;
+    }
+
+    lookup(frame_pixels + (y * src_width), frame_palette, line0, src_width);
+    scale_row(line0, dst, src_width, scale);
+
+    // Make additional copies of this row. The last row is left for the scanline.
+    const int rows = scanlines ? scale - 1 : scale;
+    for (int i = 1; i < rows; i++)
+        memcpy(dst + (i * frame_pitch), dst, dst_width * sizeof(uint32_t));
+
+    if (!scanlines)
+        return;
+
+    uint32_t* scan = dst + ((scale - 1) * frame_pitch);
+
+    // Optimization for black scanlines
+    if (scanlines == 100)
+    {
+        memset(scan, 0, dst_width * sizeof(uint32_t));
+        return;
+    }
+
+    // Interpolate with the next row. The final row is just darkened.
+    if (y < src_height - 1)
+    {
+        lookup(frame_pixels + ((y + 1) * src_width), frame_palette, line1, src_width);
+        blend_row(line0, line1, line1, src_width, weight_blend);
+    }
+    else
+    {
+        blend_row(line0, NULL, line1, src_width, weight_last);
+    }
+
+    scale_row(line1, scan, src_width, scale);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Kernels
+// ------------------------------------------------------------------------------------------------
+
+// Lookup real RGB value from palette
+void PostProcess::lookup(const uint16_t* src, const uint32_t* palette, uint32_t* dst, const int width)
+{
+    for (int x = 0; x < width; x++)
+        dst[x] = palette[src[x] & ((S16_PALETTE_ENTRIES * 3) - 1)];
+}
+
+void PostProcess::scale_row(const uint32_t* src, uint32_t* dst, const int width, const int scale)
+{
+    int x = 0;
+
+    if (scale == 2)
+    {
+#if defined(__SSE2__)
+        for (; x + 4 <= width; x += 4, dst += 8)
+        {
+            const __m128i p = _mm_loadu_si128((const __m128i*) (src + x));
+            _mm_storeu_si128((__m128i*) dst,       _mm_unpacklo_epi32(p, p));
+            _mm_storeu_si128((__m128i*) (dst + 4), _mm_unpackhi_epi32(p, p));
+        }
+#elif defined(POST_NEON)
+        for (; x + 4 <= width; x += 4, dst += 8)
+        {
+            const uint32x4_t p = vld1q_u32(src + x);
+            const uint32x4x2_t d = vzipq_u32(p, p);
+            vst1q_u32(dst,     d.val[0]);
+            vst1q_u32(dst + 4, d.val[1]);
+        }
+#endif
+    }
+    else if (scale == 4)
+    {
+#if defined(__SSE2__)
+        for (; x + 4 <= width; x += 4, dst += 16)
+        {
+            const __m128i p = _mm_loadu_si128((const __m128i*) (src + x));
+            _mm_storeu_si128((__m128i*) dst,        _mm_shuffle_epi32(p, 0x00));
+            _mm_storeu_si128((__m128i*) (dst + 4),  _mm_shuffle_epi32(p, 0x55));
+            _mm_storeu_si128((__m128i*) (dst + 8),  _mm_shuffle_epi32(p, 0xAA));
+            _mm_storeu_si128((__m128i*) (dst + 12), _mm_shuffle_epi32(p, 0xFF));
+        }
+#elif defined(POST_NEON)
+        for (; x < width; x++, dst += 4)
+            vst1q_u32(dst, vdupq_n_u32(src[x]));
+#endif
+    }
+
+    for (; x < width; x++)
+    {
+        const uint32_t p = src[x];
+        for (int i = 0; i < scale; i++)
+            *dst++ = p;
+    }
+}
+
+/*****************************************************************************
+ ** Original Source: /cvsroot/bluemsx/blueMSX/Src/VideoRender/VideoRender.c,v 
+ **
+ ** Original Revision: 1.25 
+ **
+ ** Original Date: 2006/01/17 08:49:34 
+ **
+ ** More info: http://www.bluemsx.com
+ **
+ ** Copyright (C) 2003-2004 Daniel Vik
+ **
+ **  This software is provided 'as-is', without any express or implied
+ **  warranty.  In no event will the authors be held liable for any damages
+ **  arising from the use of this software.
+ **
+ **  Permission is granted to anyone to use this software for any purpose,
+ **  including commercial applications, and to alter it and redistribute it
+ **  freely, subject to the following restrictions:
+ **
+ **  1. The origin of this software must not be misrepresented; you must not
+ **     claim that you wrote the original software. If you use this software
+ **     in a product, an acknowledgment in the product documentation would be
+ **     appreciated but is not required.
+ **  2. Altered source versions must be plainly marked as such, and must not be
+ **     misrepresented as being the original software.
+ **  3. This notice may not be removed or altered from any source distribution.
+ **
+ ******************************************************************************
+  */
+
+// Modified version of the original scanline blend, for any 32bpp format.
+// Scanline: ((a + b) * weight) >> 8 per channel. Without b, (a * weight) >> 8.
+void PostProcess::blend_row(const uint32_t* a, const uint32_t* b, uint32_t* dst, const int width, const uint32_t weight)
+{
+    int x = 0;
+
+    if (byte_channels)
+    {
+#if defined(__SSE2__)
+        const __m128i zero = _mm_setzero_si128();
+        const __m128i w    = _mm_set1_epi16((short) weight);
+        const __m128i mask = _mm_set1_epi32((int) rgb_mask);
+
+        for (; x + 4 <= width; x += 4)
+        {
+            const __m128i pa = _mm_loadu_si128((const __m128i*) (a + x));
+            __m128i lo = _mm_unpacklo_epi8(pa, zero);
+            __m128i hi = _mm_unpackhi_epi8(pa, zero);
+
+            if (b)
+            {
+                const __m128i pb = _mm_loadu_si128((const __m128i*) (b + x));
+                lo = _mm_add_epi16(lo, _mm_unpacklo_epi8(pb, zero));
+                hi = _mm_add_epi16(hi, _mm_unpackhi_epi8(pb, zero));
+            }
+
+            lo = _mm_srli_epi16(_mm_mullo_epi16(lo, w), 8);
+            hi = _mm_srli_epi16(_mm_mullo_epi16(hi, w), 8);
+            _mm_storeu_si128((__m128i*) (dst + x), _mm_and_si128(_mm_packus_epi16(lo, hi), mask));
+        }
+#elif defined(POST_NEON)
+        const uint32x4_t mask = vdupq_n_u32(rgb_mask);
+
+        for (; x + 4 <= width; x += 4)
+        {
+            const uint8x16_t pa = vreinterpretq_u8_u32(vld1q_u32(a + x));
+            uint16x8_t lo = vmovl_u8(vget_low_u8(pa));
+            uint16x8_t hi = vmovl_u8(vget_high_u8(pa));
+
+            if (b)
+            {
+                const uint8x16_t pb = vreinterpretq_u8_u32(vld1q_u32(b + x));
+                lo = vaddw_u8(lo, vget_low_u8(pb));
+                hi = vaddw_u8(hi, vget_high_u8(pb));
+            }
+
+            const uint8x8_t rlo = vshrn_n_u16(vmulq_n_u16(lo, (uint16_t) weight), 8);
+            const uint8x8_t rhi = vshrn_n_u16(vmulq_n_u16(hi, (uint16_t) weight), 8);
+            vst1q_u32(dst + x, vandq_u32(vreinterpretq_u32_u8(vcombine_u8(rlo, rhi)), mask));
+        }
+#endif
+    }
+
+    for (; x < width; x++)
+    {
+        const uint32_t pa = a[x];
+        const uint32_t pb = b ? b[x] : 0;
+        uint32_t out = 0;
+
+        for (int c = 0; c < 3; c++)
+        {
+            const uint32_t ch = ((pa & masks[c]) >> shifts[c]) + ((pb & masks[c]) >> shifts[c]);
+            out |= (((ch * weight) >> 8) << shifts[c]) & masks[c];
+        }
+        dst[x] = out;
+    }
+}
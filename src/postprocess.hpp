@@ -0,0 +1,89 @@
+/***************************************************************************
+    Software Post Processing.
+
+    Shared by the software renderers. Converts the System 16 pixel array to
+    32bpp, scales it by an integer factor and adds scanlines.
+
+    - The last row of each scaled pixel is the scanline. It is darkened, and
+      blended with the row below, as per the original blueMSX routine.
+    - Rows are split into bands, and drawn by a pool of worker threads.
+    - SSE2 and NEON kernels are used when each colour channel is a whole byte.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "stdint.hpp"
+
+class PostProcess
+{
+public:
+    PostProcess();
+    ~PostProcess();
+
+    // scale:     Integer scale factor. 1 = No scaling.
+    // scanlines: Scanline density. 0 = Off, 100 = Black. Needs a scale of 2 or more.
+    // The masks describe the 32bpp output format.
+    void init(const int src_width, const int src_height, const int scale, const int scanlines,
+              const uint32_t rmask, const uint32_t gmask, const uint32_t bmask);
+
+    // Convert, scale and add scanlines to a frame.
+    // Output is (src_width * scale) x (src_height * scale). dst_pitch is in pixels.
+    void draw(const uint16_t* pixels, const uint32_t* palette, uint32_t* dst, const int dst_pitch);
+
+private:
+    // Worker threads are only used for scaled output
+    static const int MAX_THREADS = 4;
+
+    int src_width, src_height;
+    int scale;
+    int scanlines;
+
+    // Output format
+    uint32_t masks[3];
+    uint8_t shifts[3];
+    uint32_t rgb_mask;
+
+    // Every channel is a whole byte, so the vector kernels can be used
+    bool byte_channels;
+
+    // Scanline brightness (8.8 fixed point). Blended with the next line, and for the final line.
+    uint32_t weight_blend, weight_last;
+
+    // Frame being drawn
+    const uint16_t* frame_pixels;
+    const uint32_t* frame_palette;
+    uint32_t* frame_dst;
+    int frame_pitch;
+
+    // Two line buffers per band
+    std::vector<uint32_t> lines;
+
+    // Worker threads. Band 0 is drawn by the calling thread.
+    int threads;
+    boost::thread_group* pool;
+    boost::mutex mtx;
+    boost::condition_variable cond_start;
+    boost::condition_variable cond_done;
+    uint32_t generation;
+    int pending;
+    bool quit;
+
+    void start_workers(const int count);
+    void stop_workers();
+    void worker(const int band, uint32_t seen);
+    void draw_band(const int band);
+    void draw_row(const int y, uint32_t* line0, uint32_t* line1);
+
+    // Kernels
+    static void lookup(const uint16_t* src, const uint32_t* palette, uint32_t* dst, const int width);
+    static void scale_row(const uint32_t* src, uint32_t* dst, const int width, const int scale);
+    void blend_row(const uint32_t* a, const uint32_t* b, uint32_t* dst, const int width, const uint32_t weight);
+};
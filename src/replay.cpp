@@ -0,0 +1,120 @@
+/***************************************************************************
+    Input Recording & Replay.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <iostream>
+#include <cstring>
+
+#include "replay.hpp"
+
+static const char MAGIC[] = "CBREPLAY";
+
+InputReplay::InputReplay()
+{
+    fps       = 30;
+    analog    = 0;
+    gamepad   = 0;
+    seed      = 0;
+    frames    = 0;
+    recording = false;
+    replaying = false;
+}
+
+InputReplay::~InputReplay()
+{
+    close();
+}
+
+bool InputReplay::start_record(const char* filename)
+{
+    close();
+
+    file.open(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!file)
+    {
+        std::cout << "Unable to create replay: " << filename << std::endl;
+        return false;
+    }
+
+    uint8_t header[HEADER_SIZE];
+    memcpy(header, MAGIC, 8);
+    header[8]  = VERSION;
+    header[9]  = fps;
+    header[10] = analog;
+    header[11] = gamepad;
+    header[12] = seed & 0xFF;
+    header[13] = (seed >> 8) & 0xFF;
+    header[14] = (seed >> 16) & 0xFF;
+    header[15] = seed >> 24;
+    file.write((const char*) header, HEADER_SIZE);
+
+    frames    = 0;
+    recording = true;
+    return true;
+}
+
+bool InputReplay::start_replay(const char* filename)
+{
+    close();
+
+    file.open(filename, std::ios::in | std::ios::binary);
+
+    uint8_t header[HEADER_SIZE];
+    if (!file || !file.read((char*) header, HEADER_SIZE) || memcmp(header, MAGIC, 8) || header[8] != VERSION)
+    {
+        std::cout << "Unable to load replay: " << filename << std::endl;
+        file.close();
+        return false;
+    }
+
+    fps     = header[9];
+    analog  = header[10];
+    gamepad = header[11];
+    seed    = header[12] | (header[13] << 8) | (header[14] << 16) | ((uint32_t) header[15] << 24);
+
+    frames    = 0;
+    replaying = true;
+    return true;
+}
+
+void InputReplay::close()
+{
+    if (file.is_open())
+        file.close();
+    file.clear();
+
+    recording = false;
+    replaying = false;
+}
+
+void InputReplay::record(const replay_frame_t& frame)
+{
+    const uint16_t values[] = { frame.keys, (uint16_t) frame.wheel, (uint16_t) frame.accel, (uint16_t) frame.brake };
+
+    uint8_t data[FRAME_SIZE];
+    for (int i = 0; i < 4; i++)
+    {
+        data[i * 2]     = values[i] & 0xFF;
+        data[i * 2 + 1] = values[i] >> 8;
+    }
+
+    file.write((const char*) data, FRAME_SIZE);
+    frames++;
+}
+
+bool InputReplay::replay(replay_frame_t& frame)
+{
+    uint8_t data[FRAME_SIZE];
+    if (!file.read((char*) data, FRAME_SIZE))
+        return false;
+
+    frame.keys  = data[0] | (data[1] << 8);
+    frame.wheel = (int16_t) (data[2] | (data[3] << 8));
+    frame.accel = (int16_t) (data[4] | (data[5] << 8));
+    frame.brake = (int16_t) (data[6] | (data[7] << 8));
+    frames++;
+    return true;
+}
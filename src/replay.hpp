@@ -0,0 +1,70 @@
+/***************************************************************************
+    Input Recording & Replay.
+
+    Records the controls read on each engine tick, so that a session can be
+    played back exactly. The random seed is stored with the recording, so
+    the attract mode makes the same choices on playback.
+
+    File format (little endian):
+    - Header: "CBREPLAY", version, fps, analog mode, gamepad present
+              (1 byte each) and the random seed (4 bytes).
+    - One record per engine tick: key bits (2 bytes), then wheel,
+      accelerator and brake (2 bytes each).
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <fstream>
+#include "stdint.hpp"
+
+struct replay_frame_t
+{
+    uint16_t keys;      // One bit per Input::presses
+    int16_t wheel;
+    int16_t accel;
+    int16_t brake;
+};
+
+class InputReplay
+{
+public:
+    // Settings stored in the header
+    uint8_t fps;
+    uint8_t analog;
+    uint8_t gamepad;
+    uint32_t seed;
+
+    // Engine ticks recorded or replayed so far
+    uint32_t frames;
+
+    InputReplay();
+    ~InputReplay();
+
+    // Start recording. The header is written from the settings above.
+    bool start_record(const char* filename);
+
+    // Start a replay. The settings above are read from the header.
+    bool start_replay(const char* filename);
+
+    void close();
+
+    bool is_recording() const { return recording; }
+    bool is_replaying() const { return replaying; }
+
+    void record(const replay_frame_t& frame);
+
+    // Returns false at the end of the recording
+    bool replay(replay_frame_t& frame);
+
+private:
+    static const uint8_t VERSION = 1;
+    static const int HEADER_SIZE = 16;
+    static const int FRAME_SIZE  = 8;
+
+    std::fstream file;
+    bool recording;
+    bool replaying;
+};
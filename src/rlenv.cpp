@@ -0,0 +1,314 @@
+/***************************************************************************
+    Reinforcement Learning Environment.
+
+    Batches several headless engines (see enginecontext.hpp) behind a single
+    reset / step interface.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include "rlenv.hpp"
+
+#ifdef ENGINE_CONTEXTS
+
+#include <boost/bind.hpp>
+
+#include "main.hpp"
+#include "enginecontext.hpp"
+#include "cannonboard/interface.hpp"
+#include "engine/outrun.hpp"
+#include "engine/oinputs.hpp"
+#include "engine/ocrash.hpp"
+#include "engine/oinitengine.hpp"
+#include "engine/omusic.hpp"
+#include "engine/oroad.hpp"
+#include "engine/osprites.hpp"
+#include "engine/ostats.hpp"
+#include "engine/outils.hpp"
+
+// Level offsets for each stage, in the same order as the course map (left to right)
+static const uint8_t STAGE_LEVELS[] =
+{
+    0x00,
+    0x08, 0x09,
+    0x10, 0x11, 0x12,
+    0x18, 0x19, 0x1A, 0x1B,
+    0x20, 0x21, 0x22, 0x23, 0x24
+};
+
+// Raw analogue ranges, as read from the cabinet (see OInputs)
+static const int STEER_CENTRE = 0x80;
+static const int STEER_RANGE  = 0x38;
+static const int PEDAL_MIN    = 0x30;
+static const int PEDAL_RANGE  = 0x60;
+
+// Reward penalty applied when the car starts to crash
+static const float CRASH_PENALTY = 50.0f;
+
+bool RLEnv::init(const char* config_file)
+{
+    if (!roms.load_revb_roms())
+        return false;
+
+    config.load(config_file ? config_file : "");
+
+    if (config.sound.fix_samples)
+        roms.load_pcm_rom(true);
+
+    // Observations assume the original screen size
+    config.video.widescreen = 0;
+    config.video.hires      = 0;
+
+    // Gear is controlled by the agent
+    config.controls.gear    = config.controls.GEAR_BUTTON;
+
+    return video.init_headless(&roms, &config.video) != 0;
+}
+
+RLEnv::RLEnv(int count, int frame_skip, int max_steps)
+{
+    this->count      = count;
+    this->frame_skip = frame_skip < 1 ? 1 : frame_skip;
+    this->max_steps  = max_steps;
+
+    envs.resize(count);
+
+    for (int i = 0; i < count; i++)
+    {
+        env_t* env    = &envs[i];
+        env->context  = new EngineContext();
+        env->progress = 0;
+        env->steps    = 0;
+        env->crashed  = false;
+        env->context->start();
+    }
+}
+
+RLEnv::~RLEnv()
+{
+    for (int i = 0; i < count; i++)
+        delete envs[i].context;
+}
+
+void RLEnv::reset(const int* stages, const uint32_t* seeds)
+{
+    for (int i = 0; i < count; i++)
+        envs[i].context->post(boost::bind(&RLEnv::reset_env, this, i, stages ? stages[i] : 0, seeds ? seeds[i] : 0));
+
+    for (int i = 0; i < count; i++)
+        envs[i].context->wait();
+}
+
+void RLEnv::step(const float* actions, float* features, uint8_t* frames, float* rewards, uint8_t* dones)
+{
+    for (int i = 0; i < count; i++)
+        envs[i].context->post(boost::bind(&RLEnv::step_env, this, i, actions, features, frames, rewards, dones));
+
+    for (int i = 0; i < count; i++)
+        envs[i].context->wait();
+}
+
+// ------------------------------------------------------------------------------------------------
+// Engine Thread Jobs
+// ------------------------------------------------------------------------------------------------
+
+void RLEnv::reset_env(const int index, const int stage, const uint32_t seed)
+{
+    env_t* env = &envs[index];
+
+    if (stage > 0 && stage < STAGES_TOTAL)
+    {
+        // Setup as per TTrial::tick()
+        outrun.cannonball_mode         = Outrun::MODE_TTRIAL;
+        outrun.ttrial.level            = STAGE_LEVELS[stage];
+        outrun.ttrial.laps             = 1;
+        outrun.ttrial.current_lap      = 0;
+        outrun.ttrial.best_lap_counter = 10000;
+        outrun.ttrial.new_high_score   = false;
+        outrun.ttrial.overtakes        = 0;
+        outrun.ttrial.crashes          = 0;
+        outrun.ttrial.vehicle_cols     = 0;
+        outrun.custom_traffic          = config.ttrial.traffic;
+    }
+    else
+    {
+        outrun.cannonball_mode = Outrun::MODE_ORIGINAL;
+    }
+
+    env->context->reset();
+
+    // Skip attract mode and music selection
+    ostats.credits        = 1;
+    omusic.music_selected = sound::MUSIC_BREEZE;
+    outrun.game_state     = GS_INIT_GAME;
+
+    // Must follow reset(), which restores the default seed
+    outils::set_random_seed(seed);
+
+    env->progress = get_progress();
+    env->steps    = 0;
+    env->crashed  = false;
+}
+
+void RLEnv::step_env(const int index, const float* actions, float* features, uint8_t* frames, float* rewards, uint8_t* dones)
+{
+    env_t* env = &envs[index];
+
+    float steer = actions[ACTION_STEER * count + index];
+    float accel = actions[ACTION_ACCEL * count + index];
+    float brake = actions[ACTION_BRAKE * count + index];
+    float gear  = actions[ACTION_GEAR  * count + index];
+
+    if (steer < -1.0f) steer = -1.0f; else if (steer > 1.0f) steer = 1.0f;
+    if (accel <  0.0f) accel =  0.0f; else if (accel > 1.0f) accel = 1.0f;
+    if (brake <  0.0f) brake =  0.0f; else if (brake > 1.0f) brake = 1.0f;
+
+    Packet packet = Packet();
+    packet.ai2 = STEER_CENTRE + (int) (steer * STEER_RANGE);
+    packet.ai0 = PEDAL_MIN + (int) (accel * PEDAL_RANGE);
+    packet.ai3 = PEDAL_MIN + (int) (brake * PEDAL_RANGE);
+    packet.di1 = gear >= 0.5f ? 0 : 0x10;
+
+    float reward = 0;
+
+    for (int i = 0; i < frame_skip; i++)
+    {
+        env->context->tick_frame(&packet);
+
+        const bool crashed = ocrash.crash_counter != 0;
+        if (crashed && !env->crashed)
+            reward -= CRASH_PENALTY;
+        env->crashed = crashed;
+    }
+
+    const int32_t progress = get_progress();
+    reward += (float) (progress - env->progress);
+    env->progress = progress;
+
+    env->steps++;
+
+    rewards[index] = reward;
+    dones[index]   = (outrun.game_state < GS_INIT_GAME || outrun.game_state > GS_INGAME) ||
+                     (max_steps && env->steps >= (uint32_t) max_steps);
+
+    if (features)
+        get_features(index, features);
+
+    if (frames)
+    {
+        video.render_layers();
+        get_frame(frames + (index * FRAME_SIZE));
+    }
+}
+
+// Distance travelled, in road position units, since the start of the race
+int32_t RLEnv::get_progress()
+{
+    int32_t stages = ostats.cur_stage + outrun.ttrial.current_lap;
+    return (stages * ROAD_END) + (oroad.road_pos >> 16);
+}
+
+void RLEnv::get_features(const int index, float* features)
+{
+    // Find closest traffic
+    int16_t traffic_z = 0;
+    int16_t traffic_x = 0;
+
+    for (int i = OSprites::SPRITE_TRAFF1; i <= OSprites::SPRITE_TRAFF8; i++)
+    {
+        oentry* sprite = &osprites.jump_table[i];
+        if ((sprite->control & OSprites::ENABLE) && (sprite->z >> 16) > traffic_z)
+        {
+            traffic_z = sprite->z >> 16;
+            traffic_x = sprite->x;
+        }
+    }
+
+    features[FEATURE_CAR_X      * count + index] = oinitengine.car_x_pos;
+    features[FEATURE_CAR_SPEED  * count + index] = oinitengine.car_increment >> 16;
+    features[FEATURE_ROAD_WIDTH * count + index] = oroad.road_width >> 16;
+    features[FEATURE_ROAD_POS   * count + index] = oroad.road_pos >> 16;
+    features[FEATURE_TIME       * count + index] = ostats.time_counter;
+    features[FEATURE_STAGE      * count + index] = ostats.cur_stage;
+    features[FEATURE_TRAFFIC_Z  * count + index] = traffic_z;
+    features[FEATURE_TRAFFIC_X  * count + index] = traffic_x;
+    features[FEATURE_CRASH      * count + index] = ocrash.crash_counter != 0;
+    features[FEATURE_GEAR       * count + index] = oinputs.gear;
+}
+
+// Point sample the rendered frame and convert palette entries to luminance
+void RLEnv::get_frame(uint8_t* frame)
+{
+    const uint16_t* pixels = video.pixels;
+
+    for (int y = 0; y < FRAME_H; y++)
+    {
+        const uint16_t* src = pixels + (((y * FRAME_SCALE) + (FRAME_SCALE >> 1)) * config.s16_width) + (FRAME_SCALE >> 1);
+
+        for (int x = 0; x < FRAME_W; x++)
+        {
+            const uint16_t pix = *src;
+            src += FRAME_SCALE;
+
+            // System 16 palette: xBGR_4444, plus 1 extra low bit per channel
+            const uint16_t a = video.read_pal16((uint32_t) (pix & 0xFFF) << 1);
+            uint32_t r = ((a & 0x000f) << 1) | ((a >> 12) & 1);
+            uint32_t g = ((a & 0x00f0) >> 3) | ((a >> 13) & 1);
+            uint32_t b = ((a & 0x0f00) >> 7) | ((a >> 14) & 1);
+            uint32_t lum = ((r * 77) + (g * 150) + (b * 29)) >> 5; // 5-bit to 8-bit
+
+            // Shadow
+            if (pix & 0x3000)
+                lum = (lum * 202) >> 8;
+
+            *frame++ = lum > 0xFF ? 0xFF : lum;
+        }
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// C Interface
+// ------------------------------------------------------------------------------------------------
+
+int cannonball_env_init(const char* config_file)
+{
+    return RLEnv::init(config_file) ? 1 : 0;
+}
+
+void* cannonball_env_create(int count, int frame_skip, int max_steps)
+{
+    return new RLEnv(count, frame_skip, max_steps);
+}
+
+void cannonball_env_destroy(void* env)
+{
+    delete (RLEnv*) env;
+}
+
+void cannonball_env_reset(void* env, const int* stages, const uint32_t* seeds)
+{
+    ((RLEnv*) env)->reset(stages, seeds);
+}
+
+void cannonball_env_step(void* env, const float* actions, float* features, uint8_t* frames, float* rewards, uint8_t* dones)
+{
+    ((RLEnv*) env)->step(actions, features, frames, rewards, dones);
+}
+
+int cannonball_env_features()
+{
+    return RLEnv::FEATURES;
+}
+
+int cannonball_env_frame_width()
+{
+    return RLEnv::FRAME_W;
+}
+
+int cannonball_env_frame_height()
+{
+    return RLEnv::FRAME_H;
+}
+
+#endif
@@ -0,0 +1,121 @@
+/***************************************************************************
+    Reinforcement Learning Environment.
+
+    Batches several headless engines (see enginecontext.hpp) behind a single
+    reset / step interface. Each environment runs on its own thread.
+    Observations for the whole batch are returned in contiguous
+    structure-of-arrays buffers.
+
+    Actions are injected through the same analogue Packet path that is used
+    by the CannonBoard, so the game sees them exactly like real controls.
+
+    Build with: make librlenv.so
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include "globals.hpp"
+
+#ifdef ENGINE_CONTEXTS
+
+#include <vector>
+
+class EngineContext;
+
+class RLEnv
+{
+public:
+    // Actions. Buffer layout: actions[ACTION * count + env]
+    enum
+    {
+        ACTION_STEER,   // -1.0 (left) to 1.0 (right)
+        ACTION_ACCEL,   //  0.0 to 1.0
+        ACTION_BRAKE,   //  0.0 to 1.0
+        ACTION_GEAR,    //  0.0 (low) or 1.0 (high)
+        ACTIONS
+    };
+
+    // RAM Features. Buffer layout: features[FEATURE * count + env]
+    enum
+    {
+        FEATURE_CAR_X,          // oinitengine.car_x_pos
+        FEATURE_CAR_SPEED,      // oinitengine.car_increment >> 16
+        FEATURE_ROAD_WIDTH,     // oroad.road_width >> 16
+        FEATURE_ROAD_POS,       // oroad.road_pos >> 16
+        FEATURE_TIME,           // ostats.time_counter
+        FEATURE_STAGE,          // ostats.cur_stage
+        FEATURE_TRAFFIC_Z,      // Distance to closest traffic (0 = none, 0x100 = at the car)
+        FEATURE_TRAFFIC_X,      // X position of closest traffic, relative to car
+        FEATURE_CRASH,          // 1 when crashing
+        FEATURE_GEAR,           // 1 when in high gear
+        FEATURES
+    };
+
+    // Downsampled greyscale frame. Buffer layout: frames[env * FRAME_SIZE + y * FRAME_W + x]
+    const static int FRAME_SCALE = 4;
+    const static int FRAME_W     = S16_WIDTH  / FRAME_SCALE;
+    const static int FRAME_H     = S16_HEIGHT / FRAME_SCALE;
+    const static int FRAME_SIZE  = FRAME_W * FRAME_H;
+
+    // Total number of stages that can be passed to reset()
+    const static int STAGES_TOTAL = STAGES;
+
+    // Load ROMs, config and decode graphics. Call once per process, before creating environments.
+    static bool init(const char* config_file);
+
+    RLEnv(int count, int frame_skip = 4, int max_steps = 0);
+    ~RLEnv();
+
+    int get_count() { return count; }
+
+    // Restart each environment at a stage (0 - 14), with a random seed.
+    // Stages after the first use the Time Trial mode.
+    void reset(const int* stages, const uint32_t* seeds);
+
+    // Advance each environment by frame_skip frames.
+    // features and frames are optional and can be NULL.
+    void step(const float* actions, float* features, uint8_t* frames, float* rewards, uint8_t* dones);
+
+private:
+    struct env_t
+    {
+        EngineContext* context;
+        int32_t progress;
+        uint32_t steps;
+        bool crashed;
+    };
+
+    int count;
+    int frame_skip;
+    int max_steps;
+    std::vector<env_t> envs;
+
+    // Per environment jobs. These run on the environment's engine thread.
+    void reset_env(const int index, const int stage, const uint32_t seed);
+    void step_env(const int index, const float* actions, float* features, uint8_t* frames, float* rewards, uint8_t* dones);
+
+    int32_t get_progress();
+    void get_features(const int index, float* features);
+    void get_frame(uint8_t* frame);
+};
+
+// ------------------------------------------------------------------------------------------------
+// C Interface
+// ------------------------------------------------------------------------------------------------
+
+extern "C"
+{
+    int   cannonball_env_init(const char* config_file);
+    void* cannonball_env_create(int count, int frame_skip, int max_steps);
+    void  cannonball_env_destroy(void* env);
+    void  cannonball_env_reset(void* env, const int* stages, const uint32_t* seeds);
+    void  cannonball_env_step(void* env, const float* actions, float* features, uint8_t* frames, float* rewards, uint8_t* dones);
+    int   cannonball_env_features();
+    int   cannonball_env_frame_width();
+    int   cannonball_env_frame_height();
+}
+
+#endif
@@ -10,19 +10,54 @@
 
 #include <iostream>
 #include <fstream>
+#include <sstream>
+#include <algorithm>
 #include <cstddef>       // for std::size_t
-#include <boost/crc.hpp> // CRC Checking via Boost library.
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/lock_guard.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
 
 #include "stdint.hpp"
 #include "romloader.hpp"
+#include "utils.hpp"
+#include "zipfile.hpp"
 
 #ifdef __APPLE__
 #include "CoreFoundation/CoreFoundation.h"
 #endif
 
+// ROMs may be loaded on several threads at once. Keep their messages intact.
+static boost::mutex print_mutex;
+
+static void print_error(const std::string& msg)
+{
+    boost::lock_guard<boost::mutex> lock(print_mutex);
+    std::cout << msg << std::endl;
+}
+
+static void check_crc(const char* filename, const uint32_t expected_crc, const uint32_t crc)
+{
+    if (expected_crc != crc)
+    {
+        std::stringstream ss;
+        ss << std::hex << filename << " has incorrect checksum.\nExpected: " << expected_crc << " Found: " << crc;
+        print_error(ss.str());
+    }
+}
+
 RomLoader::RomLoader()
 {
     loaded = false;
+    crc    = 0;
+    rom16  = NULL;
+    rom32  = NULL;
 }
 
 RomLoader::~RomLoader()
@@ -32,15 +67,43 @@ RomLoader::~RomLoader()
 void RomLoader::init(const uint32_t length)
 {
     this->length = length;
+    this->crc    = 0;
     rom = new uint8_t[length];
 }
 
 void RomLoader::unload(void)
 {
     delete[] rom;
+    delete[] rom16;
+    delete[] rom32;
+    rom16 = NULL;
+    rom32 = NULL;
+}
+
+// Create native endian copies of a 68000 program ROM, for word and long aligned reads.
+// Must be called again if the ROM data changes.
+//
+// Low memory builds skip this, and read from the byte array instead.
+void RomLoader::create_mirrors()
+{
+#ifdef LOW_MEMORY
+    return;
+#endif
+
+    if (rom16 == NULL)
+    {
+        rom16 = new uint16_t[length >> 1];
+        rom32 = new uint32_t[length >> 2];
+    }
+
+    for (uint32_t i = 0; i < (length >> 1); i++)
+        rom16[i] = (rom[i << 1] << 8) | rom[(i << 1) + 1];
+
+    for (uint32_t i = 0; i < (length >> 2); i++)
+        rom32[i] = (rom16[i << 1] << 16) | rom16[(i << 1) + 1];
 }
 
-int RomLoader::load(const char* filename, const int offset, const int length, const int expected_crc, const uint8_t interleave)
+int RomLoader::load(const char* filename, const int offset, const int length, const int expected_crc, const uint8_t interleave, RomTiming* timing, uint32_t* found_crc)
 {
 	char path[256];
 #ifdef __APPLE__    
@@ -59,39 +122,135 @@ int RomLoader::load(const char* filename, const int offset, const int length, co
 
 	snprintf(path, sizeof(path), "%s/.cannonball/roms/%s", getenv("HOME"), filename);
 
-    // Open rom file
-    std::ifstream src(path, std::ios::in | std::ios::binary);
-    if (!src)
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+    const uint8_t* data = NULL;
+    size_t size         = 0;
+    char* buffer        = NULL;
+
+#ifndef _WIN32
+    // Map rom file
+    int fd = open(path, O_RDONLY);
+    if (fd < 0)
     {
-        std::cout << "cannot open rom: " << filename << std::endl;
-        loaded = false;
+        print_error(std::string("cannot open rom: ") + filename);
         return 1; // fail
     }
 
-    // Read file
-    char* buffer = new char[length];
-    src.read(buffer, length);
-
-    // Check CRC on file
-    boost::crc_32_type result;
-    result.process_bytes(buffer, (size_t) src.gcount());
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        size = std::min((size_t) st.st_size, (size_t) length);
+        void* map = mmap(NULL, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
+            data = (const uint8_t*) map;
+    }
+    close(fd);
+#endif
 
-    if (expected_crc != result.checksum())
+    // Fallback: Read rom file
+    if (data == NULL)
     {
-        std::cout << std::hex << 
-            filename << " has incorrect checksum.\nExpected: " << expected_crc << " Found: " << result.checksum() << std::endl;
+        std::ifstream src(path, std::ios::in | std::ios::binary);
+        if (!src)
+        {
+            print_error(std::string("cannot open rom: ") + filename);
+            return 1; // fail
+        }
+
+        buffer = new char[length];
+        src.read(buffer, length);
+        size = (size_t) src.gcount();
+        data = (const uint8_t*) buffer;
+        src.close();
     }
 
+    boost::posix_time::ptime mapped = boost::posix_time::microsec_clock::universal_time();
+
+    // Check CRC on file
+    const uint32_t crc = Utils::crc32(data, size);
+    check_crc(filename, expected_crc, crc);
+
+    if (found_crc != NULL)
+        *found_crc = crc;
+
+    boost::posix_time::ptime checked = boost::posix_time::microsec_clock::universal_time();
+
     // Interleave file as necessary
-    for (int i = 0; i < length; i++)
+    for (size_t i = 0; i < size; i++)
     {
-        rom[(i * interleave) + offset] = buffer[i];
+        rom[(i * interleave) + offset] = data[i];
     }
 
     // Clean Up
-    delete[] buffer;
-    src.close();
-    loaded = true;
+    if (buffer != NULL)
+        delete[] buffer;
+#ifndef _WIN32
+    else
+        munmap((void*) data, size);
+#endif
+
+    if (timing != NULL)
+    {
+        boost::posix_time::ptime done = boost::posix_time::microsec_clock::universal_time();
+        timing->read       = (uint32_t) (mapped - start).total_microseconds();
+        timing->crc        = (uint32_t) (checked - mapped).total_microseconds();
+        timing->interleave = (uint32_t) (done - checked).total_microseconds();
+    }
+
+    return 0; // success
+}
+
+// Load rom file from a zip archive.
+// The file is decompressed straight into the rom, so there is no separate interleave step.
+// Returns 1 if the file is not in the archive.
+int RomLoader::load_zip(const ZipFile* zip, const char* filename, const int offset, const int length, const int expected_crc, const uint8_t interleave, RomTiming* timing, uint32_t* found_crc)
+{
+    const ZipFile::entry_t* entry = zip->find(filename, expected_crc);
+    if (entry == NULL)
+        return 1;
+
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+    const int size = zip->extract(entry, rom + offset, interleave, length);
+    if (size < 0)
+    {
+        print_error(std::string("corrupt rom in archive: ") + filename);
+        return 1; // fail
+    }
+
+    boost::posix_time::ptime inflated = boost::posix_time::microsec_clock::universal_time();
+
+    // Check CRC on the interleaved data
+    uint32_t crc = 0;
+
+    if (interleave == NORMAL)
+    {
+        crc = Utils::crc32(rom + offset, size);
+    }
+    else
+    {
+        uint8_t chunk[0x400];
+        for (int i = 0; i < size; i += sizeof(chunk))
+        {
+            const int count = std::min(size - i, (int) sizeof(chunk));
+            for (int j = 0; j < count; j++)
+                chunk[j] = rom[((i + j) * interleave) + offset];
+            crc = Utils::crc32(chunk, count, crc);
+        }
+    }
+    check_crc(filename, expected_crc, crc);
+
+    if (found_crc != NULL)
+        *found_crc = crc;
+
+    if (timing != NULL)
+    {
+        timing->read       = (uint32_t) (inflated - start).total_microseconds();
+        timing->crc        = (uint32_t) (boost::posix_time::microsec_clock::universal_time() - inflated).total_microseconds();
+        timing->interleave = 0;
+    }
+
     return 0; // success
 }
 
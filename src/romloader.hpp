@@ -10,6 +10,25 @@
 
 #pragma once
 
+#include <cassert>
+#include <cstring>
+#include "globals.hpp"
+
+class ZipFile;
+
+// Z80 data is little endian, so can be read directly on little endian hosts
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+#define ROM_NATIVE_LE 1
+#endif
+
+// Time spent loading a file, in microseconds
+struct RomTiming
+{
+    uint32_t read;       // Open and map (or read) the file. Or decompress, for archives.
+    uint32_t crc;        // Checksum
+    uint32_t interleave; // Copy into the ROM array
+};
+
 class RomLoader
 {
 
@@ -24,10 +43,19 @@ public:
     // Successfully loaded
     bool loaded;
 
+    // Checksum of the CRCs of each file loaded, in order. Identifies the rom contents.
+    uint32_t crc;
+
+    // Native endian mirrors of 68000 program ROMs. NULL unless created.
+    uint16_t* rom16; // Word at address: rom16[addr >> 1]
+    uint32_t* rom32; // Long at address: rom32[addr >> 2]
+
     RomLoader();
     ~RomLoader();
     void init(uint32_t);
-    int load(const char* filename, const int offset, const int length, const int expected_crc, const uint8_t mode = NORMAL);
+    void create_mirrors();
+    int load(const char* filename, const int offset, const int length, const int expected_crc, const uint8_t mode = NORMAL, RomTiming* timing = NULL, uint32_t* found_crc = NULL);
+    int load_zip(const ZipFile* zip, const char* filename, const int offset, const int length, const int expected_crc, const uint8_t mode = NORMAL, RomTiming* timing = NULL, uint32_t* found_crc = NULL);
     int load_binary(const char* filename);
     void unload(void);
 
@@ -37,14 +65,14 @@ public:
 
     inline uint32_t read32(uint32_t* addr)
     {    
-        uint32_t data = (rom[*addr] << 24) | (rom[*addr+1] << 16) | (rom[*addr+2] << 8) | (rom[*addr+3]);
+        uint32_t data = read32(*addr);
         *addr += 4;
         return data;
     }
 
     inline uint16_t read16(uint32_t* addr)
     {
-        uint16_t data = (rom[*addr] << 8) | (rom[*addr+1]);
+        uint16_t data = read16(*addr);
         *addr += 2;
         return data;
     }
@@ -56,12 +84,32 @@ public:
 
     inline uint32_t read32(uint32_t addr)
     {    
-        return (rom[addr] << 24) | (rom[addr+1] << 16) | (rom[addr+2] << 8) | rom[addr+3];
+        uint32_t data;
+
+        if (rom16 == NULL || (addr & 1))
+            return read32_bytes(addr);
+        else if ((addr & 3) == 0)
+            data = rom32[addr >> 2];
+        else
+            data = (rom16[addr >> 1] << 16) | rom16[(addr >> 1) + 1];
+
+        if (DEBUG_ROM_READS)
+            assert(data == read32_bytes(addr));
+
+        return data;
     }
 
     inline uint16_t read16(uint32_t addr)
     {
-        return (rom[addr] << 8) | rom[addr+1];
+        if (rom16 == NULL || (addr & 1))
+            return read16_bytes(addr);
+
+        uint16_t data = rom16[addr >> 1];
+
+        if (DEBUG_ROM_READS)
+            assert(data == read16_bytes(addr));
+
+        return data;
     }
 
     inline uint8_t read8(uint32_t addr)
@@ -76,7 +124,7 @@ public:
 
     inline uint16_t read16(uint16_t* addr)
     {
-        uint16_t data = (rom[*addr+1] << 8) | (rom[*addr]);
+        uint16_t data = read16(*addr);
         *addr += 2;
         return data;
     }
@@ -88,7 +136,13 @@ public:
 
     inline uint16_t read16(uint16_t addr)
     {
+#ifdef ROM_NATIVE_LE
+        uint16_t data;
+        memcpy(&data, &rom[addr], sizeof(uint16_t));
+        return data;
+#else
         return (rom[addr+1] << 8) | rom[addr];
+#endif
     }
 
     inline uint8_t read8(uint16_t addr)
@@ -98,4 +152,15 @@ public:
 
 private:
     int filesize(const char* filename);
+
+    // Big endian reads, direct from the byte array
+    inline uint32_t read32_bytes(uint32_t addr)
+    {
+        return (rom[addr] << 24) | (rom[addr+1] << 16) | (rom[addr+2] << 8) | rom[addr+3];
+    }
+
+    inline uint16_t read16_bytes(uint32_t addr)
+    {
+        return (rom[addr] << 8) | rom[addr+1];
+    }
 };
\ No newline at end of file
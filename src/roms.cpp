@@ -5,14 +5,26 @@
     See license.txt for more details.
 ***************************************************************************/
 
+#include <iostream>
+#include <iomanip>
+#include <cstdio>
+#include <cstdlib>
+#include <boost/bind/bind.hpp>
+#include <boost/thread/thread.hpp>
+#include <boost/date_time/posix_time/posix_time_types.hpp>
+
 #include "stdint.hpp"
 #include "roms.hpp"
+#include "utils.hpp"
+
+ENGINE_LOCAL Roms roms;
 
-Roms roms;
+const char* Roms::ARCHIVE_NAMES[] = { "outrun.zip", "outrunb.zip" };
 
 Roms::Roms()
 {
     jap_rom_status = -1;
+    verbose        = false;
 }
 
 Roms::~Roms(void)
@@ -21,71 +33,70 @@ Roms::~Roms(void)
 
 bool Roms::load_revb_roms()
 {
-    // If incremented, a rom has failed to load.
-    int status = 0;
-
-    // Load Master CPU ROMs
     rom0.init(0x40000);
-    status += rom0.load("epr-10381a.132", 0x20000, 0x10000, 0xbe8c412b, RomLoader::INTERLEAVE2);
-    
-    // Try alternate filename for this rom
-    if (status)
-    {
-        rom0.load("epr-10381b.132", 0x20000, 0x10000, 0xbe8c412b, RomLoader::INTERLEAVE2);
-        status--;
-    }
-    
-    status += rom0.load("epr-10383b.117", 0x20001, 0x10000, 0x10a2014a, RomLoader::INTERLEAVE2);
-    status += rom0.load("epr-10380b.133", 0x00000, 0x10000, 0x1f6cadad, RomLoader::INTERLEAVE2);
-    status += rom0.load("epr-10382b.118", 0x00001, 0x10000, 0xc4c3fa1a, RomLoader::INTERLEAVE2);
-
-    // Load Slave CPU ROMs
     rom1.init(0x40000);
-    status += rom1.load("epr-10327a.76", 0x00000, 0x10000, 0xe28a5baf, RomLoader::INTERLEAVE2);
-    status += rom1.load("epr-10329a.58", 0x00001, 0x10000, 0xda131c81, RomLoader::INTERLEAVE2);
-    status += rom1.load("epr-10328a.75", 0x20000, 0x10000, 0xd5ec5e5d, RomLoader::INTERLEAVE2);
-    status += rom1.load("epr-10330a.57", 0x20001, 0x10000, 0xba9ec82a, RomLoader::INTERLEAVE2);
-
-    // Load Non-Interleaved Tile ROMs
     tiles.init(0x30000);
-    status += tiles.load("opr-10268.99",  0x00000, 0x08000, 0x95344b04);
-    status += tiles.load("opr-10232.102", 0x08000, 0x08000, 0x776ba1eb);
-    status += tiles.load("opr-10267.100", 0x10000, 0x08000, 0xa85bb823);
-    status += tiles.load("opr-10231.103", 0x18000, 0x08000, 0x8908bcbf);
-    status += tiles.load("opr-10266.101", 0x20000, 0x08000, 0x9f6f1a74);
-    status += tiles.load("opr-10230.104", 0x28000, 0x08000, 0x686f5e50);
-
-    // Load Non-Interleaved Road ROMs (2 identical roms, 1 for each road)
     road.init(0x10000);
-    status += road.load("opr-10185.11", 0x000000, 0x08000, 0x22794426);
-    status += road.load("opr-10186.47", 0x008000, 0x08000, 0x22794426);
-
-    // Load Interleaved Sprite ROMs
     sprites.init(0x100000);
-    status += sprites.load("mpr-10371.9",  0x000000, 0x20000, 0x7cc86208, RomLoader::INTERLEAVE4);
-    status += sprites.load("mpr-10373.10", 0x000001, 0x20000, 0xb0d26ac9, RomLoader::INTERLEAVE4);
-    status += sprites.load("mpr-10375.11", 0x000002, 0x20000, 0x59b60bd7, RomLoader::INTERLEAVE4);
-    status += sprites.load("mpr-10377.12", 0x000003, 0x20000, 0x17a1b04a, RomLoader::INTERLEAVE4);
-    status += sprites.load("mpr-10372.13", 0x080000, 0x20000, 0xb557078c, RomLoader::INTERLEAVE4);
-    status += sprites.load("mpr-10374.14", 0x080001, 0x20000, 0x8051e517, RomLoader::INTERLEAVE4);
-    status += sprites.load("mpr-10376.15", 0x080002, 0x20000, 0xf3b8f318, RomLoader::INTERLEAVE4);
-    status += sprites.load("mpr-10378.16", 0x080003, 0x20000, 0xa1062984, RomLoader::INTERLEAVE4);
-
-    // Load Z80 Sound ROM
     z80.init(0x10000);
-    status += z80.load("epr-10187.88", 0x0000, 0x10000, 0xa10abaa9);
-
-    // Load Sega PCM Chip Samples
     pcm.init(0x60000);
-    status += pcm.load("opr-10193.66", 0x00000, 0x08000, 0xbcd10dde);
-    status += pcm.load("opr-10192.67", 0x10000, 0x08000, 0x770f1270);
-    status += pcm.load("opr-10191.68", 0x20000, 0x08000, 0x20a284ab);
-    status += pcm.load("opr-10190.69", 0x30000, 0x08000, 0x7cab70e2);
-    status += pcm.load("opr-10189.70", 0x40000, 0x08000, 0x01366b54);
-    status += pcm.load("opr-10188.71", 0x50000, 0x08000, 0xbad30ad9);
 
-    // If status has been incremented, a rom has failed to load.
-    return status == 0;
+    RomFile files[] =
+    {
+        // Load Master CPU ROMs (Try alternate filename for the first rom)
+        { &rom0, "epr-10381a.132", "epr-10381b.132", 0x20000, 0x10000, 0xbe8c412b, RomLoader::INTERLEAVE2 },
+        { &rom0, "epr-10383b.117", NULL, 0x20001, 0x10000, 0x10a2014a, RomLoader::INTERLEAVE2 },
+        { &rom0, "epr-10380b.133", NULL, 0x00000, 0x10000, 0x1f6cadad, RomLoader::INTERLEAVE2 },
+        { &rom0, "epr-10382b.118", NULL, 0x00001, 0x10000, 0xc4c3fa1a, RomLoader::INTERLEAVE2 },
+
+        // Load Slave CPU ROMs
+        { &rom1, "epr-10327a.76",  NULL, 0x00000, 0x10000, 0xe28a5baf, RomLoader::INTERLEAVE2 },
+        { &rom1, "epr-10329a.58",  NULL, 0x00001, 0x10000, 0xda131c81, RomLoader::INTERLEAVE2 },
+        { &rom1, "epr-10328a.75",  NULL, 0x20000, 0x10000, 0xd5ec5e5d, RomLoader::INTERLEAVE2 },
+        { &rom1, "epr-10330a.57",  NULL, 0x20001, 0x10000, 0xba9ec82a, RomLoader::INTERLEAVE2 },
+
+        // Load Non-Interleaved Tile ROMs
+        { &tiles, "opr-10268.99",  NULL, 0x00000, 0x08000, 0x95344b04, RomLoader::NORMAL },
+        { &tiles, "opr-10232.102", NULL, 0x08000, 0x08000, 0x776ba1eb, RomLoader::NORMAL },
+        { &tiles, "opr-10267.100", NULL, 0x10000, 0x08000, 0xa85bb823, RomLoader::NORMAL },
+        { &tiles, "opr-10231.103", NULL, 0x18000, 0x08000, 0x8908bcbf, RomLoader::NORMAL },
+        { &tiles, "opr-10266.101", NULL, 0x20000, 0x08000, 0x9f6f1a74, RomLoader::NORMAL },
+        { &tiles, "opr-10230.104", NULL, 0x28000, 0x08000, 0x686f5e50, RomLoader::NORMAL },
+
+        // Load Non-Interleaved Road ROMs (2 identical roms, 1 for each road)
+        { &road, "opr-10185.11", NULL, 0x000000, 0x08000, 0x22794426, RomLoader::NORMAL },
+        { &road, "opr-10186.47", NULL, 0x008000, 0x08000, 0x22794426, RomLoader::NORMAL },
+
+        // Load Interleaved Sprite ROMs
+        { &sprites, "mpr-10371.9",  NULL, 0x000000, 0x20000, 0x7cc86208, RomLoader::INTERLEAVE4 },
+        { &sprites, "mpr-10373.10", NULL, 0x000001, 0x20000, 0xb0d26ac9, RomLoader::INTERLEAVE4 },
+        { &sprites, "mpr-10375.11", NULL, 0x000002, 0x20000, 0x59b60bd7, RomLoader::INTERLEAVE4 },
+        { &sprites, "mpr-10377.12", NULL, 0x000003, 0x20000, 0x17a1b04a, RomLoader::INTERLEAVE4 },
+        { &sprites, "mpr-10372.13", NULL, 0x080000, 0x20000, 0xb557078c, RomLoader::INTERLEAVE4 },
+        { &sprites, "mpr-10374.14", NULL, 0x080001, 0x20000, 0x8051e517, RomLoader::INTERLEAVE4 },
+        { &sprites, "mpr-10376.15", NULL, 0x080002, 0x20000, 0xf3b8f318, RomLoader::INTERLEAVE4 },
+        { &sprites, "mpr-10378.16", NULL, 0x080003, 0x20000, 0xa1062984, RomLoader::INTERLEAVE4 },
+
+        // Load Z80 Sound ROM
+        { &z80, "epr-10187.88", NULL, 0x0000, 0x10000, 0xa10abaa9, RomLoader::NORMAL },
+
+        // Load Sega PCM Chip Samples
+        { &pcm, "opr-10193.66", NULL, 0x00000, 0x08000, 0xbcd10dde, RomLoader::NORMAL },
+        { &pcm, "opr-10192.67", NULL, 0x10000, 0x08000, 0x770f1270, RomLoader::NORMAL },
+        { &pcm, "opr-10191.68", NULL, 0x20000, 0x08000, 0x20a284ab, RomLoader::NORMAL },
+        { &pcm, "opr-10190.69", NULL, 0x30000, 0x08000, 0x7cab70e2, RomLoader::NORMAL },
+        { &pcm, "opr-10189.70", NULL, 0x40000, 0x08000, 0x01366b54, RomLoader::NORMAL },
+        { &pcm, "opr-10188.71", NULL, 0x50000, 0x08000, 0xbad30ad9, RomLoader::NORMAL },
+    };
+
+    if (!load_files(files, sizeof(files) / sizeof(RomFile)))
+        return false;
+
+    // Native endian copies for the translated 68000 code
+    rom0.create_mirrors();
+    rom1.create_mirrors();
+
+    return true;
 }
 
 bool Roms::load_japanese_roms()
@@ -97,32 +108,150 @@ bool Roms::load_japanese_roms()
         j_rom1.init(0x40000);
     }
 
+    RomFile files[] =
+    {
+        // Load Master CPU ROMs
+        { &j_rom0, "epr-10380.133", NULL, 0x00000, 0x10000, 0xe339e87a, RomLoader::INTERLEAVE2 },
+        { &j_rom0, "epr-10382.118", NULL, 0x00001, 0x10000, 0x65248dd5, RomLoader::INTERLEAVE2 },
+        { &j_rom0, "epr-10381.132", NULL, 0x20000, 0x10000, 0xbe8c412b, RomLoader::INTERLEAVE2 },
+        { &j_rom0, "epr-10383.117", NULL, 0x20001, 0x10000, 0xdcc586e7, RomLoader::INTERLEAVE2 },
+
+        // Load Slave CPU ROMs
+        { &j_rom1, "epr-10327.76",  NULL, 0x00000, 0x10000, 0xda99d855, RomLoader::INTERLEAVE2 },
+        { &j_rom1, "epr-10329.58",  NULL, 0x00001, 0x10000, 0xfe0fa5e2, RomLoader::INTERLEAVE2 },
+        { &j_rom1, "epr-10328.75",  NULL, 0x20000, 0x10000, 0x3c0e9a7f, RomLoader::INTERLEAVE2 },
+        { &j_rom1, "epr-10330.57",  NULL, 0x20001, 0x10000, 0x59786e99, RomLoader::INTERLEAVE2 },
+    };
+
     // If incremented, a rom has failed to load.
-    jap_rom_status = 0;
-
-    // Load Master CPU ROMs     
-    jap_rom_status += j_rom0.load("epr-10380.133", 0x00000, 0x10000, 0xe339e87a, RomLoader::INTERLEAVE2);
-    jap_rom_status += j_rom0.load("epr-10382.118", 0x00001, 0x10000, 0x65248dd5, RomLoader::INTERLEAVE2);
-    jap_rom_status += j_rom0.load("epr-10381.132", 0x20000, 0x10000, 0xbe8c412b, RomLoader::INTERLEAVE2);
-    jap_rom_status += j_rom0.load("epr-10383.117", 0x20001, 0x10000, 0xdcc586e7, RomLoader::INTERLEAVE2);
-
-    // Load Slave CPU ROMs        
-    jap_rom_status += j_rom1.load("epr-10327.76", 0x00000, 0x10000, 0xda99d855, RomLoader::INTERLEAVE2);
-    jap_rom_status += j_rom1.load("epr-10329.58", 0x00001, 0x10000, 0xfe0fa5e2, RomLoader::INTERLEAVE2);
-    jap_rom_status += j_rom1.load("epr-10328.75", 0x20000, 0x10000, 0x3c0e9a7f, RomLoader::INTERLEAVE2);
-    jap_rom_status += j_rom1.load("epr-10330.57", 0x20001, 0x10000, 0x59786e99, RomLoader::INTERLEAVE2);
-    // If status has been incremented, a rom has failed to load.
+    jap_rom_status = load_files(files, sizeof(files) / sizeof(RomFile)) ? 0 : 1;
+
+    if (jap_rom_status == 0)
+    {
+        j_rom0.create_mirrors();
+        j_rom1.create_mirrors();
+    }
+
     return jap_rom_status == 0;
 }
 
 bool Roms::load_pcm_rom(bool fixed_rom)
 {
-    int status = 0;
+    RomFile file = { &pcm, "opr-10188.71", NULL, 0x50000, 0x08000, 0xbad30ad9, RomLoader::NORMAL };
 
     if (fixed_rom)
-        status += pcm.load("opr-10188.71f", 0x50000, 0x08000, 0x37598616);
-    else
-        status += pcm.load("opr-10188.71", 0x50000, 0x08000, 0xbad30ad9);
+    {
+        file.filename = "opr-10188.71f";
+        file.crc      = 0x37598616;
+    }
+
+    return load_files(&file, 1);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Load a set of files on a small pool of threads.
+//
+// Each file is written to its own (interleaved) bytes of the destination, so no locking is needed.
+// ------------------------------------------------------------------------------------------------
+
+bool Roms::load_files(RomFile* files, const int count)
+{
+    boost::posix_time::ptime start = boost::posix_time::microsec_clock::universal_time();
+
+    // Files are located in the archives by CRC, as MAME sets may name them differently
+    ZipFile archives[ARCHIVES];
+    for (int i = 0; i < ARCHIVES; i++)
+    {
+        char path[256];
+        snprintf(path, sizeof(path), "%s/.cannonball/roms/%s", getenv("HOME"), ARCHIVE_NAMES[i]);
+        archives[i].open(path);
+    }
+
+    int threads = boost::thread::hardware_concurrency();
+    if (threads > LOAD_THREADS)
+        threads = LOAD_THREADS;
+    if (threads > count)
+        threads = count;
+    if (threads < 1)
+        threads = 1;
+
+    boost::thread_group pool;
+
+    // Thread 0 is the calling thread
+    for (int t = 1; t < threads; t++)
+    {
+        try
+        {
+            pool.create_thread(boost::bind(&Roms::load_thread, files, archives, t, count, threads));
+        }
+        catch (boost::thread_resource_error&)
+        {
+            // Load this thread's share on the calling thread instead
+            load_thread(files, archives, t, count, threads);
+        }
+    }
+
+    load_thread(files, archives, 0, count, threads);
+    pool.join_all();
+
+    // If status has been incremented, a rom has failed to load.
+    int status = 0;
+
+    for (int i = 0; i < count; i++)
+    {
+        status += files[i].status;
+        files[i].loader->loaded = true;
+    }
+
+    for (int i = 0; i < count; i++)
+    {
+        if (files[i].status)
+            files[i].loader->loaded = false;
+        else
+            files[i].loader->crc = Utils::crc32((const uint8_t*) &files[i].found_crc, sizeof(uint32_t), files[i].loader->crc);
+    }
+
+    if (verbose)
+    {
+        for (int i = 0; i < count; i++)
+        {
+            const RomTiming* t = &files[i].timing;
+            std::cout << std::left << std::setw(16) << files[i].filename
+                      << "read: "        << std::setw(8) << t->read
+                      << "crc: "         << std::setw(8) << t->crc
+                      << "interleave: "  << std::setw(8) << t->interleave << "us" << std::endl;
+        }
+        std::cout << "Loaded " << count << " files in " 
+                  << (boost::posix_time::microsec_clock::universal_time() - start).total_milliseconds() 
+                  << "ms on " << threads << " threads" << std::endl;
+    }
 
     return status == 0;
+}
+
+void Roms::load_thread(RomFile* files, const ZipFile* archives, const int first, const int count, const int step)
+{
+    for (int i = first; i < count; i += step)
+        load_file(&files[i], archives);
+}
+
+void Roms::load_file(RomFile* f, const ZipFile* archives)
+{
+    f->timing.read = f->timing.crc = f->timing.interleave = 0;
+    f->found_crc = 0;
+
+    for (int i = 0; i < ARCHIVES; i++)
+    {
+        if (archives[i].is_open() &&
+            f->loader->load_zip(&archives[i], f->filename, f->offset, f->length, f->crc, f->mode, &f->timing, &f->found_crc) == 0)
+        {
+            f->status = 0;
+            return;
+        }
+    }
+
+    f->status = f->loader->load(f->filename, f->offset, f->length, f->crc, f->mode, &f->timing, &f->found_crc);
+
+    if (f->status && f->alt_filename != NULL)
+        f->status = f->loader->load(f->alt_filename, f->offset, f->length, f->crc, f->mode, &f->timing, &f->found_crc);
 }
\ No newline at end of file
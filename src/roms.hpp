@@ -7,7 +7,9 @@
 
 #pragma once
 
+#include "globals.hpp"
 #include "romloader.hpp"
+#include "zipfile.hpp"
 
 class Roms
 {
@@ -29,6 +31,9 @@ public:
     RomLoader* rom0p;
     RomLoader* rom1p;
 
+    // Report a timing breakdown for each file loaded
+    bool verbose;
+
     Roms();
     ~Roms();
     bool load_revb_roms();
@@ -37,6 +42,33 @@ public:
 
 private:
     int jap_rom_status;
+
+    // Maximum threads to load ROM files on
+    const static int LOAD_THREADS = 4;
+
+    // MAME style rom archives, searched before the individual files
+    const static int ARCHIVES = 2;
+    static const char* ARCHIVE_NAMES[ARCHIVES];
+
+    // File to load into a RomLoader
+    struct RomFile
+    {
+        RomLoader* loader;
+        const char* filename;
+        const char* alt_filename;   // Alternate filename to try, or NULL
+        int offset;
+        int length;
+        uint32_t crc;
+        uint8_t mode;
+
+        int status;                 // Non-zero if the file failed to load
+        uint32_t found_crc;         // Checksum of the file as loaded
+        RomTiming timing;
+    };
+
+    bool load_files(RomFile* files, const int count);
+    static void load_file(RomFile* file, const ZipFile* archives);
+    static void load_thread(RomFile* files, const ZipFile* archives, const int first, const int count, const int step);
 };
 
-extern Roms roms;
\ No newline at end of file
+extern ENGINE_LOCAL Roms roms;
\ No newline at end of file
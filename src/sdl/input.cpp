@@ -12,7 +12,7 @@
 #include <cstdlib> // abs
 #include "sdl/input.hpp"
 
-Input input;
+ENGINE_LOCAL Input input;
 
 Input::Input(void)
 {
@@ -138,6 +138,10 @@ void Input::handle_key(const int key, const bool is_pressed)
             keys[TIMER] = is_pressed;
             break;
 
+        case SDLK_F4:
+            keys[TURBO] = is_pressed;
+            break;
+
         case SDLK_F5:
             keys[MENU] = is_pressed;
             break;
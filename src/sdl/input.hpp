@@ -11,6 +11,7 @@
 #pragma once
 
 #include <SDL.h>
+#include "globals.hpp"
 
 class Input
 {
@@ -33,11 +34,12 @@ public:
         PAUSE = 11,
         STEP  = 12,
         TIMER = 13,
-        MENU = 14,     
+        MENU = 14,
+        TURBO = 15,     
     };
 
-    bool keys[15];
-    bool keys_old[15];
+    bool keys[16];
+    bool keys_old[16];
 
     // Has gamepad been found?
     bool gamepad;
@@ -94,4 +96,4 @@ private:
     void handle_joy(const uint8_t, const bool);
 };
 
-extern Input input;
\ No newline at end of file
+extern ENGINE_LOCAL Input input;
\ No newline at end of file
@@ -1,8 +1,7 @@
 /***************************************************************************
     SDL Software Video Rendering.  
     
-    Known Bugs:
-    - Scanlines don't work when Endian changed?
+    Scaling and scanlines are drawn by PostProcess (see postprocess.hpp).
 
     Copyright Chris White.
     See license.txt for more details.
@@ -11,6 +10,7 @@
 #pragma once
 
 #include "renderbase.hpp"
+#include "postprocess.hpp"
 
 class RenderSW : public RenderBase
 {
@@ -27,20 +27,15 @@ public:
     void draw_frame(uint16_t* pixels);
 
 private:
-    // Scanline pixels
-    uint32_t* scan_pixels;
-
     // Pixel Conversion
     uint32_t* pix;
 
-    // Scale the screen
+    // Scale the screen. 0 = Fractional scale.
     int scale_factor;
 
+    // Integer scaling and scanlines
+    PostProcess post;
+
     void scale( uint32_t* src, int srcwid, int srchgt, 
                 uint32_t* dest, int dstwid, int dsthgt);
-    
-    void scanlines_32bpp(uint32_t* src, const int width, const int height, 
-                         uint32_t* dst, int percent, const bool interpolate = true);
-
-    void scalex( uint32_t* src, const int srcwid, const int srchgt, uint32_t* dest, const int scale);
 };
\ No newline at end of file
@@ -7,14 +7,16 @@
     It takes the output from the PCM and YM chips, mixes them and then
     outputs appropriately.
     
-    In order to achieve seamless audio, when audio is enabled the framerate
-    is adjusted to essentially sync the video to the audio output.
+    In order to achieve seamless audio, the output is resampled by up to 0.5%,
+    so that the buffer stays at its target fill while the video runs at a
+    fixed rate. The resampling ratio is set by a PI controller.
     
     This is based upon code from the Atari800 emulator project.
     Copyright (c) 1998-2008 Atari800 development team
 ***************************************************************************/
 
 #include <iostream>
+#include <cmath>
 #include <SDL.h>
 
 #ifdef SDL2
@@ -25,6 +27,7 @@
 
 #include "frontend/config.hpp" // fps
 #include "engine/audio/osoundint.hpp"
+#include "framepacer.hpp"        // now()
 
 #ifdef COMPILE_SOUND_CODE
 
@@ -40,14 +43,27 @@ static int dsp_read_pos;
 static int callbacktick;     // tick at which callback occured
 static int bytes_per_sample; // Number of bytes per sample entry (usually 4 bytes if stereo and 16-bit sound)
 
+// Latency measurement. A queued sound is tracked until its first samples leave fill_audio.
+static bool latency_armed;
+static int latency_pos;        // Buffer position of the sound's first samples
+static int64_t latency_start;  // Time the sound was queued (ns)
+static int64_t latency_end;    // Time its samples left fill_audio (ns). 0 = Not yet.
+
 // SDL Audio Callback Function
 extern void fill_audio(void *udata, Uint8 *stream, int len);
 
+// Buffer fill controller. Gains are per ms of error from the target fill.
+static const double SYNC_MAX_ADJUST = 0.005;            // Limit resampling to +/-0.5%
+static const double SYNC_KP         = 0.0002;           // Proportional gain
+static const double SYNC_KI         = 0.00005;          // Integral gain (per ms * second)
+static const double SYNC_ALPHA      = 2.0 / (1.0 + 40.0); // Smoothing of the measured fill
+
 // ----------------------------------------------------------------------------
 
 Audio::Audio()
 {
-
+    log_sync    = false;
+    log_latency = false;
 }
 
 Audio::~Audio()
@@ -92,13 +108,20 @@ void Audio::start_audio()
 	    }		
 	}
 
+        // Buffer Settings
+        samples = 128;
+        while (samples < (uint32_t) config.sound.buffer_samples && samples < 8192)
+            samples <<= 1;
+        frags     = config.sound.buffer_frags < 2 ? 2 : config.sound.buffer_frags;
+        snd_delay = config.sound.delay < 0 ? 0 : config.sound.delay;
+
         // SDL Audio Properties
         SDL_AudioSpec desired, obtained;
 
         desired.freq     = FREQ;
         desired.format   = AUDIO_S16SYS;
         desired.channels = CHANNELS;
-        desired.samples  = SAMPLES;
+        desired.samples  = samples;
         desired.callback = fill_audio;
         desired.userdata = NULL;
 	
@@ -121,16 +144,25 @@ void Audio::start_audio()
         // Start Audio
         sound_enabled = true;
 
+        if (log_latency)
+        {
+            std::cout << "Audio buffer: " << samples << " samples x " << frags << " fragments, "
+                      << snd_delay << "ms delay" << std::endl;
+        }
+
         // how many fragments in the dsp buffer
-        const int DSP_BUFFER_FRAGS = 5;
-        int specified_delay_samps = (FREQ * SND_DELAY) / 1000;
-        int dsp_buffer_samps = SAMPLES * DSP_BUFFER_FRAGS + specified_delay_samps;
+        int specified_delay_samps = (FREQ * snd_delay) / 1000;
+        int dsp_buffer_samps = samples * frags + specified_delay_samps;
         dsp_buffer_bytes = CHANNELS * dsp_buffer_samps * (BITS / 8);
         dsp_buffer = new uint8_t[dsp_buffer_bytes];
 
         // Create Buffer For Mixing
         uint16_t buffer_size = (FREQ / config.fps) * CHANNELS;
         mix_buffer = new uint16_t[buffer_size];
+        wav_buffer = new int16_t[buffer_size];
+
+        // Resampling can add up to 0.5%, plus a sample either side
+        resample_buffer = new int16_t[buffer_size + (buffer_size / 100) + (CHANNELS * 2)];
 
         clear_buffers();
         clear_wav();
@@ -142,11 +174,25 @@ void Audio::start_audio()
 void Audio::clear_buffers()
 {
     dsp_read_pos  = 0;
-    int specified_delay_samps = (FREQ * SND_DELAY) / 1000;
-    dsp_write_pos = (specified_delay_samps+SAMPLES) * bytes_per_sample;
-    avg_gap = 0.0;
+    int specified_delay_samps = (FREQ * snd_delay) / 1000;
+    dsp_write_pos = (specified_delay_samps+samples) * bytes_per_sample;
     gap_est = 0;
 
+    fill_avg      = -1.0;
+    sync_integral = 0.0;
+    ratio         = 1.0;
+    resample_pos  = 0.0;
+    log_ticks     = 0;
+
+    latency_armed = false;
+    latency_end   = 0;
+    latency_count = 0;
+    latency_sum   = 0;
+    latency_min   = 0;
+    latency_max   = 0;
+    for (uint32_t c = 0; c < CHANNELS; c++)
+        resample_last[c] = 0;
+
     for (int i = 0; i < dsp_buffer_bytes; i++)
         dsp_buffer[i] = 0;
 
@@ -166,25 +212,12 @@ void Audio::stop_audio()
         SDL_PauseAudioDevice(dev,1);
         SDL_CloseAudioDevice(dev);
 
+        wavstream.close();
+
         delete[] dsp_buffer;
         delete[] mix_buffer;
-    }
-}
-
-void Audio::pause_audio()
-{
-    if (sound_enabled)
-    {
-        SDL_PauseAudioDevice(dev,1);
-    }
-}
-
-void Audio::resume_audio()
-{
-    if (sound_enabled)
-    {
-        clear_buffers();
-        SDL_PauseAudioDevice(dev,0);
+        delete[] wav_buffer;
+        delete[] resample_buffer;
     }
 }
 
@@ -195,7 +228,11 @@ void Audio::tick()
     int newpos;
     double bytes_per_ms;
 
-    if (!sound_enabled) return;
+    if (!sound_enabled)
+    {
+        osoundint.latency_mark = 0;
+        return;
+    }
 
     // Update audio streams from PCM & YM Devices
     osoundint.pcm->stream_update();
@@ -204,14 +241,20 @@ void Audio::tick()
     // Get the audio buffers we've just output
     int16_t *pcm_buffer = osoundint.pcm->get_buffer();
     int16_t *ym_buffer  = osoundint.ym->get_buffer();
-    int16_t *wav_buffer = wavfile.data;
 
     int samples_written = osoundint.pcm->buffer_size;
 
+    // Custom music
+    const bool music = wavstream.is_open();
+    if (music)
+        wavstream.read(wav_buffer, samples_written);
+
     // And mix them into the mix_buffer
     for (int i = 0; i < samples_written; i++)
     {
-        int32_t mix_data = wav_buffer[wavfile.pos] + pcm_buffer[i] + ym_buffer[i];
+        int32_t mix_data = pcm_buffer[i] + ym_buffer[i];
+        if (music)
+            mix_data += wav_buffer[i];
 
         // Clip mix data
         if (mix_data >= (1 << 15))
@@ -220,20 +263,12 @@ void Audio::tick()
             mix_data = -(1 << 15);
 
         mix_buffer[i] = mix_data;
-
-        // Loop wav files
-        if (++wavfile.pos >= wavfile.length)
-            wavfile.pos = 0;
     }
 
-    // Cast mix_buffer to a byte array, to align it with internal SDL format 
-    uint8_t* mbuf8 = (uint8_t*) mix_buffer;
-
     // produce samples from the sound emulation
     bytes_per_ms = (bytes_per_sample) * (FREQ/1000.0);
-    bytes_written = (BITS == 8 ? samples_written : samples_written*2);
-    
-    SDL_LockAudio();
+
+    SDL_LockAudioDevice(dev);
 
     // this is the gap as of the most recent callback
     int gap = dsp_write_pos - dsp_read_pos;
@@ -241,17 +276,45 @@ void Audio::tick()
     if (callbacktick != 0)
         gap_est = (int) (gap - (bytes_per_ms)*(SDL_GetTicks() - callbacktick));
 
+    SDL_UnlockAudioDevice(dev);
+
+    // Resample to keep the buffer at its target fill
+    if (callbacktick != 0)
+        update_sync();
+
+    samples_written = resample((int16_t*) mix_buffer, samples_written, resample_buffer);
+
+    // Cast resample_buffer to a byte array, to align it with internal SDL format 
+    uint8_t* mbuf8 = (uint8_t*) resample_buffer;
+    bytes_written = (BITS == 8 ? samples_written : samples_written*2);
+
+    SDL_LockAudioDevice(dev);
+    gap = dsp_write_pos - dsp_read_pos;
+
     // if there isn't enough room...
     while (gap + bytes_written > dsp_buffer_bytes) 
     {
         // then we allow the callback to run..
-        SDL_UnlockAudio();
+        SDL_UnlockAudioDevice(dev);
         // and delay until it runs and allows space.
         SDL_Delay(1);
-        SDL_LockAudio();
+        SDL_LockAudioDevice(dev);
         //printf("sound buffer overflow:%d %d\n",gap, dsp_buffer_bytes);
         gap = dsp_write_pos - dsp_read_pos;
     }
+
+    // Track a newly queued sound. Its first samples are in this block.
+    if (osoundint.latency_mark)
+    {
+        if (!latency_armed)
+        {
+            latency_armed = true;
+            latency_pos   = dsp_write_pos;
+            latency_start = osoundint.latency_mark;
+        }
+        osoundint.latency_mark = 0;
+    }
+
     // now we copy the data into the buffer and adjust the positions
     newpos = dsp_write_pos + bytes_written;
     if (newpos/dsp_buffer_bytes == dsp_write_pos/dsp_buffer_bytes) 
@@ -276,50 +339,98 @@ void Audio::tick()
     {
         dsp_write_pos -= dsp_buffer_bytes;
         dsp_read_pos -= dsp_buffer_bytes;
+        latency_pos -= dsp_buffer_bytes;
     }
-    SDL_UnlockAudio();
+
+    const int64_t end = latency_end;
+    latency_end = 0;
+    SDL_UnlockAudioDevice(dev);
+
+    if (end)
+        update_latency(end);
 }
 
-// Adjust the speed of the emulator, based on audio streaming performance.
-// This ensures that we avoid pops and crackles (in theory). 
-double Audio::adjust_speed()
+// Set the resampling ratio from the buffer fill, with a PI controller.
+// This ensures that we avoid pops and crackles, without changing the speed of the emulator.
+void Audio::update_sync()
 {
-    if (!sound_enabled)
-        return 1.0;
+    const double fill = gap_est / ((bytes_per_sample) * (FREQ/1000.0));
 
-    double alpha = 2.0 / (1.0+40.0);
-    int gap_too_small;
-    int gap_too_large;
-    bool inited = false;
+    // Smooth the jitter caused by the size of the callback
+    if (fill_avg < 0)
+        fill_avg = fill;
+    else
+        fill_avg += SYNC_ALPHA * (fill - fill_avg);
 
-    if (!inited) 
-    {
-        inited = true;
-        avg_gap = gap_est;
-    }
-    else 
+    // Aim for the middle of the allowed spread
+    const double error = (snd_delay + (SND_SPREAD / 2.0)) - fill_avg;
+
+    // Integrate the error, without winding up beyond the adjustment limit
+    const double integral_max = SYNC_MAX_ADJUST / SYNC_KI;
+    sync_integral += error / config.fps;
+    if (sync_integral > integral_max)       sync_integral = integral_max;
+    else if (sync_integral < -integral_max) sync_integral = -integral_max;
+
+    double adjust = (SYNC_KP * error) + (SYNC_KI * sync_integral);
+    if (adjust > SYNC_MAX_ADJUST)       adjust = SYNC_MAX_ADJUST;
+    else if (adjust < -SYNC_MAX_ADJUST) adjust = -SYNC_MAX_ADJUST;
+
+    ratio = 1.0 + adjust;
+
+    if (log_sync && ++log_ticks >= config.fps)
     {
-        avg_gap = avg_gap + alpha * (gap_est - avg_gap);
+        log_ticks = 0;
+        std::cout << "Audio sync: fill " << fill_avg << "ms, ratio " << ratio
+                  << " (P " << (SYNC_KP * error) << ", I " << (SYNC_KI * sync_integral) << ")" << std::endl;
     }
+}
 
-    gap_too_small = (SND_DELAY * FREQ * bytes_per_sample)/1000;
-    gap_too_large = ((SND_DELAY + SND_SPREAD) * FREQ * bytes_per_sample)/1000;
-    
-    if (avg_gap < gap_too_small) 
+// Record a latency measurement, once the sound has left fill_audio
+void Audio::update_latency(const int64_t end)
+{
+    const double latency = (end - latency_start) / 1000000.0;
+
+    if (latency_count == 0 || latency < latency_min) latency_min = latency;
+    if (latency_count == 0 || latency > latency_max) latency_max = latency;
+    latency_sum += latency;
+    latency_count++;
+
+    if (log_latency)
     {
-        double speed = 0.9;
-        return speed;
+        std::cout << "Audio latency: " << latency << "ms (min " << latency_min
+                  << ", avg " << (latency_sum / latency_count) << ", max " << latency_max
+                  << " over " << latency_count << " sounds)" << std::endl;
     }
-    if (avg_gap > gap_too_large)
+}
+
+// Resample interleaved samples by the current ratio, with linear interpolation.
+// Returns the number of samples written.
+int Audio::resample(const int16_t* src, const int src_samples, int16_t* dst)
+{
+    const int frames  = src_samples / CHANNELS;
+    const double step = 1.0 / ratio;
+    int16_t* out      = dst;
+
+    for (; resample_pos < frames - 1; resample_pos += step)
     {
-        double speed = 1.1;
-        return speed;
+        const int i     = (int) floor(resample_pos);
+        const double f  = resample_pos - i;
+
+        for (uint32_t c = 0; c < CHANNELS; c++)
+        {
+            const int s0 = i < 0 ? resample_last[c] : src[(i * CHANNELS) + c];
+            const int s1 = src[((i + 1) * CHANNELS) + c];
+            *out++ = (int16_t) (s0 + ((s1 - s0) * f));
+        }
     }
-    return 1.0;
-}
 
-// Empty Wav Buffer
-static int16_t EMPTY_BUFFER[] = {0, 0, 0, 0};
+    // Carry the position over to the next frame
+    resample_pos -= frames;
+    for (uint32_t c = 0; c < CHANNELS; c++)
+        resample_last[c] = src[((frames - 1) * CHANNELS) + c];
+
+    return out - dst;
+}
 
 void Audio::load_wav(const char* filename)
 {
@@ -327,76 +438,15 @@ void Audio::load_wav(const char* filename)
     {
         clear_wav();
 
-        // Load Wav File
-        SDL_AudioSpec wave;
-    
-        uint8_t *data;
-        uint32_t length;
-
-        pause_audio();
-
-        if( SDL_LoadWAV(filename, &wave, &data, &length) == NULL)
-        {
-            wavfile.loaded = 0;
-            resume_audio();
+        // Decoded and converted on the fly by the stream's own thread
+        if (!wavstream.open(filename, FREQ))
             std::cout << "Could not load wav: " << filename << std::endl;
-            return;
-        }
-        
-        SDL_LockAudio();
-
-        // Halve Volume Of Wav File
-        uint8_t* data_vol = new uint8_t[length];
-	SDL_MixAudioFormat(data_vol, data, wave.format, length, SDL_MIX_MAXVOLUME / 2);
-
-        // WAV File Needs Conversion To Target Format
-        if (wave.format != AUDIO_S16 || wave.channels != 2 || wave.freq != FREQ)
-        {
-            SDL_AudioCVT cvt;
-            SDL_BuildAudioCVT(&cvt, wave.format, wave.channels, wave.freq,
-                                    AUDIO_S16,   CHANNELS,      FREQ);
-
-            cvt.buf = (uint8_t*) malloc(length*cvt.len_mult);
-            memcpy(cvt.buf, data_vol, length);
-            cvt.len = length;
-            SDL_ConvertAudio(&cvt);
-            SDL_FreeWAV(data);
-            delete[] data_vol;
-
-            wavfile.data = (int16_t*) cvt.buf;
-            wavfile.length = cvt.len_cvt / 2;
-            wavfile.pos = 0;
-            wavfile.loaded = 1;
-        }
-        // No Conversion Needed
-        else
-        {
-            SDL_FreeWAV(data);
-            wavfile.data = (int16_t*) data_vol;
-            wavfile.length = length / 2;
-            wavfile.pos = 0;
-            wavfile.loaded = 2;
-        }
-
-        resume_audio();
-        SDL_UnlockAudio();
     }
 }
 
 void Audio::clear_wav()
 {
-    if (wavfile.loaded)
-    {
-        if (wavfile.loaded == 1)
-            free(wavfile.data);
-        else
-            delete[] wavfile.data;        
-    }
-
-    wavfile.length = 1;
-    wavfile.data   = EMPTY_BUFFER;
-    wavfile.pos    = 0;
-    wavfile.loaded = false;
+    wavstream.close();
 }
 
 // SDL Audio Callback Function
@@ -450,6 +500,13 @@ void fill_audio(void *udata, Uint8 *stream, int len)
     }
     dsp_read_pos = newpos;
 
+    // The tracked sound has started to leave the buffer
+    if (latency_armed && dsp_read_pos > latency_pos)
+    {
+        latency_armed = false;
+        latency_end   = FramePacer::now();
+    }
+
     // Record the tick at which the callback occured.
     callbacktick = SDL_GetTicks();
 }
@@ -7,8 +7,9 @@
     It takes the output from the PCM and YM chips, mixes them and then
     outputs appropriately.
     
-    In order to achieve seamless audio, when audio is enabled the framerate
-    is adjusted to essentially sync the video to the audio output.
+    In order to achieve seamless audio, the output is resampled by up to 0.5%,
+    so that the buffer stays at its target fill while the video runs at a
+    fixed rate. The resampling ratio is set by a PI controller.
     
     This is based upon code from the Atari800 emulator project.
     Copyright (c) 1998-2008 Atari800 development team
@@ -18,22 +19,22 @@
 
 #include "globals.hpp"
 #include <SDL.h>
+#include "wavstream.hpp"
 
 #ifdef COMPILE_SOUND_CODE
 
-struct wav_t {
-    uint8_t loaded;
-    int16_t *data;
-    uint32_t pos;
-    uint32_t length;
-};
-
 class Audio
 {
 public:
     // Enable/Disable Sound
     bool sound_enabled;
 
+    // Print the buffer fill and resampling ratio once a second
+    bool log_sync;
+
+    // Print the latency of each queued sound, from osoundint.queue_sound() to fill_audio()
+    bool log_latency;
+
     Audio();
     ~Audio();
 
@@ -41,7 +42,6 @@ public:
     void tick();
     void start_audio();
     void stop_audio();
-    double adjust_speed();
     void load_wav(const char* filename);
     void clear_wav();
 
@@ -55,12 +55,12 @@ private:
     // 16-Bit Audio Output. Could be changed, requires some recoding.
     static const uint32_t BITS = 16;
 
-    // Low value  = Responsiveness, chance of drop out.
-    // High value = Laggy, less chance of drop out.
-    static const uint32_t SAMPLES  = 1024;
-
-    // Latency (in ms) and thus target buffer size
-    const static int SND_DELAY = 20;
+    // Buffer settings (see sound.buffer in config.xml).
+    // Low values  = Responsiveness, chance of drop out.
+    // High values = Laggy, less chance of drop out.
+    uint32_t samples;   // Samples per callback. Power of 2.
+    int frags;          // Number of callback sized fragments in the buffer
+    int snd_delay;      // Latency (in ms) and thus target buffer size
 
     // allowed "spread" between too many and too few samples in the buffer (ms)
     const static int SND_SPREAD = 7;
@@ -68,17 +68,41 @@ private:
     // Buffer used to mix PCM and YM channels together
     uint16_t* mix_buffer;
 
-    wav_t wavfile;
+    // Custom music, streamed from disk
+    WavStream wavstream;
+    int16_t* wav_buffer;
+
+    // Resampled output of the mix_buffer
+    int16_t* resample_buffer;
 
     // Estimated gap
     int gap_est;
 
-    // Cumulative audio difference
-    double avg_gap;
+    // Smoothed buffer fill (ms). Negative until first measured.
+    double fill_avg;
+
+    // Integral of the buffer fill error (ms * seconds)
+    double sync_integral;
+
+    // Output samples per input sample
+    double ratio;
+
+    // Position of the next output sample, in input samples.
+    // Negative positions interpolate from the last sample of the previous frame.
+    double resample_pos;
+    int16_t resample_last[CHANNELS];
+
+    // Ticks since the sync state was last logged
+    int log_ticks;
+
+    // Measured latency (ms)
+    int latency_count;
+    double latency_sum, latency_min, latency_max;
 
     void clear_buffers();
-    void pause_audio();
-    void resume_audio();
+    void update_sync();
+    void update_latency(const int64_t end);
+    int resample(const int16_t* src, const int src_samples, int16_t* dst);
 
     // SDL2 audio device
     SDL_AudioDeviceID dev;
@@ -15,7 +15,7 @@
 int CENTRE = 0x80;
 int DIGITAL_DEAD = 3000;
 
-Input input;
+ENGINE_LOCAL Input input;
 
 Input::Input(void)
 {
@@ -141,6 +141,10 @@ void Input::handle_key(const int key, const bool is_pressed)
             keys[TIMER] = is_pressed;
             break;
 
+        case SDLK_F4:
+            keys[TURBO] = is_pressed;
+            break;
+
         case SDLK_F5:
             keys[MENU] = is_pressed;
             break;
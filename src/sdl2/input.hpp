@@ -13,6 +13,7 @@
 #pragma once
 
 #include <SDL.h>
+#include "globals.hpp"
 
 extern int CENTRE;
 extern int DIGITAL_DEAD;
@@ -38,11 +39,12 @@ public:
         PAUSE = 11,
         STEP  = 12,
         TIMER = 13,
-        MENU = 14,     
+        MENU = 14,
+        TURBO = 15,     
     };
 
-    bool keys[15];
-    bool keys_old[15];
+    bool keys[16];
+    bool keys_old[16];
 
     // Has gamepad been found?
     bool gamepad;
@@ -99,6 +101,6 @@ private:
     void handle_joy(const uint8_t, const bool);
 };
 
-extern Input input;
+extern ENGINE_LOCAL Input input;
 
 #endif
@@ -11,6 +11,7 @@ class RenderBase
 {
 public:
     RenderBase();
+    virtual ~RenderBase() {}
 
     virtual bool init(int src_width, int src_height, 
                       int scale,
@@ -20,7 +21,7 @@ public:
     virtual bool start_frame()                = 0;
     virtual bool finalize_frame()             = 0;
     virtual void draw_frame(uint16_t* pixels) = 0;
-    void convert_palette(uint32_t adr, uint32_t r, uint32_t g, uint32_t b);
+    virtual void convert_palette(uint32_t adr, uint32_t r, uint32_t g, uint32_t b);
 
 protected:
 	SDL_Surface *surface;
@@ -1,24 +1,31 @@
 /***************************************************************************
     SDL2 Hardware Surface Video Rendering.  
     
-    Known Bugs:
-    - Scanlines don't work when Endian changed?
-
     Copyright Manuel Alfayate, Chris White.
     See license.txt for more details.
 ***************************************************************************/
 
 #include <iostream>
+#include <cstring>
+#include <algorithm>
+#include <boost/bind.hpp>
 
 #include "rendersurface.hpp"
 #include "frontend/config.hpp"
 
 RenderSurface::RenderSurface()
 {
+    window          = NULL;
+    renderer        = NULL;
+    texture         = NULL;
+    present_thread  = NULL;
+    running         = false;
+    palette_version = 0;
 }
 
 RenderSurface::~RenderSurface()
 {
+    disable();
 }
 
 bool RenderSurface::init(int src_width, int src_height, 
@@ -105,59 +112,110 @@ bool RenderSurface::init(int src_width, int src_height,
         SDL_ShowCursor(true);
     }
 
-    //int bpp = info->vfmt->BitsPerPixel;
-    const int bpp = 32;
+    // Scanlines are drawn at an integer scale, before the hardware scale
+    int post_scale = 1;
+
+    if (video_mode == video_settings_t::MODE_STRETCH)
+        this->scanlines = 0; // Disable scanlines in stretch mode
+    else if (this->scanlines)
+        post_scale = this->video_mode == video_settings_t::MODE_WINDOW ? scale :
+                     std::max(std::min(scn_width / src_width, scn_height / src_height), 1);
 
-    // Frees (Deletes) existing surface
-    if (surface)
-        SDL_FreeSurface(surface);
+    src_rect.w = src_width  * post_scale;
+    src_rect.h = src_height * post_scale;
 
-    surface = SDL_CreateRGBSurface(0,
-                                  src_width,
-                                  src_height,
-                                  bpp,
-                                  0,
-                                  0,
-                                  0,
-                                  0);
+    // The texture is written directly, so its format is used for the palette
+    Rshift = 16; Rmask = 0x00FF0000;
+    Gshift = 8;  Gmask = 0x0000FF00;
+    Bshift = 0;  Bmask = 0x000000FF;
 
-    if (!surface)
+    for (int i = 0; i < 3; i++)
     {
-        std::cerr << "Surface creation failed: " << SDL_GetError() << std::endl;
-        return false;
+        frames[i].pixels.resize(src_width * src_height);
+        frames[i].palette_version = palette_version - 1;
     }
+    back  = 0;
+    ready = 1;
+    front = 2;
+    fresh = false;
+
+    post.init(src_width, src_height, post_scale, this->scanlines, Rmask, Gmask, Bmask);
 
     SDL_SetHint(SDL_HINT_RENDER_SCALE_QUALITY, "linear"); 
     window = SDL_CreateWindow(
         "Cannonball", 0, 0, scn_width, scn_height, 
         flags);
 
-    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED|SDL_RENDERER_PRESENTVSYNC);
-    texture = SDL_CreateTexture(renderer,
-                               SDL_PIXELFORMAT_ARGB8888,
-                               SDL_TEXTUREACCESS_STREAMING,
-                               src_width, src_height);
+    if (!window)
+    {
+        std::cerr << "Window creation failed: " << SDL_GetError() << std::endl;
+        return false;
+    }
 
-    // Convert the SDL pixel surface to 32 bit.
-    // This is potentially a larger surface area than the internal pixel array.
-    screen_pixels = (uint32_t*)surface->pixels;
-    
-    // SDL Pixel Format Information
-    Rshift = surface->format->Rshift;
-    Gshift = surface->format->Gshift;
-    Bshift = surface->format->Bshift;
-    Rmask  = surface->format->Rmask;
-    Gmask  = surface->format->Gmask;
-    Bmask  = surface->format->Bmask;
+    // Present on the calling thread, unless the present thread is enabled (video.present_thread).
+    // SDL only documents rendering from the main thread, so this isn't supported on every backend.
+    if (!config.video.present_thread)
+        return create_renderer();
+
+    // The renderer is created on the thread that uses it
+    running = true;
+    status  = STATUS_STARTING;
+
+    try
+    {
+        present_thread = new boost::thread(boost::bind(&RenderSurface::present_main, this));
+    }
+    catch (boost::thread_resource_error&)
+    {
+        present_thread = NULL;
+        running        = false;
+        return create_renderer();
+    }
+
+    {
+        boost::mutex::scoped_lock lock(mtx);
+        while (status == STATUS_STARTING)
+            cond_present.wait(lock);
+    }
+
+    if (status == STATUS_FAILED)
+    {
+        // The backend couldn't create a renderer off the main thread. Present on the calling thread instead.
+        std::cerr << "Presenting on the main thread instead" << std::endl;
+        present_thread->join();
+        delete present_thread;
+        present_thread = NULL;
+        running        = false;
+        return create_renderer();
+    }
 
     return true;
 }
 
 void RenderSurface::disable()
 {
-    SDL_DestroyTexture(texture);
-    SDL_DestroyRenderer(renderer);
-    SDL_DestroyWindow(window);
+    if (present_thread)
+    {
+        {
+            boost::mutex::scoped_lock lock(mtx);
+            running = false;
+        }
+        cond_present.notify_one();
+
+        present_thread->join();
+        delete present_thread;
+        present_thread = NULL;
+    }
+    else
+    {
+        destroy_renderer();
+    }
+
+    if (window)
+    {
+        SDL_DestroyWindow(window);
+        window = NULL;
+    }
 }
 
 bool RenderSurface::start_frame()
@@ -167,21 +225,156 @@ bool RenderSurface::start_frame()
 
 bool RenderSurface::finalize_frame()
 {
-    // SDL2 block
-    SDL_UpdateTexture(texture, NULL, screen_pixels, src_width * sizeof (Uint32));
-    SDL_RenderClear(renderer);
-    SDL_RenderCopy(renderer, texture, &src_rect, &dst_rect);
-    SDL_RenderPresent(renderer);
-    //
+    // Hand the completed frame over, dropping any frame that hasn't been presented yet
+    {
+        boost::mutex::scoped_lock lock(mtx);
+        std::swap(back, ready);
+        fresh = true;
+    }
+
+    if (present_thread)
+    {
+        cond_present.notify_one();
+    }
+    else
+    {
+        std::swap(ready, front);
+        fresh = false;
+        present(&frames[front]);
+    }
 
     return true;
 }
 
 void RenderSurface::draw_frame(uint16_t* pixels)
 {
-    uint32_t* spix = screen_pixels;
+    frame_t* frame = &frames[back];
+
+    memcpy(&frame->pixels[0], pixels, src_width * src_height * sizeof(uint16_t));
+
+    // Only take a copy of the palette when it has changed
+    if (frame->palette_version != palette_version)
+    {
+        memcpy(frame->palette, rgb32, sizeof(rgb32));
+        frame->palette_version = palette_version;
+    }
+}
+
+// ------------------------------------------------------------------------------------------------
+// Present Thread
+// ------------------------------------------------------------------------------------------------
+
+void RenderSurface::present_main()
+{
+    const bool created = create_renderer();
+
+    {
+        boost::mutex::scoped_lock lock(mtx);
+        status = created ? STATUS_OK : STATUS_FAILED;
+    }
+    cond_present.notify_one();
+
+    if (!created)
+        return;
+
+    for (;;)
+    {
+        {
+            boost::mutex::scoped_lock lock(mtx);
+            while (!fresh && running)
+                cond_present.wait(lock);
+
+            if (!running)
+                break;
+
+            std::swap(ready, front);
+            fresh = false;
+        }
+
+        // Blocks on vsync, rather than the game thread
+        present(&frames[front]);
+    }
+
+    destroy_renderer();
+}
+
+bool RenderSurface::create_renderer()
+{
+    renderer = SDL_CreateRenderer(window, -1, SDL_RENDERER_ACCELERATED|SDL_RENDERER_PRESENTVSYNC);
+    if (!renderer)
+    {
+        std::cerr << "Renderer creation failed: " << SDL_GetError() << std::endl;
+        return false;
+    }
+
+    texture = SDL_CreateTexture(renderer,
+                               SDL_PIXELFORMAT_ARGB8888,
+                               SDL_TEXTUREACCESS_STREAMING,
+                               src_rect.w, src_rect.h);
+    if (!texture)
+    {
+        std::cerr << "Texture creation failed: " << SDL_GetError() << std::endl;
+        SDL_DestroyRenderer(renderer);
+        renderer = NULL;
+        return false;
+    }
+
+    return true;
+}
+
+void RenderSurface::destroy_renderer()
+{
+    if (texture)
+    {
+        SDL_DestroyTexture(texture);
+        texture = NULL;
+    }
+
+    if (renderer)
+    {
+        SDL_DestroyRenderer(renderer);
+        renderer = NULL;
+    }
+}
+
+void RenderSurface::present(const frame_t* frame)
+{
+    // Convert and scale straight into texture memory
+    void* tex_pixels;
+    int tex_pitch;
+
+    if (SDL_LockTexture(texture, NULL, &tex_pixels, &tex_pitch) == 0)
+    {
+        post.draw(&frame->pixels[0], frame->palette, (uint32_t*) tex_pixels, tex_pitch / sizeof(uint32_t));
+        SDL_UnlockTexture(texture);
+    }
+
+    SDL_RenderClear(renderer);
+    SDL_RenderCopy(renderer, texture, &src_rect, &dst_rect);
+    SDL_RenderPresent(renderer);
+}
+
+// See: SDL_PixelFormat
+#define CURRENT_RGB() (r << Rshift) | (g << Gshift) | (b << Bshift);
+
+void RenderSurface::convert_palette(uint32_t adr, uint32_t r, uint32_t g, uint32_t b)
+{
+    adr >>= 1;
+
+    r = r * 255 / 31;
+    g = g * 255 / 31;
+    b = b * 255 / 31;
+
+    rgb32[adr] = CURRENT_RGB();
+      
+    // Create shadow / highlight colours at end of RGB array
+    // The resultant values are the same as MAME
+    r = r * 202 / 256;
+    g = g * 202 / 256;
+    b = b * 202 / 256;
+        
+    rgb32[adr + S16_PALETTE_ENTRIES] =
+    rgb32[adr + (S16_PALETTE_ENTRIES * 2)] = CURRENT_RGB();
 
-    // Lookup real RGB value from rgb array for backbuffer
-    for (int i = 0; i < (src_width * src_height); i++)
-	*(spix++) = rgb[*(pixels++) & ((S16_PALETTE_ENTRIES * 3) - 1)];
+    palette_version++;
 }
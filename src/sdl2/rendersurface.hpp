@@ -1,10 +1,19 @@
 /***************************************************************************
     SDL2 Hardware Surface Video Rendering.  
     
-    Known Bugs:
-    - Software scanlines not implemented because we do hardware post-scaling
-      using the SDL_RenderCopy() rects from the original bitmap, so would not
-      look good at all because they would be ruined by magnifying.
+    Scanlines are drawn in software (see postprocess.hpp), at an integer
+    scale of the original bitmap. SDL_RenderCopy() scales the rest of the way,
+    so that the scanlines aren't ruined by magnifying.
+
+    Frames are converted straight into the locked texture, without an
+    intermediate surface.
+
+    With video.present_thread (or --present-thread), frames are presented
+    on a separate thread, so that waiting for vsync doesn't stall the game
+    thread. The game thread hands its frames over through a triple buffer.
+    This is off by default, as SDL only documents rendering from the main
+    thread. If the renderer can't be created on the present thread, frames
+    are presented on the calling thread instead.
 
     Copyright Manuel Alfayate and Chris White.
     See license.txt for more details.
@@ -12,7 +21,13 @@
 
 #pragma once
 
+#include <vector>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
 #include "renderbase.hpp"
+#include "postprocess.hpp"
 
 class RenderSurface : public RenderBase
 {
@@ -27,6 +42,7 @@ public:
     bool start_frame();
     bool finalize_frame();
     void draw_frame(uint16_t* pixels);
+    void convert_palette(uint32_t adr, uint32_t r, uint32_t g, uint32_t b);
 
 private:
     // SDL2 window
@@ -42,4 +58,40 @@ private:
     // ratio correction using SDL_RenderCopy()
     SDL_Rect src_rect;
     SDL_Rect dst_rect;
+
+    // 32bpp Palette Lookup. The base class palette is RGB565.
+    uint32_t rgb32[S16_PALETTE_ENTRIES * 3];
+
+    // Incremented when rgb32 changes
+    uint32_t palette_version;
+
+    // Integer scaling and scanlines, before the hardware scale
+    PostProcess post;
+
+    // Frame handed to the present thread
+    struct frame_t
+    {
+        std::vector<uint16_t> pixels;
+        uint32_t palette[S16_PALETTE_ENTRIES * 3];
+        uint32_t palette_version;
+    };
+
+    // Triple buffer. The game thread owns back, the present thread owns front.
+    // A frame in ready that hasn't been presented is replaced by the next one.
+    frame_t frames[3];
+    int back, ready, front;
+    bool fresh;
+
+    enum { STATUS_STARTING, STATUS_OK, STATUS_FAILED };
+
+    boost::thread* present_thread;
+    boost::mutex mtx;
+    boost::condition_variable cond_present;
+    bool running;
+    int status;
+
+    void present_main();
+    void present(const frame_t* frame);
+    bool create_renderer();
+    void destroy_renderer();
 };
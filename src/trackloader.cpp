@@ -30,7 +30,7 @@
 // 0x19 = Devils Canyon Variant
 // ------------------------------------------------------------------------------------------------
 
-static uint8_t STAGE_MAPPING_USA[] = 
+static ENGINE_LOCAL uint8_t STAGE_MAPPING_USA[] = 
 { 
     0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // Stage 1
     0x1E, 0x3B, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // Stage 2
@@ -39,7 +39,7 @@ static uint8_t STAGE_MAPPING_USA[] =
     0x32, 0x23, 0x38, 0x22, 0x26, 0x00, 0x00, 0x00,  // Stage 5
 };
 
-static uint8_t STAGE_MAPPING_JAP[] = 
+static ENGINE_LOCAL uint8_t STAGE_MAPPING_JAP[] = 
 { 
     0x3C, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // Stage 1
     0x20, 0x35, 0x00, 0x00, 0x00, 0x00, 0x00, 0x00,  // Stage 2
@@ -48,7 +48,7 @@ static uint8_t STAGE_MAPPING_JAP[] =
     0x32, 0x23, 0x38, 0x22, 0x26, 0x00, 0x00, 0x00,  // Stage 5
 };
 
-TrackLoader trackloader;
+ENGINE_LOCAL TrackLoader trackloader;
 
 TrackLoader::TrackLoader()
 {
@@ -56,7 +56,9 @@ TrackLoader::TrackLoader()
     levels        = new Level[STAGES];
     levels_end    = new Level[5];
     level_split   = new Level();
+    paths         = new TrackPath[STAGES + 2];
     current_level = &levels[0];
+    current_path  = &paths[0];
 
     mode       = MODE_ORIGINAL;
 }
@@ -69,6 +71,7 @@ TrackLoader::~TrackLoader()
     delete[] levels_end;
     delete[] levels;
     delete level_split;
+    delete[] paths;
 }
 
 void TrackLoader::init(bool jap)
@@ -94,6 +97,20 @@ bool TrackLoader::set_layout_track(const char* filename)
     return true;
 }
 
+// Use the LayOut track already loaded by another instance.
+// The binary data itself is shared, not copied.
+void TrackLoader::share_layout_track(const TrackLoader* src)
+{
+    if (src->layout == NULL)
+        return;
+
+    if (layout != NULL)
+        delete layout;
+
+    layout = new RomLoader(*src->layout);
+    mode   = src->mode;
+}
+
 void TrackLoader::init_original_tracks(bool jap)
 {
     stage_data = jap ? STAGE_MAPPING_JAP : STAGE_MAPPING_USA;
@@ -139,7 +156,8 @@ void TrackLoader::init_original_tracks(bool jap)
 
         // CPU 1 Data
         const uint32_t PATH_ADR = roms.rom1p->read32(ROAD_DATA_LOOKUP + STAGE_OFFSET);
-        levels[i].path = &roms.rom1p->rom[PATH_ADR];        
+        compile_path(&paths[i], roms.rom1p, PATH_ADR);
+        levels[i].path = &paths[i];
     }
 
     // --------------------------------------------------------------------------------------------
@@ -148,13 +166,15 @@ void TrackLoader::init_original_tracks(bool jap)
 
     // Split stages don't contain palette information
     setup_section(level_split, roms.rom0p, outrun.adr.road_seg_split);
-    level_split->path         = &roms.rom1p->rom[ROAD_DATA_SPLIT];
+    compile_path(&paths[STAGES], roms.rom1p, ROAD_DATA_SPLIT);
+    level_split->path = &paths[STAGES];
 
+    compile_path(&paths[STAGES + 1], roms.rom1p, ROAD_DATA_BONUS);
     for (int i = 0; i < 5; i++)
     {
         const uint32_t STAGE_ADR = roms.rom0p->read32(outrun.adr.road_seg_end + (i << 2));
         setup_section(&levels_end[i], roms.rom0p, STAGE_ADR);
-        levels_end[i].path  = &roms.rom1p->rom[ROAD_DATA_BONUS];
+        levels_end[i].path = &paths[STAGES + 1];
     }
 }
 
@@ -165,7 +185,7 @@ void TrackLoader::init_layout_tracks(bool jap)
     // --------------------------------------------------------------------------------------------
     // Check Version is Correct
     // --------------------------------------------------------------------------------------------
-    if (layout->read32(LayOut::HEADER) != LayOut::EXPECTED_VERSION)
+    if (layout->length < LayOut::HEIGHT_MAPS + sizeof(uint32_t) || layout->read32(LayOut::HEADER) != LayOut::EXPECTED_VERSION)
     {
         std::cout << "Incompatible LayOut Version Detected. Try upgrading CannonBall to the latest version" << std::endl;
         init_original_tracks(jap);
@@ -196,15 +216,19 @@ void TrackLoader::init_layout_tracks(bool jap)
     // --------------------------------------------------------------------------------------------
     // Iterate and setup 15 stages
     // --------------------------------------------------------------------------------------------
+    // The track data is validated as it is compiled.
+    bool valid = true;
+
     for (int i = 0; i < STAGES; i++)
     {
         // CPU 0 Data
         const uint32_t STAGE_ADR = layout->read32(LayOut::LEVELS + (i * sizeof(uint32_t)));
-        setup_level(&levels[i], layout, STAGE_ADR);
+        valid &= setup_level(&levels[i], layout, STAGE_ADR);
 
         // CPU 1 Data
         const uint32_t PATH_ADR = layout->read32(LayOut::PATH);
-        levels[i].path = &layout->rom[ PATH_ADR + ((ROAD_END_CPU1 * sizeof(uint32_t)) * i) ];
+        valid &= compile_path(&paths[i], layout, PATH_ADR + ((ROAD_END_CPU1 * sizeof(uint32_t)) * i));
+        levels[i].path = &paths[i];
     }
 
     // --------------------------------------------------------------------------------------------
@@ -212,22 +236,42 @@ void TrackLoader::init_layout_tracks(bool jap)
     // --------------------------------------------------------------------------------------------
 
     // Split stages don't contain palette information
-    setup_section(level_split, layout, layout->read32(LayOut::SPLIT_LEVEL));
-    level_split->path = &layout->rom[ layout->read32(LayOut::SPLIT_PATH) ];
+    valid &= setup_section(level_split, layout, layout->read32(LayOut::SPLIT_LEVEL));
+    valid &= compile_path(&paths[STAGES], layout, layout->read32(LayOut::SPLIT_PATH));
+    level_split->path = &paths[STAGES];
 
     // End sections don't contain palette information. Shared path.
-    uint8_t* end_path = &layout->rom[ layout->read32(LayOut::END_PATH) ];
+    valid &= compile_path(&paths[STAGES + 1], layout, layout->read32(LayOut::END_PATH));
     for (int i = 0; i < 5; i++)
     {
         const uint32_t STAGE_ADR = layout->read32(LayOut::END_LEVELS + (i * sizeof(uint32_t)));
-        setup_section(&levels_end[i], layout, STAGE_ADR);
-        levels_end[i].path = end_path;
+        valid &= setup_section(&levels_end[i], layout, STAGE_ADR);
+        levels_end[i].path = &paths[STAGES + 1];
+    }
+
+    if (!valid)
+    {
+        std::cout << "Corrupt LayOut Track Detected. Reverting to original tracks" << std::endl;
+        init_original_tracks(jap);
     }
 }
 
 // Setup a normal level
-void TrackLoader::setup_level(Level* l, RomLoader* data, const int STAGE_ADR)
+bool TrackLoader::setup_level(Level* l, RomLoader* data, const uint32_t STAGE_ADR)
 {
+    if (STAGE_ADR + 36 > data->length)
+        return false;
+
+    // Palette entries are two longs
+    for (int i = 4; i <= 16; i += 4)
+    {
+        if (data->read32(STAGE_ADR + i) + 8 > data->length)
+            return false;
+    }
+
+    if (data->read32(STAGE_ADR + 0) + 2 > data->length || data->read32(STAGE_ADR + 20) + 2 > data->length)
+        return false;
+
     // Sky Palette
     uint32_t adr = data->read32(STAGE_ADR + 0);
     l->pal_sky   = data->read16(adr);
@@ -253,34 +297,112 @@ void TrackLoader::setup_level(Level* l, RomLoader* data, const int STAGE_ADR)
     adr = data->read32(STAGE_ADR + 20);
     l->pal_gnd = data->read16(adr);
 
-    // Curve Data
-    curve_offset = data->read32(STAGE_ADR + 24);
-    l->curve = &data->rom[curve_offset];
-
-    // Width / Height Lookup
-    wh_offset = data->read32(STAGE_ADR + 28);
-    l->width_height = &data->rom[wh_offset];
-
-    // Sprite Information
-    scenery_offset = data->read32(STAGE_ADR + 32);
-    l->scenery = &data->rom[scenery_offset];
+    // Curve Data, Width / Height Lookup, Sprite Information
+    return compile_track(l, data, data->read32(STAGE_ADR + 24), data->read32(STAGE_ADR + 28), data->read32(STAGE_ADR + 32));
 }
 
 // Setup a special section of track (end section or level split)
 // Special sections do not contain palette information
-void TrackLoader::setup_section(Level* l, RomLoader* data, const int STAGE_ADR)
+bool TrackLoader::setup_section(Level* l, RomLoader* data, const uint32_t STAGE_ADR)
+{
+    if (STAGE_ADR + 12 > data->length)
+        return false;
+
+    // Curve Data, Width / Height Lookup, Sprite Information
+    return compile_track(l, data, data->read32(STAGE_ADR + 0), data->read32(STAGE_ADR + 4), data->read32(STAGE_ADR + 8));
+}
+
+// Compile CPU 1 Road Path.
+// Entries beyond the end of the data are zero.
+bool TrackLoader::compile_path(TrackPath* p, RomLoader* data, const uint32_t adr)
+{
+    p->x.assign(PATH_ENTRIES, 0);
+    p->y.assign(PATH_ENTRIES, 0);
+
+    if (adr >= data->length)
+        return false;
+
+    uint32_t a = adr;
+    for (uint32_t i = 0; i < PATH_ENTRIES && a + 4 <= data->length; i++, a += 4)
+    {
+        p->x[i] = (int16_t) data->read16(a);
+        p->y[i] = (int16_t) data->read16(a + 2);
+    }
+
+    return true;
+}
+
+// Compile CPU 0 Track Data.
+//
+// The game reads each table sequentially, and never advances past a segment
+// beyond the end of the road. So each table is compiled up to, and including,
+// that segment. A terminating entry is then added.
+bool TrackLoader::compile_track(Level* l, RomLoader* data, uint32_t curve_adr, uint32_t wh_adr, uint32_t scenery_adr)
 {
-    // Curve Data
-    curve_offset = data->read32(STAGE_ADR + 0);
-    l->curve = &data->rom[curve_offset];
+    if (curve_adr >= data->length || wh_adr >= data->length || scenery_adr >= data->length)
+        return false;
+
+    // Curve Data: 6 byte records. Terminated by -1.
+    l->curve_pos.clear();
+    l->curve.clear();
+    l->curve_type.clear();
+
+    for (uint32_t i = 0; i < MAX_RECORDS && curve_adr + 6 <= data->length; i++)
+    {
+        const int16_t pos = data->read16(&curve_adr);
+        l->curve_pos.push_back(pos);
+        l->curve.push_back(data->read16(&curve_adr));
+        l->curve_type.push_back(data->read16(&curve_adr));
 
-    // Width / Height Lookup
-    wh_offset = data->read32(STAGE_ADR + 4);
-    l->width_height = &data->rom[wh_offset];
+        if (pos == -1 || pos > ROAD_END_CPU1)
+            break;
+    }
+    l->curve_pos.push_back(-1);
+    l->curve.push_back(0);
+    l->curve_type.push_back(0);
+
+    // Width / Height Lookup: 8 byte records
+    l->wh_pos.clear();
+    l->wh_mode.clear();
+    l->wh_value.clear();
+    l->wh_change.clear();
+
+    for (uint32_t i = 0; i < MAX_RECORDS && wh_adr + 8 <= data->length; i++)
+    {
+        const uint16_t pos = data->read16(&wh_adr);
+        l->wh_pos.push_back(pos);
+        l->wh_mode.push_back(data->read16(&wh_adr));
+        l->wh_value.push_back(data->read16(&wh_adr));
+        l->wh_change.push_back(data->read16(&wh_adr));
+
+        if (pos > ROAD_END_CPU1)
+            break;
+    }
+    l->wh_pos.push_back(0xFFFF);
+    l->wh_mode.push_back(0);
+    l->wh_value.push_back(0);
+    l->wh_change.push_back(0);
 
-    // Sprite Information
-    scenery_offset = data->read32(STAGE_ADR + 8);
-    l->scenery = &data->rom[scenery_offset];
+    // Sprite Information: 4 byte records
+    l->scenery_pos.clear();
+    l->scenery_total.clear();
+    l->scenery_pattern.clear();
+
+    for (uint32_t i = 0; i < MAX_RECORDS && scenery_adr + 4 <= data->length; i++)
+    {
+        const uint16_t pos = data->read16(&scenery_adr);
+        l->scenery_pos.push_back(pos);
+        l->scenery_total.push_back(data->read8(&scenery_adr));
+        l->scenery_pattern.push_back(data->read8(&scenery_adr));
+
+        if (pos > ROAD_END_CPU1)
+            break;
+    }
+    l->scenery_pos.push_back(0xFFFF);
+    l->scenery_total.push_back(0);
+    l->scenery_pattern.push_back(0);
+
+    return true;
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -289,9 +411,9 @@ void TrackLoader::setup_section(Level* l, RomLoader* data, const int STAGE_ADR)
 
 void TrackLoader::init_track(const uint32_t offset)
 {
-    curve_offset   = 0;
-    wh_offset      = 0;
-    scenery_offset = 0;
+    curve_index    = 0;
+    wh_index       = 0;
+    scenery_index  = 0;
     current_level  = &levels[stage_offset_to_level(offset)];
 }
 
@@ -304,17 +426,17 @@ int8_t TrackLoader::stage_offset_to_level(uint32_t id)
 
 void TrackLoader::init_track_split()
 {
-    curve_offset   = 0;
-    wh_offset      = 0;
-    scenery_offset = 0;
+    curve_index    = 0;
+    wh_index       = 0;
+    scenery_index  = 0;
     current_level  = level_split;
 }
 
 void TrackLoader::init_track_bonus(const uint32_t id)
 {
-    curve_offset   = 0;
-    wh_offset      = 0;
-    scenery_offset = 0;
+    curve_index    = 0;
+    wh_index       = 0;
+    scenery_index  = 0;
     current_level  = &levels_end[id];
 }
 
@@ -341,45 +463,6 @@ void TrackLoader::init_path_end()
 //                                        HELPER FUNCTIONS TO READ DATA
 // ------------------------------------------------------------------------------------------------
 
-int16_t TrackLoader::readPath(uint32_t addr)
-{
-    return (current_path[addr] << 8) | current_path[addr+1];
-}
-
-int16_t TrackLoader::readPath(uint32_t* addr)
-{
-    int16_t value = (current_path[*addr] << 8) | (current_path[*addr+1]);
-    *addr += 2;
-    return value;
-}
-
-int16_t TrackLoader::read_width_height(uint32_t* addr)
-{
-    int16_t value = (current_level->width_height[*addr + wh_offset] << 8) | (current_level->width_height[*addr+1 + wh_offset]);
-    *addr += 2;
-    return value;
-}
-
-int16_t TrackLoader::read_curve(uint32_t addr)
-{
-    return (current_level->curve[addr + curve_offset] << 8) | current_level->curve[addr+1 + curve_offset];
-}
-
-uint16_t TrackLoader::read_scenery_pos()
-{
-    return (current_level->scenery[scenery_offset] << 8) | current_level->scenery[scenery_offset + 1];
-}
-
-uint8_t TrackLoader::read_total_sprites()
-{
-    return current_level->scenery[scenery_offset + 2];
-}
-
-uint8_t TrackLoader::read_sprite_pattern_index()
-{
-    return current_level->scenery[scenery_offset + 3];
-}
-
 Level* TrackLoader::get_level(uint32_t id)
 {
     return &levels[stage_offset_to_level(id)];
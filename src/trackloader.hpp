@@ -14,6 +14,7 @@
 
 #pragma once
 
+#include <vector>
 #include "globals.hpp"
 
 // Road Generator Palette Representation
@@ -25,13 +26,38 @@ struct RoadPalette
     uint32_t road;            // Main Road Colour
 };
 
+// Road Path, compiled to native endian.
+// One entry per road position, representing the x,y change.
+struct TrackPath
+{
+    std::vector<int16_t> x;
+    std::vector<int16_t> y;
+};
+
 // OutRun Level Representation
+//
+// Track data is compiled from the big endian ROM (or LayOut) format when the
+// tracks are initialized. Each table is a structure of arrays, with one entry
+// per record in the original data, followed by a terminating entry.
 struct Level
 {
-    uint8_t* path;            // CPU 1 Path Data
-    uint8_t* curve;           // Track Curve Information (Derived From Path)
-    uint8_t* width_height;    // Track Width & Height Lookups
-    uint8_t* scenery;         // Track Scenery Lookups
+    TrackPath* path;                        // CPU 1 Path Data
+
+    // Track Curve Information (Derived From Path)
+    std::vector<int16_t>  curve_pos;        // Segment Position (-1 = End)
+    std::vector<int16_t>  curve;            // Segment Road Curve
+    std::vector<int16_t>  curve_type;       // Segment Road Type (1 = Straight, 2 = Right Bend, 3 = Left Bend)
+
+    // Track Width & Height Lookups
+    std::vector<uint16_t> wh_pos;           // Segment Position
+    std::vector<int16_t>  wh_mode;          // 0 = Road Height Change. Otherwise Road Width Change.
+    std::vector<int16_t>  wh_value;         // Segment Road Width / Segment Road Height Index
+    std::vector<int16_t>  wh_change;        // Segment Width Adjustment Speed
+
+    // Track Scenery Lookups
+    std::vector<uint16_t> scenery_pos;      // Segment Position
+    std::vector<uint8_t>  scenery_total;    // Number of Sprites In Segment
+    std::vector<uint8_t>  scenery_pattern;  // Block Of Sprites
 
     uint16_t pal_sky;         // Index into Sky Palettes
     uint16_t pal_gnd;         // Index into Ground Palettes
@@ -75,9 +101,10 @@ public:
     // Display start line on Stage 1
     uint8_t display_start_line;
 
-    uint32_t curve_offset;
-    uint32_t wh_offset;
-    uint32_t scenery_offset;
+    // Current entry in the compiled track data
+    uint32_t curve_index;
+    uint32_t wh_index;
+    uint32_t scenery_index;
 
     // Shared Structures
     uint8_t* pal_sky_data;
@@ -95,6 +122,7 @@ public:
 
     void init(bool jap);
     bool set_layout_track(const char* filename);
+    void share_layout_track(const TrackLoader* src);
     void init_original_tracks(bool jap);
     void init_layout_tracks(bool jap);
     void init_track(const uint32_t);
@@ -110,13 +138,21 @@ public:
     uint32_t read_heightmap_table(uint16_t entry);
     uint32_t read_scenerymap_table(uint16_t entry);
 
-    int16_t readPath(uint32_t addr);
-    int16_t readPath(uint32_t* addr);
-    int16_t read_width_height(uint32_t* addr);
-    int16_t read_curve(uint32_t addr);
-    uint16_t read_scenery_pos();
-    uint8_t read_total_sprites();
-    uint8_t read_sprite_pattern_index();
+    // CPU 1 Road Path (by road position)
+    inline int16_t read_path_x(uint32_t pos)        { return current_path->x[pos]; }
+    inline int16_t read_path_y(uint32_t pos)        { return current_path->y[pos]; }
+
+    // CPU 0 Track Data (current entry)
+    inline int16_t read_curve_pos()                 { return current_level->curve_pos[curve_index]; }
+    inline int16_t read_curve()                     { return current_level->curve[curve_index]; }
+    inline int16_t read_curve_type()                { return current_level->curve_type[curve_index]; }
+    inline uint16_t read_wh_pos()                   { return current_level->wh_pos[wh_index]; }
+    inline int16_t read_wh_mode()                   { return current_level->wh_mode[wh_index]; }
+    inline int16_t read_wh_value()                  { return current_level->wh_value[wh_index]; }
+    inline int16_t read_wh_change()                 { return current_level->wh_change[wh_index]; }
+    inline uint16_t read_scenery_pos()              { return current_level->scenery_pos[scenery_index]; }
+    inline uint8_t read_total_sprites()             { return current_level->scenery_total[scenery_index]; }
+    inline uint8_t read_sprite_pattern_index()      { return current_level->scenery_pattern[scenery_index]; }
 
     int8_t stage_offset_to_level(uint32_t);
     Level* get_level(uint32_t);
@@ -165,10 +201,19 @@ private:
     Level* level_split;    // Split Section
     Level* levels_end;     // End Section
 
-    uint8_t* current_path; // CPU 1 Road Path
+    TrackPath* paths;      // Compiled Paths: Normal Stages, Split Section, End Section
+    TrackPath* current_path; // CPU 1 Road Path
+
+    // Path entries to compile. Includes the look ahead used to generate the road.
+    const static uint32_t PATH_ENTRIES = ROAD_END_CPU1 + 0x100;
+
+    // Limit on records compiled per table, should a terminator not be found
+    const static uint32_t MAX_RECORDS  = 0x400;
     
-    void setup_level(Level* l, RomLoader* data, const int STAGE_ADR);
-    void setup_section(Level* l, RomLoader* data, const int STAGE_ADR);
+    bool setup_level(Level* l, RomLoader* data, const uint32_t STAGE_ADR);
+    bool setup_section(Level* l, RomLoader* data, const uint32_t STAGE_ADR);
+    bool compile_path(TrackPath* p, RomLoader* data, const uint32_t adr);
+    bool compile_track(Level* l, RomLoader* data, uint32_t curve_adr, uint32_t wh_adr, uint32_t scenery_adr);
 };
 
-extern TrackLoader trackloader;
\ No newline at end of file
+extern ENGINE_LOCAL TrackLoader trackloader;
\ No newline at end of file
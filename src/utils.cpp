@@ -8,6 +8,35 @@
 #include <sstream>
 #include "utils.hpp"
 
+// ------------------------------------------------------------------------------------------------
+// CRC32 (Slicing-by-8)
+//
+// Eight lookup tables allow eight bytes to be processed per iteration.
+// Tables are generated at static initialization, before any threads are started.
+// ------------------------------------------------------------------------------------------------
+
+static uint32_t crc_table[8][256];
+
+static struct CrcTableInit
+{
+    CrcTableInit()
+    {
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++)
+                c = (c & 1) ? 0xEDB88320 ^ (c >> 1) : (c >> 1);
+            crc_table[0][i] = c;
+        }
+
+        for (uint32_t i = 0; i < 256; i++)
+        {
+            for (int t = 1; t < 8; t++)
+                crc_table[t][i] = (crc_table[t - 1][i] >> 8) ^ crc_table[0][crc_table[t - 1][i] & 0xFF];
+        }
+    }
+} crc_table_init;
+
 // Convert value to string
 std::string Utils::to_string(int i)
 {
@@ -42,4 +71,29 @@ uint32_t Utils::from_hex_string(std::string s)
     ss >> x;
     // output it as a signed type
     return static_cast<unsigned int>(x);
-}
\ No newline at end of file
+}
+// Calculate CRC32 of a block of data.
+// Pass the result of a previous call as crc, to continue a checksum over several blocks.
+uint32_t Utils::crc32(const uint8_t* data, size_t length, uint32_t crc)
+{
+    crc = ~crc;
+
+    while (length >= 8)
+    {
+        const uint32_t one = crc ^ (data[0] | (data[1] << 8) | (data[2] << 16) | ((uint32_t) data[3] << 24));
+        const uint32_t two = data[4] | (data[5] << 8) | (data[6] << 16) | ((uint32_t) data[7] << 24);
+
+        crc = crc_table[7][one & 0xFF]         ^ crc_table[6][(one >> 8) & 0xFF] ^
+              crc_table[5][(one >> 16) & 0xFF] ^ crc_table[4][one >> 24]         ^
+              crc_table[3][two & 0xFF]         ^ crc_table[2][(two >> 8) & 0xFF] ^
+              crc_table[1][(two >> 16) & 0xFF] ^ crc_table[0][two >> 24];
+
+        data   += 8;
+        length -= 8;
+    }
+
+    while (length--)
+        crc = (crc >> 8) ^ crc_table[0][(crc ^ *data++) & 0xFF];
+
+    return ~crc;
+}
@@ -8,6 +8,7 @@
 #pragma once
 
 #include <string>
+#include <cstddef>
 #include "stdint.hpp"
 
 class Utils
@@ -17,6 +18,7 @@ public:
     static std::string to_string(char c);
     static std::string to_hex_string(int i);
     static uint32_t from_hex_string(std::string s);
+    static uint32_t crc32(const uint8_t* data, size_t length, uint32_t crc = 0);
 
 private:
 };
\ No newline at end of file
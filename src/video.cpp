@@ -15,6 +15,7 @@
 #include "setup.hpp"
 #include "globals.hpp"
 #include "frontend/config.hpp"
+#include "hwvideo/gfxcache.hpp"
 
 #ifdef WITH_OPENGL
 
@@ -38,28 +39,18 @@
 #include "sdl/rendersw.hpp"
 #endif //SDL2
 
-Video video;
+ENGINE_LOCAL Video video;
 
 Video::Video(void)
 {
-    #ifdef WITH_OPENGL
-    renderer     = new RenderGL();
-    
-    #elif defined SDL2
-
-    #ifdef WITH_OPENGLES
-    renderer	 = new RenderGLES();
-    #else
-    renderer     = new RenderSurface();
-    #endif
-
-    #else
-    renderer     = new RenderSW();
-    #endif
-
+    renderer     = NULL;
     pixels       = NULL;
+    enabled      = false;
     sprite_layer = new hwsprites();
     tile_layer   = new hwtiles();
+
+    for (uint32_t i = 0; i < S16_PALETTE_ENTRIES; i++)
+        refresh_shadow(i);
 }
 
 Video::~Video(void)
@@ -67,8 +58,11 @@ Video::~Video(void)
     delete sprite_layer;
     delete tile_layer;
     if (pixels) delete[] pixels;
-    renderer->disable();
-    delete renderer;
+    if (renderer)
+    {
+        renderer->disable();
+        delete renderer;
+    }
 }
 
 int Video::init(Roms* roms, video_settings_t* settings)
@@ -76,44 +70,71 @@ int Video::init(Roms* roms, video_settings_t* settings)
     if (!set_video_mode(settings))
         return 0;
 
+    init_layers(roms, settings);
+    return 1;
+}
+
+// Initialize the video hardware emulation without an output window.
+// Used by engine instances that do not need to present anything to screen.
+int Video::init_headless(Roms* roms, video_settings_t* settings)
+{
+    set_dimensions(settings);
+    init_layers(roms, settings);
+    return 1;
+}
+
+void Video::init_layers(Roms* roms, video_settings_t* settings)
+{
     // Internal pixel array. The size of this is always constant
     if (pixels) delete[] pixels;
     pixels = new uint16_t[config.s16_width * config.s16_height];
 
-    // Convert S16 tiles to a more useable format
-    tile_layer->init(roms->tiles.rom, config.video.hires != 0);
+    // The converted graphics are shared, so the source roms are only needed once.
+    // Each is freed as soon as it has been converted, to keep the peak memory use down.
+    // Use the cached copy if possible, and skip the conversion entirely.
+    const bool decode = roms->tiles.rom != NULL && !gfxcache.map(roms);
+
+    if (!decode)
+    {
+        free_rom(&roms->tiles);
+        free_rom(&roms->sprites);
+        free_rom(&roms->road);
+    }
+
+    // Convert S16 tiles to a more useable format.
+    tile_layer->init(roms->tiles.rom);
+    free_rom(&roms->tiles);
     
     clear_tile_ram();
     clear_text_ram();
-    if (roms->tiles.rom)
-    {
-        delete[] roms->tiles.rom;
-        roms->tiles.rom = NULL;
-    }
 
     // Convert S16 sprites
     sprite_layer->init(roms->sprites.rom);
-    if (roms->sprites.rom)
-    {
-        delete[] roms->sprites.rom;
-        roms->sprites.rom = NULL;
-    }
+    free_rom(&roms->sprites);
 
     // Convert S16 Road Stuff
-    hwroad.init(roms->road.rom, config.video.hires != 0);
-    if (roms->road.rom)
-    {
-        delete[] roms->road.rom;
-        roms->road.rom = NULL;
-    }
+    hwroad.init(roms->road.rom);
+    free_rom(&roms->road);
+
+    if (decode)
+        gfxcache.save(roms);
 
     enabled = true;
-    return 1;
+}
+
+void Video::free_rom(RomLoader* rom)
+{
+    if (rom->rom)
+    {
+        delete[] rom->rom;
+        rom->rom = NULL;
+    }
 }
 
 void Video::disable()
 {
-    renderer->disable();
+    if (renderer)
+        renderer->disable();
 }
 
 // ------------------------------------------------------------------------------------------------
@@ -121,6 +142,24 @@ void Video::disable()
 // ------------------------------------------------------------------------------------------------
 
 int Video::set_video_mode(video_settings_t* settings)
+{
+    set_dimensions(settings);
+
+    if (settings->scanlines < 0) settings->scanlines = 0;
+    else if (settings->scanlines > 100) settings->scanlines = 100;
+
+    if (settings->scale < 1)
+        settings->scale = 1;
+
+    if (renderer == NULL)
+        renderer = create_renderer();
+
+    renderer->init(config.s16_width, config.s16_height, settings->scale, settings->mode, settings->scanlines);
+
+    return 1;
+}
+
+void Video::set_dimensions(video_settings_t* settings)
 {
     if (settings->widescreen)
     {
@@ -142,23 +181,53 @@ int Video::set_video_mode(video_settings_t* settings)
         config.s16_height <<= 1;
     }
 
-    if (settings->scanlines < 0) settings->scanlines = 0;
-    else if (settings->scanlines > 100) settings->scanlines = 100;
+    // Select the renderers, which are specialised for each screen size
+    const bool hires      = settings->hires != 0;
+    const bool widescreen = settings->widescreen != 0;
+    tile_layer->set_mode(hires, widescreen);
+    sprite_layer->set_mode(hires, widescreen);
+    hwroad.set_mode(hires, widescreen);
+}
 
-    if (settings->scale < 1)
-        settings->scale = 1;
+RenderBase* Video::create_renderer()
+{
+    #ifdef WITH_OPENGL
+    return new RenderGL();
+    
+    #elif defined SDL2
 
-    renderer->init(config.s16_width, config.s16_height, settings->scale, settings->mode, settings->scanlines);
+    #ifdef WITH_OPENGLES
+    return new RenderGLES();
+    #else
+    return new RenderSurface();
+    #endif
 
-    return 1;
+    #else
+    return new RenderSW();
+    #endif
 }
 
 void Video::draw_frame()
 {
+    // Headless: Emulate the video hardware, but there is nothing to present
+    if (renderer == NULL)
+    {
+        render_layers();
+        return;
+    }
+
     // Renderer Specific Frame Setup
     if (!renderer->start_frame())
         return;
 
+    render_layers();
+
+    renderer->draw_frame(pixels);
+    renderer->finalize_frame();
+}
+
+void Video::render_layers()
+{
     if (!enabled)
     {
         // Fill with black pixels
@@ -177,9 +246,6 @@ void Video::draw_frame()
         sprite_layer->render(8);
         tile_layer->render_text_layer(pixels, 1);
      }
-
-    renderer->draw_frame(pixels);
-    renderer->finalize_frame();
 }
 
 // ---------------------------------------------------------------------------
@@ -384,5 +450,17 @@ void Video::refresh_palette(uint32_t palAddr)
     if ((a & 0x4000) != 0)
         b |= 1; // b bbbb
 
-    renderer->convert_palette(palAddr, r, g, b);
+    if (renderer)
+        renderer->convert_palette(palAddr, r, g, b);
+
+    refresh_shadow(palAddr);
+    refresh_shadow(palAddr + 1);
+}
+
+// Sprite shadows move a pixel into the shadow or highlight bank, depending on bit 15 of the
+// palette word read with the pixel value as its byte address (as per read_pal16).
+void Video::refresh_shadow(uint32_t palAddr)
+{
+    if (palAddr < S16_PALETTE_ENTRIES)
+        shadow_map[palAddr] = palAddr + ((S16_PALETTE_ENTRIES * 2) - ((palette[palAddr] & 0x80) << 5));
 }
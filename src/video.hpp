@@ -30,15 +30,21 @@ public:
     hwtiles* tile_layer;
 	uint16_t *pixels;
 
+    // Shadowed value of each pixel value (palette index), for sprite shadows.
+    // Kept up to date as the palette is written.
+    uint16_t shadow_map[S16_PALETTE_ENTRIES];
+
     bool enabled;
 
 	Video();
     ~Video();
     
 	int init(Roms* roms, video_settings_t* settings);
+    int init_headless(Roms* roms, video_settings_t* settings);
     void disable();
     int set_video_mode(video_settings_t* settings);
     void draw_frame();
+    void render_layers();
 
     void clear_text_ram();
     void write_text8(uint32_t, const uint8_t);
@@ -68,11 +74,16 @@ public:
     uint32_t read_pal32(uint32_t*);
 
 private:
-    // SDL Renderer
+    // SDL Renderer. NULL when running headless.
     RenderBase* renderer;
     
 	uint8_t palette[S16_PALETTE_ENTRIES * 2]; // 2 Bytes Per Palette Entry
+    RenderBase* create_renderer();
+    void set_dimensions(video_settings_t* settings);
+    void init_layers(Roms* roms, video_settings_t* settings);
+    void free_rom(RomLoader* rom);
     void refresh_palette(uint32_t);
+    void refresh_shadow(uint32_t);
 };
 
-extern Video video;
\ No newline at end of file
+extern ENGINE_LOCAL Video video;
\ No newline at end of file
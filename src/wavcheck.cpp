@@ -0,0 +1,187 @@
+/***************************************************************************
+    Streaming WAV Reader Check.
+
+    Decodes generated WAV files through WavStream, and checks the length of
+    the output. Each file holds a single click on a constant level, so the
+    distance between clicks in the looped output is the length of one pass
+    of the file at the output rate.
+
+    Low rate files are included, as they produce the most output per chunk.
+
+    Build with: make wavcheck
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <iostream>
+#include <fstream>
+#include <vector>
+#include <cstdio>
+#include <cstdlib>
+#include <boost/thread/thread.hpp>
+
+#include "wavstream.hpp"
+
+static const uint32_t OUT_FREQ = 44100;
+
+// Passes of the file to check
+static const int LOOPS = 4;
+
+static const int16_t LEVEL = 1000;
+static const int16_t CLICK = 20000;
+
+static void write_le(std::ofstream& out, const uint32_t value, const int bytes)
+{
+    for (int i = 0; i < bytes; i++)
+        out.put((char) ((value >> (i * 8)) & 0xFF));
+}
+
+static bool write_wav(const char* filename, const uint32_t freq, const int channels, const int frames)
+{
+    std::ofstream out(filename, std::ios::out | std::ios::binary | std::ios::trunc);
+    if (!out)
+        return false;
+
+    const uint32_t data_bytes = frames * channels * 2;
+
+    out.write("RIFF", 4);
+    write_le(out, 36 + data_bytes, 4);
+    out.write("WAVEfmt ", 8);
+    write_le(out, 16, 4);
+    write_le(out, 1, 2);                            // PCM
+    write_le(out, channels, 2);
+    write_le(out, freq, 4);
+    write_le(out, freq * channels * 2, 4);
+    write_le(out, channels * 2, 2);
+    write_le(out, 16, 2);
+    out.write("data", 4);
+    write_le(out, data_bytes, 4);
+
+    // Click on the first frame. The right channel is inverted, to check the channels aren't swapped.
+    for (int f = 0; f < frames; f++)
+    {
+        const int16_t v = f == 0 ? CLICK : LEVEL;
+        write_le(out, (uint16_t) v, 2);
+        if (channels == 2)
+            write_le(out, (uint16_t) -v, 2);
+    }
+
+    return !out.fail();
+}
+
+static bool check(const uint32_t freq, const int channels, const int frames)
+{
+    const char* filename = "wavcheck.tmp.wav";
+
+    std::cout << freq << "Hz " << (channels == 2 ? "stereo" : "mono") << ", " << frames << " frames: ";
+
+    if (!write_wav(filename, freq, channels, frames))
+    {
+        std::cout << "unable to write " << filename << std::endl;
+        return false;
+    }
+
+    WavStream stream;
+    if (!stream.open(filename, OUT_FREQ))
+    {
+        std::cout << "unable to open" << std::endl;
+        remove(filename);
+        return false;
+    }
+
+    // Length of one pass at the output rate, and the output needed to see every click
+    const double expected = (double) frames * OUT_FREQ / freq;
+    const int total       = (int) (expected * (LOOPS + 2));
+
+    // Read slowly enough that the decoder never falls behind
+    const int BLOCK = 1024;
+    std::vector<int16_t> block(BLOCK * 2);
+    std::vector<int> clicks;
+    int last_high = -16;
+    bool ok = true;
+
+    for (int done = 0; done < total && ok; done += BLOCK)
+    {
+        boost::this_thread::sleep(boost::posix_time::milliseconds(2));
+        stream.read(&block[0], BLOCK * 2);
+
+        for (int i = 0; i < BLOCK; i++)
+        {
+            const int l = block[i * 2];
+            const int r = block[i * 2 + 1];
+
+            // Output is at half volume. Silence means the decoder fell behind.
+            // Halving rounds down, so an inverted channel can be out by one.
+            if (l == 0 || (channels == 2 ? abs(r + l) > 1 : r != l))
+            {
+                std::cout << "bad sample " << l << ", " << r << " at " << done + i << std::endl;
+                ok = false;
+                break;
+            }
+
+            // Start of each click. At low rates, a click is spread over several frames.
+            if (l > LEVEL / 2)
+            {
+                if (done + i > last_high + 2)
+                    clicks.push_back(done + i);
+                last_high = done + i;
+            }
+        }
+    }
+
+    stream.close();
+    remove(filename);
+
+    if (!ok)
+        return false;
+
+    if ((int) clicks.size() < LOOPS + 1)
+    {
+        std::cout << "found " << clicks.size() << " clicks, expected " << LOOPS + 1 << std::endl;
+        return false;
+    }
+
+    // The first click starts exactly on the first output frame. Later clicks start where the
+    // interpolation from the previous pass begins to rise, so are measured from the second.
+    // Interpolation can move each click by a frame.
+    for (size_t i = 2; i < clicks.size(); i++)
+    {
+        const int length = clicks[i] - clicks[i - 1];
+        if (length < expected - 1.5 || length > expected + 1.5)
+        {
+            std::cout << "pass " << i << " is " << length << " frames, expected " << expected << std::endl;
+            return false;
+        }
+    }
+
+    std::cout << "ok, " << clicks.size() - 2 << " passes of " << expected << " frames" << std::endl;
+    return true;
+}
+
+int main(int argc, char* argv[])
+{
+    // Rate, channels and length (frames). Several chunks long, and not a multiple of the chunk size.
+    const struct { uint32_t freq; int channels; int frames; } files[] =
+    {
+        { 6000,  1, 1999 },
+        { 6000,  2, 1999 },
+        { 8000,  1, 3001 },
+        { 8000,  2, 3001 },
+        { 22050, 2, 9001 },
+        { 44100, 2, 20001 },
+        { 48000, 2, 20001 },
+    };
+
+    int failed = 0;
+    for (size_t i = 0; i < sizeof(files) / sizeof(files[0]); i++)
+    {
+        if (!check(files[i].freq, files[i].channels, files[i].frames))
+            failed++;
+    }
+
+    if (failed)
+        std::cout << failed << " failed" << std::endl;
+
+    return failed ? 1 : 0;
+}
@@ -0,0 +1,328 @@
+/***************************************************************************
+    Streaming WAV Reader.
+
+    Plays custom music straight from disk, rather than loading the whole
+    file up front.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <iostream>
+#include <cstring>
+#include <cmath>
+#include <boost/bind.hpp>
+
+#include "wavstream.hpp"
+
+// Little endian helpers
+static inline uint32_t read_le16(const uint8_t* p) { return p[0] | (p[1] << 8); }
+static inline uint32_t read_le32(const uint8_t* p) { return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24); }
+
+WavStream::WavStream()
+{
+    thread = NULL;
+    quit   = false;
+}
+
+WavStream::~WavStream()
+{
+    close();
+}
+
+bool WavStream::open(const char* filename, const uint32_t out_freq)
+{
+    close();
+
+    file.open(filename, std::ios::in | std::ios::binary);
+    if (!file || !read_header())
+    {
+        close();
+        return false;
+    }
+
+    step        = (double) freq / out_freq;
+    pos         = 0;
+    last[0]     = 0;
+    last[1]     = 0;
+    read_frames = 0;
+
+    // Below the output rate, a chunk of input makes more than CHUNK_FRAMES of output
+    const int in_frames  = (int) ceil(CHUNK_FRAMES * step);
+    const int out_frames = (int) ceil(in_frames / step) + 2;
+    raw.resize(in_frames * block_align);
+    src.resize(in_frames * 2);
+    out.resize(out_frames * 2);
+
+    ring.assign(RING_FRAMES * 2, 0);
+    ring_read  = 0;
+    ring_write = 0;
+    ring_count = 0;
+    quit       = false;
+
+    // Decode the first chunk up front, so there's something to play straight away
+    const int frames = decode_chunk();
+    if (frames <= 0)
+    {
+        close();
+        return false;
+    }
+    push(&out[0], frames * 2);
+
+    try
+    {
+        thread = new boost::thread(boost::bind(&WavStream::decode_thread, this));
+    }
+    catch (boost::thread_resource_error&)
+    {
+        thread = NULL;
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void WavStream::close()
+{
+    if (thread)
+    {
+        {
+            boost::mutex::scoped_lock lock(mtx);
+            quit = true;
+        }
+        cond_space.notify_one();
+        thread->join();
+        delete thread;
+        thread = NULL;
+    }
+
+    file.close();
+    file.clear();
+}
+
+void WavStream::read(int16_t* dst, const int samples)
+{
+    int count;
+    {
+        boost::mutex::scoped_lock lock(mtx);
+
+        count = samples < ring_count ? samples : ring_count;
+        const int size = (int) ring.size();
+
+        for (int i = 0; i < count; i++)
+        {
+            dst[i] = ring[ring_read];
+            if (++ring_read == size)
+                ring_read = 0;
+        }
+        ring_count -= count;
+    }
+    cond_space.notify_one();
+
+    // Decoder fell behind: pad with silence
+    if (count < samples)
+        memset(dst + count, 0, (samples - count) * sizeof(int16_t));
+}
+
+// Parse the RIFF header, and leave the file at the start of the sample data
+bool WavStream::read_header()
+{
+    uint8_t header[12];
+    if (!file.read((char*) header, 12) || memcmp(header, "RIFF", 4) || memcmp(header + 8, "WAVE", 4))
+        return false;
+
+    bool have_fmt = false;
+
+    uint8_t chunk[8];
+    while (file.read((char*) chunk, 8))
+    {
+        const uint32_t size = read_le32(chunk + 4);
+
+        if (memcmp(chunk, "fmt ", 4) == 0)
+        {
+            uint8_t fmt[40];
+            const uint32_t len = size < sizeof(fmt) ? size : sizeof(fmt);
+            if (len < 16 || !file.read((char*) fmt, len))
+                return false;
+
+            format      = read_le16(fmt);
+            channels    = read_le16(fmt + 2);
+            freq        = read_le32(fmt + 4);
+            block_align = read_le16(fmt + 12);
+            bits        = read_le16(fmt + 14);
+
+            // The real format is the first two bytes of the sub format GUID
+            if (format == FORMAT_EXTENSIBLE && len >= 26)
+                format = read_le16(fmt + 24);
+
+            have_fmt = true;
+
+            // Skip the rest of the chunk. Chunks are padded to an even length.
+            file.seekg((size - len) + (size & 1), std::ios::cur);
+        }
+        else if (memcmp(chunk, "data", 4) == 0)
+        {
+            if (!have_fmt)
+                return false;
+
+            const bool pcm = format == FORMAT_PCM && (bits == 8 || bits == 16 || bits == 24 || bits == 32);
+            const bool fp  = format == FORMAT_FLOAT && bits == 32;
+            if ((!pcm && !fp) || channels < 1 || freq == 0 || block_align != channels * (bits / 8))
+            {
+                std::cout << "Unsupported wav format" << std::endl;
+                return false;
+            }
+
+            data_start  = (uint32_t) file.tellg();
+            data_frames = size / block_align;
+            return data_frames > 0;
+        }
+        else
+        {
+            file.seekg(size + (size & 1), std::ios::cur);
+        }
+    }
+
+    return false;
+}
+
+// Read the next chunk of the file, and convert it to stereo at the output rate.
+// Returns the number of output frames, or -1 on a read error.
+int WavStream::decode_chunk()
+{
+    const int in_frames = (int) src.size() / 2;
+
+    // Loop back to the start
+    if (read_frames >= data_frames)
+    {
+        file.clear();
+        file.seekg(data_start, std::ios::beg);
+        read_frames = 0;
+    }
+
+    int frames = data_frames - read_frames;
+    if (frames > in_frames)
+        frames = in_frames;
+
+    file.read((char*) &raw[0], frames * block_align);
+    frames = (int) (file.gcount() / block_align);
+    if (frames <= 0)
+        return -1;
+
+    // Truncated file: loop early
+    read_frames = file ? read_frames + frames : data_frames;
+
+    // Convert to 16-bit stereo (held in 32-bit for the interpolation)
+    const int second = channels > 1 ? (bits / 8) : 0;
+    const uint8_t* in = &raw[0];
+    int32_t* s = &src[0];
+
+    for (int f = 0; f < frames; f++, in += block_align)
+    {
+        for (int c = 0; c < 2; c++)
+        {
+            const uint8_t* p = in + (c * second);
+            int32_t v;
+
+            switch (bits)
+            {
+                case 8:
+                    v = (p[0] - 128) * 256;
+                    break;
+
+                case 16:
+                    v = (int16_t) read_le16(p);
+                    break;
+
+                case 24:
+                    v = ((int32_t) ((p[0] << 8) | (p[1] << 16) | ((uint32_t) p[2] << 24))) >> 16;
+                    break;
+
+                default:
+                    if (format == FORMAT_FLOAT)
+                    {
+                        const uint32_t u = read_le32(p);
+                        float fv;
+                        memcpy(&fv, &u, sizeof(fv));
+                        fv *= 32767.0f;
+
+                        // NaN fails every comparison, so is tested first
+                        if (fv != fv)                v = 0;
+                        else if (fv >= 32767.0f)     v = 32767;
+                        else if (fv <= -32768.0f)    v = -32768;
+                        else                         v = (int32_t) fv;
+                    }
+                    else
+                    {
+                        v = ((int32_t) read_le32(p)) >> 16;
+                    }
+                    break;
+            }
+
+            *s++ = v;
+        }
+    }
+
+    // Linear interpolation to the output rate, at half volume.
+    // Position -1 is the last frame of the previous chunk.
+    int16_t* o = &out[0];
+    while (pos < frames - 1)
+    {
+        const int i       = (int) floor(pos);
+        const double frac = pos - i;
+        const int32_t* a  = i < 0 ? last : &src[i * 2];
+        const int32_t* b  = &src[(i + 1) * 2];
+
+        *o++ = (int16_t) ((a[0] + (int32_t) ((b[0] - a[0]) * frac)) >> 1);
+        *o++ = (int16_t) ((a[1] + (int32_t) ((b[1] - a[1]) * frac)) >> 1);
+        pos += step;
+    }
+
+    pos -= frames;
+    last[0] = src[(frames - 1) * 2];
+    last[1] = src[(frames - 1) * 2 + 1];
+
+    return (int) (o - &out[0]) / 2;
+}
+
+// Copy samples to the ring buffer, waiting for space
+void WavStream::push(const int16_t* samples, const int count)
+{
+    boost::mutex::scoped_lock lock(mtx);
+
+    const int size = (int) ring.size();
+    while (!quit && size - ring_count < count)
+        cond_space.wait(lock);
+
+    if (quit)
+        return;
+
+    for (int i = 0; i < count; i++)
+    {
+        ring[ring_write] = samples[i];
+        if (++ring_write == size)
+            ring_write = 0;
+    }
+    ring_count += count;
+}
+
+void WavStream::decode_thread()
+{
+    for (;;)
+    {
+        {
+            boost::mutex::scoped_lock lock(mtx);
+            if (quit)
+                return;
+        }
+
+        const int frames = decode_chunk();
+
+        // Read error: leave the rest silent
+        if (frames < 0)
+            return;
+
+        push(&out[0], frames * 2);
+    }
+}
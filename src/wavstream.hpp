@@ -0,0 +1,84 @@
+/***************************************************************************
+    Streaming WAV Reader.
+
+    Plays custom music straight from disk, rather than loading the whole
+    file up front.
+
+    - A background thread decodes the file in chunks into a small ring
+      buffer. It converts to 16-bit stereo at the output rate, and halves
+      the volume, on the fly.
+    - 8, 16, 24 and 32-bit PCM and 32-bit float files are supported.
+    - The file loops when the end is reached.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <fstream>
+#include <vector>
+#include <boost/thread/thread.hpp>
+#include <boost/thread/mutex.hpp>
+#include <boost/thread/condition_variable.hpp>
+
+#include "stdint.hpp"
+
+class WavStream
+{
+public:
+    WavStream();
+    ~WavStream();
+
+    // Open a file and start decoding it. Returns false if the file can't be played.
+    bool open(const char* filename, const uint32_t out_freq);
+    void close();
+    bool is_open() const { return thread != NULL; }
+
+    // Read interleaved stereo samples. Pads with silence if the decoder falls behind.
+    void read(int16_t* dst, const int samples);
+
+private:
+    // Output frames (stereo samples) decoded at a time
+    static const int CHUNK_FRAMES = 4096;
+
+    // Ring buffer size, in output frames (about 370ms at 44.1KHz)
+    static const int RING_FRAMES = CHUNK_FRAMES * 4;
+
+    enum { FORMAT_PCM = 1, FORMAT_FLOAT = 3, FORMAT_EXTENSIBLE = 0xFFFE };
+
+    std::ifstream file;
+
+    // Source format
+    int format;
+    int channels;
+    int bits;
+    int block_align;
+    uint32_t freq;
+    uint32_t data_start;    // Offset of the sample data in the file
+    uint32_t data_frames;   // Length of the sample data, in frames
+    uint32_t read_frames;   // Frames read since the last loop
+
+    // Resampling to the output rate
+    double step;            // Source frames per output frame
+    double pos;             // Position of the next output frame, relative to the chunk
+    int32_t last[2];        // Last frame of the previous chunk
+
+    std::vector<uint8_t> raw;
+    std::vector<int32_t> src;
+    std::vector<int16_t> out;
+
+    // Ring buffer of decoded stereo samples
+    std::vector<int16_t> ring;
+    int ring_read, ring_write, ring_count;
+
+    boost::thread* thread;
+    boost::mutex mtx;
+    boost::condition_variable cond_space;
+    bool quit;
+
+    bool read_header();
+    int decode_chunk();
+    void push(const int16_t* samples, const int count);
+    void decode_thread();
+};
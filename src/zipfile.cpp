@@ -0,0 +1,605 @@
+/***************************************************************************
+    Zip Archive Reader.
+
+    Reads files from MAME style rom archives (e.g. outrun.zip), without
+    extracting them to disk first.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#include <fstream>
+#include <cctype>
+#include <cstring>
+
+#ifndef _WIN32
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#endif
+
+#include "zipfile.hpp"
+
+// Record signatures
+static const uint32_t SIG_LOCAL     = 0x04034b50;
+static const uint32_t SIG_CENTRAL   = 0x02014b50;
+static const uint32_t SIG_END       = 0x06054b50;
+
+// Fixed record sizes, excluding variable length fields
+static const uint32_t LOCAL_SIZE    = 30;
+static const uint32_t CENTRAL_SIZE  = 46;
+static const uint32_t END_SIZE      = 22;
+
+static const uint32_t METHOD_STORED  = 0;
+static const uint32_t METHOD_DEFLATE = 8;
+
+static inline uint16_t read16(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8);
+}
+
+static inline uint32_t read32(const uint8_t* p)
+{
+    return p[0] | (p[1] << 8) | (p[2] << 16) | ((uint32_t) p[3] << 24);
+}
+
+// ------------------------------------------------------------------------------------------------
+// Inflate (RFC 1951)
+//
+// Output is written to every 'stride' bytes of the destination. Back references are copied
+// from the destination itself, so the whole output acts as the history window.
+// ------------------------------------------------------------------------------------------------
+
+class Inflate
+{
+public:
+    Inflate(const uint8_t* src, const uint32_t src_length, uint8_t* dst, const int stride, const int limit)
+    {
+        in       = src;
+        in_end   = src + src_length;
+        overrun  = 0;
+        bitbuf   = 0;
+        bitcnt   = 0;
+        out      = dst;
+        this->stride = stride;
+        this->limit  = limit;
+        pos      = 0;
+    }
+
+    // Returns the number of bytes written, or -1 on error
+    int run()
+    {
+        int last;
+
+        do
+        {
+            last = bits(1);
+            int type = bits(2);
+            bool ok;
+
+            if      (type == 0) ok = stored();
+            else if (type == 1) ok = fixed();
+            else if (type == 2) ok = dynamic();
+            else                ok = false;
+
+            // Corrupt, or read past the end of the input
+            if (!ok || overrun > (bitcnt >> 3))
+                return -1;
+        }
+        while (!last && pos < limit);
+
+        return pos < limit ? pos : limit;
+    }
+
+private:
+    // Decode tables for a set of Huffman codes
+    const static int FAST_BITS = 9;
+    const static int MAX_BITS  = 15;
+
+    struct huffman_t
+    {
+        uint16_t fast[1 << FAST_BITS]; // (length << 9) | symbol, for codes up to FAST_BITS long. 0 = slow path.
+        uint16_t count[MAX_BITS + 1];  // Number of codes of each length
+        uint16_t symbol[288];          // Symbols ordered by code
+    };
+
+    // Input
+    const uint8_t* in;
+    const uint8_t* in_end;
+    uint32_t overrun;       // Zero bytes read past the end of the input
+    uint32_t bitbuf;
+    uint32_t bitcnt;
+
+    // Output
+    uint8_t* out;
+    int stride;
+    int limit;
+    int pos;
+
+    huffman_t lencode, distcode;
+
+    // Ensure at least n bits are buffered. Zeros are fed past the end of the input.
+    inline void need(const uint32_t n)
+    {
+        while (bitcnt < n)
+        {
+            if (in < in_end)
+                bitbuf |= (uint32_t) *in++ << bitcnt;
+            else
+                overrun++;
+            bitcnt += 8;
+        }
+    }
+
+    inline uint32_t bits(const uint32_t n)
+    {
+        need(n);
+        uint32_t value = bitbuf & ((1u << n) - 1);
+        bitbuf >>= n;
+        bitcnt -= n;
+        return value;
+    }
+
+    inline void put(const uint8_t value)
+    {
+        if (pos < limit)
+            out[pos * stride] = value;
+        pos++;
+    }
+
+    bool build(huffman_t* h, const uint8_t* lengths, const int n)
+    {
+        memset(h->count, 0, sizeof(h->count));
+        memset(h->fast, 0, sizeof(h->fast));
+
+        for (int s = 0; s < n; s++)
+            h->count[lengths[s]]++;
+
+        h->count[0] = 0;
+
+        // Over-subscribed code set. (Incomplete sets are allowed, as used for single distance codes.)
+        int left = 1;
+        for (int len = 1; len <= MAX_BITS; len++)
+        {
+            left <<= 1;
+            left -= h->count[len];
+            if (left < 0)
+                return false;
+        }
+
+        uint16_t offs[MAX_BITS + 2];
+        uint16_t next[MAX_BITS + 1];
+        uint32_t code = 0;
+        offs[1] = 0;
+
+        for (int len = 1; len <= MAX_BITS; len++)
+        {
+            offs[len + 1] = offs[len] + h->count[len];
+            code = (code + h->count[len - 1]) << 1;
+            next[len] = code;
+        }
+
+        for (int s = 0; s < n; s++)
+        {
+            const int len = lengths[s];
+            if (len == 0)
+                continue;
+
+            h->symbol[offs[len]++] = s;
+
+            // Codes are sent most significant bit first, so reverse them for the lookup
+            const uint32_t c = next[len]++;
+            if (len <= FAST_BITS)
+            {
+                uint32_t rev = 0;
+                for (int i = 0; i < len; i++)
+                    rev |= ((c >> i) & 1) << (len - 1 - i);
+
+                for (uint32_t i = rev; i < (1u << FAST_BITS); i += (1u << len))
+                    h->fast[i] = (len << 9) | s;
+            }
+        }
+        return true;
+    }
+
+    // Returns the next symbol, or -1 for an invalid code
+    inline int decode(const huffman_t* h)
+    {
+        need(MAX_BITS);
+
+        const uint16_t e = h->fast[bitbuf & ((1 << FAST_BITS) - 1)];
+        if (e)
+        {
+            bitbuf >>= (e >> 9);
+            bitcnt -= (e >> 9);
+            return e & 0x1FF;
+        }
+
+        // Longer codes: Walk the canonical code one bit at a time
+        int code = 0, first = 0, index = 0;
+        for (int len = 1; len <= MAX_BITS; len++)
+        {
+            code |= (bitbuf >> (len - 1)) & 1;
+            const int count = h->count[len];
+            if (code - count < first)
+            {
+                bitbuf >>= len;
+                bitcnt -= len;
+                return h->symbol[index + (code - first)];
+            }
+            index += count;
+            first += count;
+            first <<= 1;
+            code  <<= 1;
+        }
+        return -1;
+    }
+
+    bool stored()
+    {
+        // Discard to byte boundary. Whole bytes left in the bit buffer are returned to the input.
+        bitbuf >>= (bitcnt & 7);
+        bitcnt  -= (bitcnt & 7);
+        if (overrun > (bitcnt >> 3))
+            return false;
+        in      -= (bitcnt >> 3) - overrun;
+        overrun  = 0;
+        bitbuf   = 0;
+        bitcnt   = 0;
+
+        if (in_end - in < 4)
+            return false;
+
+        const uint32_t len = read16(in);
+        if (len != (uint16_t) ~read16(in + 2))
+            return false;
+        in += 4;
+
+        if ((uint32_t) (in_end - in) < len)
+            return false;
+
+        for (uint32_t i = 0; i < len; i++)
+            put(in[i]);
+        in += len;
+        return true;
+    }
+
+    bool codes()
+    {
+        static const uint16_t LEN_BASE[]  = { 3, 4, 5, 6, 7, 8, 9, 10, 11, 13, 15, 17, 19, 23, 27, 31,
+                                              35, 43, 51, 59, 67, 83, 99, 115, 131, 163, 195, 227, 258 };
+        static const uint8_t  LEN_EXTRA[] = { 0, 0, 0, 0, 0, 0, 0, 0, 1, 1, 1, 1, 2, 2, 2, 2,
+                                              3, 3, 3, 3, 4, 4, 4, 4, 5, 5, 5, 5, 0 };
+        static const uint16_t DIST_BASE[] = { 1, 2, 3, 4, 5, 7, 9, 13, 17, 25, 33, 49, 65, 97, 129, 193,
+                                              257, 385, 513, 769, 1025, 1537, 2049, 3073, 4097, 6145,
+                                              8193, 12289, 16385, 24577 };
+        static const uint8_t  DIST_EXTRA[]= { 0, 0, 0, 0, 1, 1, 2, 2, 3, 3, 4, 4, 5, 5, 6, 6,
+                                              7, 7, 8, 8, 9, 9, 10, 10, 11, 11, 12, 12, 13, 13 };
+
+        for (;;)
+        {
+            int symbol = decode(&lencode);
+
+            if (symbol < 0)
+                return false;
+            else if (symbol < 256)
+                put(symbol);
+            else if (symbol == 256)
+                return true; // End of block
+            else
+            {
+                symbol -= 257;
+                if (symbol >= 29)
+                    return false;
+                const int len = LEN_BASE[symbol] + bits(LEN_EXTRA[symbol]);
+
+                symbol = decode(&distcode);
+                if (symbol < 0 || symbol >= 30)
+                    return false;
+                const int dist = DIST_BASE[symbol] + bits(DIST_EXTRA[symbol]);
+
+                if (dist > pos)
+                    return false;
+
+                // Copy from the output. May overlap, so byte at a time.
+                for (int i = 0; i < len; i++)
+                {
+                    if (pos >= limit)
+                        return true; // Remaining output is not required
+                    out[pos * stride] = out[(pos - dist) * stride];
+                    pos++;
+                }
+            }
+
+            if (pos >= limit)
+                return true;
+
+            if (overrun > (bitcnt >> 3))
+                return false;
+        }
+    }
+
+    bool fixed()
+    {
+        uint8_t lengths[288];
+        int s = 0;
+        for (; s < 144; s++) lengths[s] = 8;
+        for (; s < 256; s++) lengths[s] = 9;
+        for (; s < 280; s++) lengths[s] = 7;
+        for (; s < 288; s++) lengths[s] = 8;
+        build(&lencode, lengths, 288);
+
+        for (s = 0; s < 30; s++) lengths[s] = 5;
+        build(&distcode, lengths, 30);
+
+        return codes();
+    }
+
+    bool dynamic()
+    {
+        static const uint8_t ORDER[19] = { 16, 17, 18, 0, 8, 7, 9, 6, 10, 5, 11, 4, 12, 3, 13, 2, 14, 1, 15 };
+
+        const int nlen  = bits(5) + 257;
+        const int ndist = bits(5) + 1;
+        const int ncode = bits(4) + 4;
+
+        if (nlen > 286 || ndist > 30)
+            return false;
+
+        uint8_t lengths[286 + 30];
+        memset(lengths, 0, 19);
+
+        for (int i = 0; i < ncode; i++)
+            lengths[ORDER[i]] = bits(3);
+
+        // Code length codes are decoded with the literal/length table
+        if (!build(&lencode, lengths, 19))
+            return false;
+
+        for (int i = 0; i < nlen + ndist;)
+        {
+            int symbol = decode(&lencode);
+            if (symbol < 0)
+                return false;
+
+            if (symbol < 16)
+            {
+                lengths[i++] = symbol;
+                continue;
+            }
+
+            int len = 0;    // Length to repeat
+            int rep;
+            if (symbol == 16)
+            {
+                if (i == 0)
+                    return false;
+                len = lengths[i - 1];
+                rep = 3 + bits(2);
+            }
+            else if (symbol == 17)
+                rep = 3 + bits(3);
+            else
+                rep = 11 + bits(7);
+
+            if (i + rep > nlen + ndist)
+                return false;
+            while (rep--)
+                lengths[i++] = len;
+        }
+
+        // End of block code is required
+        if (lengths[256] == 0)
+            return false;
+
+        if (!build(&lencode, lengths, nlen) || !build(&distcode, lengths + nlen, ndist))
+            return false;
+
+        return codes();
+    }
+};
+
+// ------------------------------------------------------------------------------------------------
+// Archive
+// ------------------------------------------------------------------------------------------------
+
+ZipFile::ZipFile()
+{
+    data   = NULL;
+    length = 0;
+    mapped = false;
+}
+
+ZipFile::~ZipFile()
+{
+    close();
+}
+
+bool ZipFile::open(const char* path)
+{
+    close();
+
+#ifndef _WIN32
+    int fd = ::open(path, O_RDONLY);
+    if (fd < 0)
+        return false;
+
+    struct stat st;
+    if (fstat(fd, &st) == 0 && st.st_size > 0)
+    {
+        void* map = mmap(NULL, st.st_size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if (map != MAP_FAILED)
+        {
+            data   = (const uint8_t*) map;
+            length = (uint32_t) st.st_size;
+            mapped = true;
+        }
+    }
+    ::close(fd);
+#endif
+
+    // Fallback: Read whole archive
+    if (data == NULL)
+    {
+        std::ifstream src(path, std::ios::in | std::ios::binary | std::ios::ate);
+        if (!src)
+            return false;
+
+        length = (uint32_t) src.tellg();
+        uint8_t* buffer = new uint8_t[length];
+        src.seekg(0, std::ios::beg);
+        src.read((char*) buffer, length);
+        data = buffer;
+    }
+
+    if (!read_directory())
+    {
+        close();
+        return false;
+    }
+
+    return true;
+}
+
+void ZipFile::close()
+{
+    if (data != NULL)
+    {
+#ifndef _WIN32
+        if (mapped)
+            munmap((void*) data, length);
+        else
+#endif
+            delete[] data;
+    }
+
+    data   = NULL;
+    length = 0;
+    mapped = false;
+    entries.clear();
+}
+
+bool ZipFile::read_directory()
+{
+    if (length < END_SIZE)
+        return false;
+
+    // Find the end of central directory record. It is followed by a comment of up to 64K.
+    uint32_t end = length - END_SIZE;
+    const uint32_t search_end = length > END_SIZE + 0xFFFF ? length - END_SIZE - 0xFFFF : 0;
+
+    while (read32(data + end) != SIG_END)
+    {
+        if (end == search_end)
+            return false;
+        end--;
+    }
+
+    const uint32_t count      = read16(data + end + 10);
+    const uint32_t dir_offset = read32(data + end + 16);
+
+    uint32_t p = dir_offset;
+    entries.reserve(count);
+
+    for (uint32_t i = 0; i < count; i++)
+    {
+        // Offsets come from the archive, so are checked without risk of overflow
+        if (p > length || length - p < CENTRAL_SIZE || read32(data + p) != SIG_CENTRAL)
+            return false;
+
+        const uint8_t* h = data + p;
+        const uint32_t name_length = read16(h + 28);
+
+        if (length - p - CENTRAL_SIZE < name_length)
+            return false;
+
+        entry_t e;
+        e.method       = read16(h + 10);
+        e.crc          = read32(h + 16);
+        e.packed_size  = read32(h + 20);
+        e.size         = read32(h + 24);
+        e.local_offset = read32(h + 42);
+        e.name.assign((const char*) h + CENTRAL_SIZE, name_length);
+
+        // Strip directory
+        size_t slash = e.name.find_last_of("/\\");
+        if (slash != std::string::npos)
+            e.name = e.name.substr(slash + 1);
+
+        // Skip encrypted entries and directories
+        if ((read16(h + 8) & 1) == 0 && !e.name.empty())
+            entries.push_back(e);
+
+        p += CENTRAL_SIZE + name_length + read16(h + 30) + read16(h + 32);
+    }
+
+    return true;
+}
+
+const ZipFile::entry_t* ZipFile::find(const char* name, const uint32_t crc) const
+{
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        if (entries[i].crc == crc)
+            return &entries[i];
+    }
+
+    for (size_t i = 0; i < entries.size(); i++)
+    {
+        const char* a = entries[i].name.c_str();
+        const char* b = name;
+
+        while (*a && tolower(*a) == tolower(*b))
+        {
+            a++;
+            b++;
+        }
+
+        if (*a == 0 && *b == 0)
+            return &entries[i];
+    }
+
+    return NULL;
+}
+
+int ZipFile::extract(const entry_t* entry, uint8_t* dst, const int stride, const int max_length) const
+{
+    const uint32_t p = entry->local_offset;
+
+    if (p > this->length || this->length - p < LOCAL_SIZE || read32(data + p) != SIG_LOCAL)
+        return -1;
+
+    // The local header has its own copy of the name and extra field lengths
+    const uint32_t extra = read16(data + p + 26) + read16(data + p + 28);
+
+    if (this->length - p - LOCAL_SIZE < extra)
+        return -1;
+
+    const uint32_t start = p + LOCAL_SIZE + extra;
+
+    if (entry->packed_size > this->length - start)
+        return -1;
+
+    const int length = max_length < (int) entry->size ? max_length : (int) entry->size;
+
+    const uint8_t* src = data + start;
+
+    if (entry->method == METHOD_STORED)
+    {
+        if ((int) entry->packed_size < length)
+            return -1;
+
+        for (int i = 0; i < length; i++)
+            dst[i * stride] = src[i];
+        return length;
+    }
+    else if (entry->method == METHOD_DEFLATE)
+    {
+        Inflate inflate(src, entry->packed_size, dst, stride, length);
+        const int written = inflate.run();
+        return written < length ? -1 : length;
+    }
+
+    return -1;
+}
@@ -0,0 +1,60 @@
+/***************************************************************************
+    Zip Archive Reader.
+
+    Reads files from MAME style rom archives (e.g. outrun.zip), without
+    extracting them to disk first.
+
+    - Entries are located through the central directory, by CRC or name.
+    - Deflated entries are decompressed straight into their final,
+      interleaved, location. The output itself is used as the history
+      window, so no intermediate buffers are required.
+
+    Zip64 and encrypted archives are not supported.
+
+    Copyright Chris White.
+    See license.txt for more details.
+***************************************************************************/
+
+#pragma once
+
+#include <vector>
+#include <string>
+#include "stdint.hpp"
+
+class ZipFile
+{
+public:
+    struct entry_t
+    {
+        std::string name;       // Filename, without any directory
+        uint32_t crc;
+        uint32_t method;        // 0 = Stored, 8 = Deflated
+        uint32_t packed_size;
+        uint32_t size;
+        uint32_t local_offset;  // Offset of the local file header
+    };
+
+    ZipFile();
+    ~ZipFile();
+
+    bool open(const char* path);
+    void close();
+    bool is_open() const { return data != NULL; }
+
+    // Find an entry, preferring a CRC match (MAME sets may rename files). NULL if not found.
+    const entry_t* find(const char* name, const uint32_t crc) const;
+
+    // Decompress the first max_length bytes of an entry to dst[i * stride].
+    // Returns the number of bytes written, or -1 if the entry is corrupt.
+    // Safe to call from several threads at once.
+    int extract(const entry_t* entry, uint8_t* dst, const int stride, const int max_length) const;
+
+private:
+    const uint8_t* data;
+    uint32_t length;
+    bool mapped;                // Memory mapped, rather than read to a buffer
+
+    std::vector<entry_t> entries;
+
+    bool read_directory();
+};